@@ -0,0 +1,269 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_ALIGNED_BLOCK_HPP
+#define MA_ALIGNED_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Arrays of at least this many bytes are aligned to 2 MiB and advised to
+// be backed by transparent huge pages (Linux only). Define it to 0 to
+// disable the hint.
+#ifndef MA_HUGEPAGE_THRESHOLD
+#define MA_HUGEPAGE_THRESHOLD (std::size_t(1) << 22)
+#endif
+
+namespace marray {
+
+// Contiguous memory block whose first element is aligned to `Align` bytes
+// (a power of two, at least the alignment of `T`). It can be used in place
+// of std::vector as the memory block of an Array, e.g.
+//
+//    Array<double, 3, RowMajor, AlignedBlock<double> > A(n,n,n);
+//
+// and then the SIMD bulk operations use aligned loads and stores. Unlike
+// std::vector, growing reallocates to the exact size: arrays are reshaped,
+// not pushed into.
+template<class T, std::size_t Align = 64>
+class AlignedBlock
+{
+public:
+  typedef T                 value_type;
+  typedef T&                reference;
+  typedef T const&          const_reference;
+  typedef T*                iterator;
+  typedef T const*          const_iterator;
+  typedef std::size_t       size_type;
+  typedef std::ptrdiff_t    difference_type;
+  typedef T*                pointer;
+  typedef T const*          const_pointer;
+
+  static const std::size_t alignment = Align;
+
+  AlignedBlock() : m_data(NULL), m_size(0), m_capacity(0)
+  { }
+
+  explicit AlignedBlock(size_type n, T const& v = T()) : m_data(NULL), m_size(0), m_capacity(0)
+  { resize(n, v); }
+
+  AlignedBlock(AlignedBlock const& x) : m_data(NULL), m_size(0), m_capacity(0)
+  {
+    reserve(x.m_size);
+    std::uninitialized_copy(x.begin(), x.end(), m_data);
+    m_size = x.m_size;
+  }
+
+  AlignedBlock& operator=(AlignedBlock const& x)
+  {
+    if (this != &x)
+    {
+      AlignedBlock tmp(x);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+#if __cplusplus >= 201103L
+  AlignedBlock(AlignedBlock&& x) noexcept : m_data(x.m_data), m_size(x.m_size), m_capacity(x.m_capacity)
+  {
+    x.m_data = NULL;
+    x.m_size = x.m_capacity = 0;
+  }
+
+  AlignedBlock& operator=(AlignedBlock&& x) noexcept
+  {
+    AlignedBlock tmp;
+    tmp.swap(x);
+    swap(tmp);
+    return *this;
+  }
+#endif
+
+  ~AlignedBlock()
+  {
+    destroy(m_data, m_data + m_size);
+    deallocate(m_data, m_capacity);
+  }
+
+  size_type size() const      { return m_size; }
+  size_type capacity() const  { return m_capacity; }
+  bool empty() const          { return m_size == 0; }
+
+  pointer data()              { return m_data; }
+  const_pointer data() const  { return m_data; }
+
+  iterator begin()              { return m_data; }
+  iterator end()                { return m_data + m_size; }
+  const_iterator begin() const  { return m_data; }
+  const_iterator end() const    { return m_data + m_size; }
+
+  reference operator[](size_type i)              { return m_data[i]; }
+  const_reference operator[](size_type i) const  { return m_data[i]; }
+
+  reference at(size_type i)
+  {
+    if (i >= m_size)
+      throw std::out_of_range("**ERROR**: AlignedBlock<>: index out of range");
+    return m_data[i];
+  }
+
+  const_reference at(size_type i) const
+  {
+    if (i >= m_size)
+      throw std::out_of_range("**ERROR**: AlignedBlock<>: index out of range");
+    return m_data[i];
+  }
+
+  void reserve(size_type n)
+  {
+    if (n <= m_capacity)
+      return;
+    T* p = allocate(n);
+    try {
+      std::uninitialized_copy(m_data, m_data + m_size, p);
+    }
+    catch (...) {
+      deallocate(p, n);
+      throw;
+    }
+    destroy(m_data, m_data + m_size);
+    deallocate(m_data, m_capacity);
+    m_data = p;
+    m_capacity = n;
+  }
+
+  void resize(size_type n, T const& v = T())
+  {
+    if (n > m_size)
+    {
+      reserve(n);
+      std::uninitialized_fill(m_data + m_size, m_data + n, v);
+    }
+    else
+      destroy(m_data + n, m_data + m_size);
+    m_size = n;
+  }
+
+  // like resize, but the new elements are left uninitialized; only for
+  // trivially constructible types
+  void resize_uninitialized(size_type n)
+  {
+    if (n > m_size)
+      reserve(n);
+    else
+      destroy(m_data + n, m_data + m_size);
+    m_size = n;
+  }
+
+  void clear()
+  {
+    destroy(m_data, m_data + m_size);
+    m_size = 0;
+  }
+
+  void swap(AlignedBlock& x)
+  {
+    std::swap(m_data, x.m_data);
+    std::swap(m_size, x.m_size);
+    std::swap(m_capacity, x.m_capacity);
+  }
+
+private:
+  T*        m_data;
+  size_type m_size;
+  size_type m_capacity;
+
+  static void destroy(T* first, T* last)
+  {
+    for (; first != last; ++first)
+      first->~T();
+  }
+
+  static bool isHuge(size_type n)
+  { return MA_HUGEPAGE_THRESHOLD > 0 && n*sizeof(T) >= std::size_t(MA_HUGEPAGE_THRESHOLD); }
+
+  // over-allocates and keeps the pointer returned by malloc just before
+  // the aligned address
+  static T* allocate(size_type n)
+  {
+    std::size_t const bytes = n*sizeof(T);
+    std::size_t const align = std::max(isHuge(n) ? std::max(Align, std::size_t(1) << 21) : Align, sizeof(void*));
+    char* raw = static_cast<char*>(std::malloc(bytes + align + sizeof(void*)));
+    if (!raw)
+      throw std::bad_alloc();
+    std::size_t const addr = reinterpret_cast<std::size_t>(raw + sizeof(void*));
+    char* p = reinterpret_cast<char*>((addr + align - 1) & ~(align - 1));
+    reinterpret_cast<void**>(p)[-1] = raw;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (isHuge(n))
+      madvise(p, bytes & ~((std::size_t(1) << 21) - 1), MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<T*>(p);
+  }
+
+  static void deallocate(T* p, size_type)
+  {
+    if (p)
+      std::free(reinterpret_cast<void**>(p)[-1]);
+  }
+};
+
+template<class T, std::size_t Align>
+inline void swap(AlignedBlock<T,Align>& a, AlignedBlock<T,Align>& b)
+{ a.swap(b); }
+
+
+// std::allocator whose construct(p) default-initializes instead of
+// value-initializing, so that resize(n) of a
+//
+//    std::vector<T, default_init_allocator<T> >
+//
+// leaves trivial elements uninitialized (C++11 only: before that,
+// std::vector::resize(n) copies a T()). Array value-initializes explicitly
+// with this block too; only the `uninitialized` constructors and reshapes
+// skip the fill.
+template<class T>
+class default_init_allocator : public std::allocator<T>
+{
+public:
+  template<class U>
+  struct rebind { typedef default_init_allocator<U> other; };
+
+  default_init_allocator() throw()
+  { }
+
+  default_init_allocator(default_init_allocator const& a) throw() : std::allocator<T>(a)
+  { }
+
+  template<class U>
+  default_init_allocator(default_init_allocator<U> const&) throw()
+  { }
+
+#if __cplusplus >= 201103L
+  template<class U>
+  void construct(U* p)
+  { ::new (static_cast<void*>(p)) U; }
+
+  template<class U, class... Args>
+  void construct(U* p, Args&&... args)
+  { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+#endif
+};
+
+} // end namespace
+
+#endif
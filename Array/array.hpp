@@ -10,8 +10,16 @@
 #define MULTI_ARRAY_HPP
 
 #include "listify.hpp"
+#include "simd.hpp"
+#include "aligned_block.hpp"
 #include <vector>
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#if __cplusplus >= 201103L
+#include <utility>
+#include <type_traits>
+#endif
 
 #include <ciso646>  // detect std::lib
 #ifdef _LIBCPP_VERSION
@@ -36,6 +44,18 @@ namespace marray {
 #define MA_DEFAULT_MAJOR RowMajor
 #endif
 
+// Largest rank handled by the rank-generic helpers (scratch index arrays).
+// In C++98 the rank is also limited to 10 by the macro-generated overloads.
+#ifndef MA_MAX_RANK
+#define MA_MAX_RANK 32
+#endif
+
+#if __cplusplus >= 201103L
+#define MA_CONSTEXPR constexpr
+#else
+#define MA_CONSTEXPR
+#endif
+
 namespace marray_internal {
 	template<bool, typename T = void>
 	struct EnableIf {};
@@ -50,7 +70,17 @@ namespace marray_internal {
 enum Options {
 
   RowMajor = 1 << 1,
-  ColMajor = 1 << 2
+  ColMajor = 1 << 2,
+
+  // row-major grid of row-major N-D tiles of side 4, 8 or 16: the
+  // neighbours of an element in every direction are mostly in its tile
+  Tiled4  = RowMajor | 2 << 3,
+  Tiled8  = RowMajor | 3 << 3,
+  Tiled16 = RowMajor | 4 << 3,
+
+  // Z-order curve: the bits of the indices interleaved, so that blocks of
+  // 2^k elements per rank are contiguous at every scale
+  Morton  = RowMajor | 1 << 7
 
 };
 
@@ -100,6 +130,57 @@ namespace internal
 #define MA_EXPAND_SEQ(N) MA_EXPAND_SEQ_(N)
 
 
+// to expand `class I0, class I1, class I2, ...`
+
+#define MA_EXPAND_TPARAMS1   class I0
+#define MA_EXPAND_TPARAMS2   MA_EXPAND_TPARAMS1, class I1
+#define MA_EXPAND_TPARAMS3   MA_EXPAND_TPARAMS2, class I2
+#define MA_EXPAND_TPARAMS4   MA_EXPAND_TPARAMS3, class I3
+#define MA_EXPAND_TPARAMS5   MA_EXPAND_TPARAMS4, class I4
+#define MA_EXPAND_TPARAMS6   MA_EXPAND_TPARAMS5, class I5
+#define MA_EXPAND_TPARAMS7   MA_EXPAND_TPARAMS6, class I6
+#define MA_EXPAND_TPARAMS8   MA_EXPAND_TPARAMS7, class I7
+#define MA_EXPAND_TPARAMS9   MA_EXPAND_TPARAMS8, class I8
+#define MA_EXPAND_TPARAMS10  MA_EXPAND_TPARAMS9, class I9
+
+#define MA_EXPAND_TPARAMS_(N) MA_EXPAND_TPARAMS##N
+#define MA_EXPAND_TPARAMS(N) MA_EXPAND_TPARAMS_(N)
+
+
+// to expand `I0 const& i0, I1 const& i1, I2 const& i2, ...`
+
+#define MA_EXPAND_TARGS1   I0 const& i0
+#define MA_EXPAND_TARGS2   MA_EXPAND_TARGS1, I1 const& i1
+#define MA_EXPAND_TARGS3   MA_EXPAND_TARGS2, I2 const& i2
+#define MA_EXPAND_TARGS4   MA_EXPAND_TARGS3, I3 const& i3
+#define MA_EXPAND_TARGS5   MA_EXPAND_TARGS4, I4 const& i4
+#define MA_EXPAND_TARGS6   MA_EXPAND_TARGS5, I5 const& i5
+#define MA_EXPAND_TARGS7   MA_EXPAND_TARGS6, I6 const& i6
+#define MA_EXPAND_TARGS8   MA_EXPAND_TARGS7, I7 const& i7
+#define MA_EXPAND_TARGS9   MA_EXPAND_TARGS8, I8 const& i8
+#define MA_EXPAND_TARGS10  MA_EXPAND_TARGS9, I9 const& i9
+
+#define MA_EXPAND_TARGS_(N) MA_EXPAND_TARGS##N
+#define MA_EXPAND_TARGS(N) MA_EXPAND_TARGS_(N)
+
+
+// to expand `I0, I1, I2, ...`
+
+#define MA_EXPAND_TSEQ1   I0
+#define MA_EXPAND_TSEQ2   MA_EXPAND_TSEQ1, I1
+#define MA_EXPAND_TSEQ3   MA_EXPAND_TSEQ2, I2
+#define MA_EXPAND_TSEQ4   MA_EXPAND_TSEQ3, I3
+#define MA_EXPAND_TSEQ5   MA_EXPAND_TSEQ4, I4
+#define MA_EXPAND_TSEQ6   MA_EXPAND_TSEQ5, I5
+#define MA_EXPAND_TSEQ7   MA_EXPAND_TSEQ6, I6
+#define MA_EXPAND_TSEQ8   MA_EXPAND_TSEQ7, I7
+#define MA_EXPAND_TSEQ9   MA_EXPAND_TSEQ8, I8
+#define MA_EXPAND_TSEQ10  MA_EXPAND_TSEQ9, I9
+
+#define MA_EXPAND_TSEQ_(N) MA_EXPAND_TSEQ##N
+#define MA_EXPAND_TSEQ(N) MA_EXPAND_TSEQ_(N)
+
+
   // for syntax sugar initialization
   template<typename UserT, typename IteratorT>
   class ListInitializer {
@@ -157,59 +238,269 @@ namespace internal
 
 
 
+  // contribution of the index i of rank r to the position, and its change
+  // when i is incremented
+  struct StridedTerm
+  {
+    template<class Stride, class Idx>
+    static Stride term(Stride const* strides, int r, Idx i)
+    { return (Stride)i * strides[r]; }
+
+    template<class Stride, class Idx>
+    static Stride step(Stride const* strides, int r, Idx)
+    { return strides[r]; }
+  };
+
+  // linear index as a dot product of indices and strides; the products are
+  // independent of each other, so the compiler is free to reassociate them
   template<int Rank>
-  struct RowMajIdxComputer
+  struct StridedIdxComputer : StridedTerm
   {
-    template<class Idx>
-    static std::size_t idx(std::size_t const* sizes, Idx const* indices)
+    template<class Stride, class Idx>
+    static MA_CONSTEXPR Stride idx(Stride const* strides, Idx const* indices)
     {
-      return RowMajIdxComputer<Rank-1>::idx(sizes, indices) * sizes[Rank-1]  + (std::size_t)indices[Rank-1];
+      return StridedIdxComputer<Rank-1>::idx(strides, indices) + (Stride)indices[Rank-1] * strides[Rank-1];
     }
   };
   template<>
-  struct RowMajIdxComputer<1>
+  struct StridedIdxComputer<1> : StridedTerm
   {
-    template<class Idx>
-    static std::size_t idx(std::size_t const*, Idx const* indices)
-    { return indices[0]; }
+    template<class Stride, class Idx>
+    static MA_CONSTEXPR Stride idx(Stride const* strides, Idx const* indices)
+    { return (Stride)indices[0] * strides[0]; }
   };
 
 
 
 
+  // computes the strides of a dense block from its dimensions; returns the
+  // number of elements
   template<int Rank>
-  struct ColMajIdxComputer
+  struct RowMajStrideComputer
   {
-    template<class Idx>
-    static std::size_t idx(std::size_t const* sizes, Idx const* indices)
+    template<class Dim, class Stride>
+    static std::size_t compute(Dim const* dims, Stride* strides)
     {
-      return (std::size_t)indices[0] + sizes[0]*ColMajIdxComputer<Rank-1>::idx(sizes+1, indices+1);
+      strides[Rank-1] = 1;
+      for (int i = Rank-1; i > 0; --i)
+        strides[i-1] = strides[i] * (Stride)dims[i];
+      return (std::size_t)strides[0] * dims[0];
     }
   };
-  template<>
-  struct ColMajIdxComputer<1>
+
+  template<int Rank>
+  struct ColMajStrideComputer
+  {
+    template<class Dim, class Stride>
+    static std::size_t compute(Dim const* dims, Stride* strides)
+    {
+      strides[0] = 1;
+      for (int i = 1; i < Rank; ++i)
+        strides[i] = strides[i-1] * (Stride)dims[i-1];
+      return (std::size_t)strides[Rank-1] * dims[Rank-1];
+    }
+  };
+
+
+  // log2 of the tile side of a tiled layout, 0 otherwise
+  template<Options O>
+  struct TileBitsOf { static const int value = (O >> 3) & 15; };
+
+  template<Options O>
+  struct IsMortonOf { static const bool value = (O >> 7) & 1; };
+
+  // true for the layouts where the position is a dot product of the
+  // indices and the strides (RowMajor, ColMajor)
+  template<Options O>
+  struct IsStridedLayout { static const bool value = !TileBitsOf<O>::value && !IsMortonOf<O>::value; };
+
+  // only Array (with a dynamic memory block) and Amaps have the tiled and
+  // Morton layouts; views, sparse and fixed-size arrays are strided
+  template<Options O, bool = IsStridedLayout<O>::value>
+  struct ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS;
+
+  template<Options O>
+  struct ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<O, true> {};
+
+  // sum of the terms of the first R ranks of the index computer C, unrolled
+  template<class C, int R>
+  struct SumOfTerms
+  {
+    template<class Stride, class Idx>
+    static Stride run(Stride const* strides, Idx const* indices)
+    { return SumOfTerms<C, R-1>::run(strides, indices) + C::term(strides, R-1, indices[R-1]); }
+  };
+
+  template<class C>
+  struct SumOfTerms<C, 1>
+  {
+    template<class Stride, class Idx>
+    static Stride run(Stride const* strides, Idx const* indices)
+    { return C::term(strides, 0, indices[0]); }
+  };
+
+  // Tiled layout: the dims are padded to multiples of the tile side 2^B,
+  // the tiles are stored one after the other in major order and the
+  // elements of a tile in the same order. `strides` are those of the grid
+  // of tiles, times the tile volume; the index within a tile is formed by
+  // packing the B low bits of each index.
+  template<int Rank, bool isRowMajor, int B>
+  struct TiledIdxComputer
+  {
+    static const std::ptrdiff_t mask = (1 << B) - 1;
+
+    // B*(position of rank r in the tile, from the fastest)
+    static int shift(int r)
+    { return B*(isRowMajor ? Rank-1-r : r); }
+
+    // contribution of index i of rank r to the position
+    template<class Stride, class Idx>
+    static Stride term(Stride const* strides, int r, Idx i)
+    { return (Stride)(i >> B) * strides[r] + (((Stride)i & mask) << shift(r)); }
+
+    // term(r, i+1) - term(r, i)
+    template<class Stride, class Idx>
+    static Stride step(Stride const* strides, int r, Idx i)
+    { return ((Stride)i & mask) != mask ? Stride(1) << shift(r) : strides[r] - (mask << shift(r)); }
+
+    template<class Stride, class Idx>
+    static Stride idx(Stride const* strides, Idx const* indices)
+    { return SumOfTerms<TiledIdxComputer, Rank>::run(strides, indices); }
+  };
+
+  // strides of the tile grid; returns the number of elements stored
+  template<int Rank, bool isRowMajor, int B>
+  struct TiledStrideComputer
   {
-    template<class Idx>
-    static std::size_t idx(std::size_t const*, Idx const* indices)
-    { return indices[0]; }
+    template<class Dim, class Stride>
+    static std::size_t compute(Dim const* dims, Stride* strides)
+    {
+      Stride n = Stride(1) << B*Rank;
+      for (int k = 0; k < Rank; ++k)
+      {
+        int const r = isRowMajor ? Rank-1-k : k;
+        strides[r] = n;
+        n *= ((Stride)dims[r] + (Stride(1) << B) - 1) >> B;
+      }
+      return n;
+    }
   };
 
 
+  // the low bits of x placed, in order, at the set bits of `mask` (the
+  // BMI2 instruction pdep)
+  inline std::size_t depositBits(std::size_t x, std::size_t mask)
+  {
+#if defined(MA_HAVE_SIMD) && defined(__BMI2__) && (defined(__x86_64__) || defined(_M_X64))
+    return _pdep_u64(x, mask);
+#elif defined(MA_HAVE_SIMD) && defined(__BMI2__)
+    return _pdep_u32(x, mask);
+#else
+    std::size_t r = 0;
+    for (; x; x >>= 1, mask &= mask - 1)
+      r |= mask & (~mask + 1) & (0 - (x & 1));
+    return r;
+#endif
+  }
+
+  // Morton (Z-order) layout: the bits of the indices are interleaved, from
+  // the lowest, so each aligned block of 2^k elements per rank is stored
+  // contiguously at every scale. A rank of dim d takes ceil(log2(d)) bits,
+  // and drops out of the interleaving once they are used up. `strides[r]`
+  // is the mask of the bits of the position that come from rank r.
+  template<int Rank>
+  struct MortonIdxComputer
+  {
+    template<class Stride, class Idx>
+    static Stride term(Stride const* strides, int r, Idx i)
+    { return (Stride)depositBits(i, strides[r]); }
+
+    // i+1 clears the trailing ones of i and sets the next bit: O(1) on
+    // average over consecutive indices, without pdep
+    template<class Stride, class Idx>
+    static Stride step(Stride const* strides, int r, Idx i)
+    {
+      Stride m = strides[r], cleared = 0;
+      for (; i & 1; i >>= 1, m &= m - 1)
+        cleared |= m & -m;
+      return (m & -m) - cleared;
+    }
+
+    template<class Stride, class Idx>
+    static Stride idx(Stride const* strides, Idx const* indices)
+    { return SumOfTerms<MortonIdxComputer, Rank>::run(strides, indices); }
+  };
+
+  // bit masks of the ranks (the fastest rank takes the lowest bit of each
+  // level); returns the number of elements stored, 2^(total bits), or
+  // size_t(-1) when the position would not fit in a Stride
   template<int Rank, bool isRowMajor>
-  struct IdxComputationTraits;
+  struct MortonStrideComputer
+  {
+    template<class Dim, class Stride>
+    static std::size_t compute(Dim const* dims, Stride* strides)
+    {
+      int bits[Rank], levels = 0, n = 0;
+      for (int r = 0; r < Rank; ++r)
+      {
+        strides[r] = 0;
+        if (dims[r] == 0)
+          return 0;
+        for (bits[r] = 0; bits[r] < 63 && (Dim(1) << bits[r]) < dims[r]; ++bits[r])
+        { }
+        levels = std::max(levels, bits[r]);
+        n += bits[r];
+      }
+      if (n >= (int)(8*sizeof(Stride)) - 1)
+        return std::size_t(-1);
+
+      n = 0;
+      for (int b = 0; b < levels; ++b)
+        for (int k = 0; k < Rank; ++k)
+        {
+          int const r = isRowMajor ? Rank-1-k : k;
+          if (b < bits[r])
+            strides[r] |= Stride(1) << n++;
+        }
+      return std::size_t(1) << n;
+    }
+  };
+
+
+  template<int Rank, bool isRowMajor, int TileBits = 0, bool isMorton = false>
+  struct IdxComputationTraits
+  {
+    typedef TiledIdxComputer<Rank, isRowMajor, TileBits>    type;
+    typedef TiledStrideComputer<Rank, isRowMajor, TileBits> StrideComputer;
+  };
 
   template<int Rank>
-  struct IdxComputationTraits<Rank, true>
+  struct IdxComputationTraits<Rank, true, 0, false>
   {
-    typedef RowMajIdxComputer<Rank> type;
+    typedef StridedIdxComputer<Rank>   type;
+    typedef RowMajStrideComputer<Rank> StrideComputer;
   };
 
   template<int Rank>
-  struct IdxComputationTraits<Rank, false>
+  struct IdxComputationTraits<Rank, false, 0, false>
+  {
+    typedef StridedIdxComputer<Rank>   type;
+    typedef ColMajStrideComputer<Rank> StrideComputer;
+  };
+
+  template<int Rank, bool isRowMajor, int TileBits>
+  struct IdxComputationTraits<Rank, isRowMajor, TileBits, true>
   {
-    typedef ColMajIdxComputer<Rank> type;
+    typedef MortonIdxComputer<Rank>                 type;
+    typedef MortonStrideComputer<Rank, isRowMajor>  StrideComputer;
   };
 
+  // the traits of the layout `O`
+  template<int Rank, Options O>
+  struct LayoutTraits
+    : IdxComputationTraits<Rank, (O & RowMajor) != 0, TileBitsOf<O>::value, IsMortonOf<O>::value>
+  { };
+
 #ifdef DEBUG
   template<int Rank>
   struct BoundCheck
@@ -248,6 +539,20 @@ namespace internal
       throw std::out_of_range (msg);
   }
 
+  // assert perm[0..Rank) is a permutation of 0, ..., Rank-1
+  template<int Rank, class P>
+  void assertPermutation(P const perm[], const char* msg)
+  {
+    bool seen[Rank] = {};
+    for (int k = 0; k < Rank; ++k)
+    {
+      int const p = (int)perm[k];
+      if (p < 0 || p >= Rank || seen[p])
+        throw std::out_of_range (msg);
+      seen[p] = true;
+    }
+  }
+
 #else
   template<int Rank>
   struct BoundCheck
@@ -262,9 +567,34 @@ namespace internal
   inline void assertTrue(...)
   { }
 
+  template<int Rank, class P>
+  void assertPermutation(P const*, const char*)
+  { }
+
 #endif
 
 
+#if __cplusplus >= 201103L
+  // true when every type of the pack converts to an index
+  template<class... I>
+  struct AreIndices
+  {
+    static const bool value = true;
+  };
+
+  template<class I0, class... I>
+  struct AreIndices<I0, I...>
+  {
+    static const bool value = Tr1::is_convertible<I0, std::size_t>::value && AreIndices<I...>::value;
+  };
+
+  // selects the variadic `operator()(i0, i1, ...)` and constructors only for
+  // index lists, so that they do not hide the overloads taking arrays
+  template<class... I>
+  struct IfIndices : marray_internal::EnableIf<AreIndices<I...>::value>
+  { };
+#endif
+
   template<bool isGreaterThan0>
   struct CheckRank;
 
@@ -299,103 +629,187 @@ template<class T>
 struct GetRef<T const&> { typedef typename T::const_reference type; };
 
 
-template<int Count, int Rank, class VecT, class S> // Count = Rank - 1
+// Element of the chain `A[i0][i1]...`: `S` is a reference to the array and
+// `Count` the number of brackets still to apply. Each bracket only adds
+// `i*stride` (its term in the layout) to a running offset, so the chain is
+// equivalent to the flat index `i0*stride0 + i1*stride1 + ...` once inlined.
+template<int Count, class S>
 struct Proxy
 {
-	VecT ids[Rank]; // indices
-	S a;
-  explicit Proxy(std::size_t i, S a_) : a(a_)
-	{
-		ids[0] = i;
-	}
-
-	typedef Proxy type;
-
-	typename Proxy<Count-1, Rank, void, S>::type operator[] (int i)
-	{
-		ids[1] = i;
-		return Proxy<Count-1, Rank, void, S>(ids,a);
-	}
-};
+  typedef typename Tr1::remove_reference<S>::type S_no_ref;
+  typedef typename S_no_ref::difference_type      difference_type;
+  typedef Proxy<Count-1, S>                       result;
 
-template<int Count, int Rank, class S> // Count = Rank - 1
-struct Proxy<Count, Rank, void, S>
-{
-	std::size_t* ids; // indices
-	S a;
-  explicit Proxy(std::size_t* i, S a_) : ids(i), a(a_)
-	{	}
-
-	typedef Proxy type;
-
-	typename Proxy<Count-1, Rank, void, S>::type operator[] (int i)
-	{
-		ids[Rank-Count] = i;
-		return Proxy<Count-1, Rank, void, S>(ids,a);
-	}
-};
+  static const int Rank = S_no_ref::Rank;
 
-//std::remove_reference
+  S               a;
+  difference_type off; // offset of the ranks already indexed
 
-template<int Rank, class S>
-struct Proxy<0, Rank, void, S>
-{
-	std::size_t* ids;
-  S a;
-	explicit Proxy(std::size_t* v, S a_) : ids(v), a(a_)
-	{ }
+  Proxy(S a_, difference_type off_) : a(a_), off(off_)
+  { }
+
+  result operator[] (std::size_t i) const
+  {
+    assertLess(i, a.rdims()[Rank-Count], "ERROR: Array<>: invalid index");
+    return result(a, off + S_no_ref::IdxComputer::term(a.rstrides(), Rank-Count, (difference_type)i));
+  }
+};
 
+// last rank: returns the element
+template<class S>
+struct Proxy<1, S>
+{
   typedef typename Tr1::remove_reference<S>::type S_no_ref;
+  typedef typename S_no_ref::difference_type      difference_type;
+  typedef typename GetRef<S>::type                result;
 
-  typedef typename GetRef<S>::type type;
+  static const int Rank = S_no_ref::Rank;
 
-	operator type()
+  S               a;
+  difference_type off;
+
+  Proxy(S a_, difference_type off_) : a(a_), off(off_)
+  { }
+
+  result operator[] (std::size_t i) const
   {
-    typedef typename internal::IdxComputationTraits<Rank, S_no_ref::isRowMajor>::type ToGlobal;
-    return a.access( ToGlobal::idx(a.rdims(), ids) );
-	}
+    assertLess(i, a.rdims()[Rank-1], "ERROR: Array<>: invalid index");
+    return a.access(off + S_no_ref::IdxComputer::term(a.rstrides(), Rank-1, (difference_type)i));
+  }
 };
 
-template<int Rank, class VecT, class S>
-struct Proxy<0, Rank, VecT, S>
-{
-	VecT ids[Rank];
-  S a;
-	explicit Proxy(std::size_t i, S a_) : a(a_)
-	{ ids[0] = i;	}
 
-  typedef typename Tr1::remove_reference<S>::type S_no_ref;
+} // end internal
+
 
-  typedef typename GetRef<S>::type type;
 
-	operator type()
+
+template<typename Derived, int P_rank, Options P_opts>
+class ArrayBase;
+
+template<typename P_type, int P_rank, Options P_opts>
+class ArrayView;
+
+
+namespace internal
+{
+  // base of everything that can appear in an elementwise expression:
+  // ArrayBase and the expression nodes (see the end of this file)
+  template<class E>
+  struct ExprBase
   {
-    typedef typename internal::IdxComputationTraits<Rank, S_no_ref::isRowMajor>::type ToGlobal;
-    return a.access( ToGlobal::idx(a.rdims(), ids) );
-	}
+    E const& derived() const
+    { return static_cast<E const&>(*this); }
+  };
+
+  template<class Derived, int Rank, Options Opts, class E>
+  void assignExpr(ArrayBase<Derived,Rank,Opts>& dst, ExprBase<E> const& expr);
+
+  template<class Src, class Dst>
+  void copyFlat(Src const& src, Dst& dst);
+
+  template<int Rank>
+  void nextIndex(std::size_t idx[], std::size_t const dims[], bool isRowMajor);
+
+  template<class E>
+  struct ExprLeaf;
+
+  template<class Derived>
+  class NdIterator;
+}
 
+
+// half-open range [first, last) with step `step`, used in `slice()`;
+// the default-constructed range selects the whole rank
+struct range
+{
+  std::size_t first, last, step;
+  bool        all;
+
+  range() : first(0), last(0), step(1), all(true)
+  { }
+
+  range(std::size_t first_, std::size_t last_, std::size_t step_ = 1)
+    : first(first_), last(last_), step(step_), all(false)
+  { }
 };
 
 
+namespace internal
+{
+  template<class T> struct IsRange { static const int value = 0; };
+  template<> struct IsRange<range> { static const int value = 1; };
 
+  // rank of a slice = number of `range` arguments
+#if __cplusplus >= 201103L
+  template<class... I>
+  struct SliceRank
+  {
+    static const int value = 0;
+  };
 
-} // end internal
+  template<class I0, class... I>
+  struct SliceRank<I0, I...>
+  {
+    static const int value = IsRange<I0>::value + SliceRank<I...>::value;
+  };
+#else
+  template<class I0, class I1 = void, class I2 = void, class I3 = void, class I4 = void,
+           class I5 = void, class I6 = void, class I7 = void, class I8 = void, class I9 = void>
+  struct SliceRank
+  {
+    static const int value = IsRange<I0>::value + IsRange<I1>::value + IsRange<I2>::value + IsRange<I3>::value
+                           + IsRange<I4>::value + IsRange<I5>::value + IsRange<I6>::value + IsRange<I7>::value
+                           + IsRange<I8>::value + IsRange<I9>::value;
+  };
+#endif
 
+  // a `slice()` argument: a range or a fixed index
+  struct SliceArg
+  {
+    range r;
+    bool  fixed;
 
+    SliceArg(range const& r_) : r(r_), fixed(false)
+    { }
 
+    SliceArg(std::size_t i) : r(i, i+1), fixed(true)
+    { }
+  };
 
-template<typename Derived, int P_rank, Options P_opts>
-class ArrayBase;
+  // computes dims and strides of the slice, returns the offset of its first element
+  template<int Rank>
+  std::ptrdiff_t sliceLayout(std::size_t const* dims, std::ptrdiff_t const* strides, SliceArg const* args,
+                             std::size_t* vdims, std::ptrdiff_t* vstrides)
+  {
+    std::ptrdiff_t offset = 0;
+    for (int i = 0, k = 0; i < Rank; ++i)
+    {
+      range r = args[i].r;
+      if (r.all)
+        r = range(0, dims[i]);
+      assertTrue(r.step > 0, "**ERROR**: slice(): step must be greater than 0");
+      assertTrue(r.first <= r.last && r.last <= dims[i], "**ERROR**: slice(): invalid range");
+      assertTrue(!args[i].fixed || r.first < dims[i], "**ERROR**: slice(): invalid index");
+
+      offset += (std::ptrdiff_t)r.first * strides[i];
+      if (args[i].fixed)
+        continue;
+      vdims[k] = (r.last - r.first + r.step - 1) / r.step;
+      vstrides[k] = (std::ptrdiff_t)r.step * strides[i];
+      ++k;
+    }
+    return offset;
+  }
+}
 
 #if !defined(THIS) && !defined(CONST_THIS)
   #define THIS static_cast<Derived*>(this)
   #define CONST_THIS static_cast<const Derived*>(this)
 #endif
 
-#define IMPLEMENT_BASE(P_rank)                                                                \
-template<typename Derived, Options P_opts>                                                    \
-class ArrayBase<Derived, P_rank, P_opts>                                                      \
-{                                                                                             \
+// members of ArrayBase that do not depend on the number of indices
+#define MA_ARRAY_BASE_BODY(P_rank)                                                            \
                                                                                               \
   typedef internal::Traits<Derived> Traits_Derived;                                           \
   typedef ArrayBase Self;                                                                     \
@@ -405,6 +819,9 @@ public:
   static const int Rank = P_rank;                                                             \
   static const bool isRowMajor = P_opts & RowMajor;                                           \
                                                                                               \
+  /* maps a multi-index to the argument of `access()` (see IdxComputationTraits) */            \
+  typedef typename internal::LayoutTraits<Rank, P_opts>::type IdxComputer;                    \
+                                                                                              \
   typedef typename Traits_Derived::reference        reference;                                \
   typedef typename Traits_Derived::const_reference  const_reference;                          \
   typedef typename Traits_Derived::iterator         iterator;                                 \
@@ -415,40 +832,14 @@ public:
   typedef typename Traits_Derived::const_pointer    const_pointer;                            \
                                                                                               \
                                                                                               \
-  reference operator() (MA_EXPAND_ARGS(P_rank, size_type))                                    \
-  {                                                                                           \
-    MA_STATIC_CHECK(Rank==P_rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);                         \
-                                                                                              \
-    size_type const indices[] = {MA_EXPAND_SEQ(P_rank)};                                      \
-                                                                                              \
-    internal::BoundCheck<Rank>::check(THIS->rdims(), indices);                                \
-                                                                                              \
-    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::type ToGlobal;         \
-                                                                                              \
-    return THIS->access( ToGlobal::idx(THIS->rdims(), indices) );                             \
-  }                                                                                           \
-                                                                                              \
   template<class Idx_t>                                                                       \
   reference operator() (Idx_t const indices[])                                                \
   {                                                                                           \
     internal::BoundCheck<Rank>::check(THIS->rdims(), indices);                                \
                                                                                               \
-    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::type ToGlobal;         \
-                                                                                              \
-    return THIS->access( ToGlobal::idx(THIS->rdims(), indices) );                             \
-  }                                                                                           \
-                                                                                              \
-  const_reference operator() (MA_EXPAND_ARGS(P_rank, size_type)) const                        \
-  {                                                                                           \
-    MA_STATIC_CHECK(Rank==P_rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);                         \
-                                                                                              \
-    size_type const indices[] = {MA_EXPAND_SEQ(P_rank)};                                      \
-                                                                                              \
-    internal::BoundCheck<Rank>::check(CONST_THIS->rdims(), indices);                          \
-                                                                                              \
-    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::type ToGlobal;         \
+    typedef IdxComputer ToGlobal;                                                             \
                                                                                               \
-    return CONST_THIS->access( ToGlobal::idx(CONST_THIS->rdims(), indices) );                 \
+    return THIS->access( ToGlobal::idx(THIS->rstrides(), indices) );                          \
   }                                                                                           \
                                                                                               \
   template<class Idx_t>                                                                       \
@@ -456,22 +847,23 @@ public:
   {                                                                                           \
     internal::BoundCheck<Rank>::check(CONST_THIS->rdims(), indices);                          \
                                                                                               \
-    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::type ToGlobal;         \
+    typedef IdxComputer ToGlobal;                                                             \
                                                                                               \
-    return CONST_THIS->access( ToGlobal::idx(CONST_THIS->rdims(), indices) );                 \
+    return CONST_THIS->access( ToGlobal::idx(CONST_THIS->rstrides(), indices) );              \
   }                                                                                           \
                                                                                               \
-	typename internal::Proxy<Rank-1,Rank,size_type,Self&>::type                                 \
-	operator[] (size_type i)                                                                    \
-	{                                                                                           \
-		return internal::Proxy<Rank-1,Rank,size_type,Self&>(i, *this);                            \
-	}                                                                                           \
+  /* C-style access, A[i][j][k] */                                                            \
+  typename internal::Proxy<P_rank,Self&>::result                                              \
+  operator[] (size_type i)                                                                    \
+  {                                                                                           \
+    return internal::Proxy<P_rank,Self&>(*this, 0)[i];                                        \
+  }                                                                                           \
                                                                                               \
-	typename internal::Proxy<Rank-1,Rank,size_type,Self const&>::type                           \
-	operator[] (size_type i) const                                                              \
-	{                                                                                           \
-		return internal::Proxy<Rank-1,Rank,size_type,Self const&>(i, *this);                      \
-	}                                                                                           \
+  typename internal::Proxy<P_rank,Self const&>::result                                        \
+  operator[] (size_type i) const                                                              \
+  {                                                                                           \
+    return internal::Proxy<P_rank,Self const&>(*this, 0)[i];                                  \
+  }                                                                                           \
                                                                                               \
                                                                                               \
   inline                                                                                      \
@@ -482,12 +874,12 @@ public:
   const_reference access(size_type i) const                                                   \
   { return CONST_THIS->access(i);}                                                            \
                                                                                               \
-  size_type* rdims()                                                                          \
-  { return THIS->rdims(); }                                                                   \
-                                                                                              \
   size_type const* rdims() const                                                              \
   { return CONST_THIS->rdims(); }                                                             \
                                                                                               \
+  difference_type const* rstrides() const                                                     \
+  { return CONST_THIS->rstrides(); }                                                          \
+                                                                                              \
   size_type maxDim() const                                                                    \
   {                                                                                           \
     int m = 0;                                                                                \
@@ -497,84 +889,270 @@ public:
     return m;                                                                                 \
   }                                                                                           \
                                                                                               \
+  /* iterators that keep the multi-index, in major order (see NdIterator) */                  \
+  typedef internal::NdIterator<Derived>       nd_iterator;                                    \
+  typedef internal::NdIterator<Derived const> const_nd_iterator;                              \
                                                                                               \
+  nd_iterator ndbegin()                                                                       \
+  { return nd_iterator(*THIS, THIS->rdims(), THIS->rstrides(), false); }                      \
                                                                                               \
+  nd_iterator ndend()                                                                         \
+  { return nd_iterator(*THIS, THIS->rdims(), THIS->rstrides(), true); }                       \
                                                                                               \
-};
-
-
-IMPLEMENT_BASE(1)
-IMPLEMENT_BASE(2)
-IMPLEMENT_BASE(3)
-IMPLEMENT_BASE(4)
-IMPLEMENT_BASE(5)
-IMPLEMENT_BASE(6)
-IMPLEMENT_BASE(7)
-IMPLEMENT_BASE(8)
-IMPLEMENT_BASE(9)
-IMPLEMENT_BASE(10)
+  const_nd_iterator ndbegin() const                                                           \
+  { return const_nd_iterator(*CONST_THIS, CONST_THIS->rdims(), CONST_THIS->rstrides(), false); } \
+                                                                                              \
+  const_nd_iterator ndend() const                                                             \
+  { return const_nd_iterator(*CONST_THIS, CONST_THIS->rdims(), CONST_THIS->rstrides(), true); } \
+                                                                                              \
+  /* non-owning strided view over the same storage (requires `data()`) */                     \
+  ArrayView<UserT, P_rank, P_opts> view()                                                     \
+  {                                                                                           \
+    return ArrayView<UserT, P_rank, P_opts>(THIS->data(), THIS->rdims(), THIS->rstrides());   \
+  }                                                                                           \
+                                                                                              \
+  ArrayView<UserT const, P_rank, P_opts> view() const                                         \
+  {                                                                                           \
+    return ArrayView<UserT const, P_rank, P_opts>(CONST_THIS->data(), CONST_THIS->rdims(),    \
+                                                  CONST_THIS->rstrides());                    \
+  }
 
-#undef IMPLEMENT_BASE
 
+#if __cplusplus >= 201103L
 
-#undef THIS
-#undef CONST_THIS
+// C++11: a single class for every rank, with variadic index lists
+template<typename Derived, int P_rank, Options P_opts>
+class ArrayBase
+  : public internal::ExprBase<ArrayBase<Derived, P_rank, P_opts> >
+{
+  static_assert(P_rank >= 1 && P_rank <= MA_MAX_RANK, "**ERROR**: ArrayBase<>: invalid rank");
 
-//              db
-//             d88b
-//            d8'`8b
-//           d8'  `8b     8b,dPPYba, 8b,dPPYba, ,adPPYYba, 8b       d8
-//          d8YaaaaY8b    88P'   "Y8 88P'   "Y8 ""     `Y8 `8b     d8'
-//         d8""""""""8b   88         88         ,adPPPPP88  `8b   d8'
-//        d8'        `8b  88         88         88,    ,88   `8b,d8'
-//       d8'          `8b 88         88         `"8bbdP"Y8     Y88'
-//                                                             d8'
-//                                                            d8'
+  MA_ARRAY_BASE_BODY(P_rank)
 
-template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR, typename P_MemBlock = std::vector<P_type> >
-class GenericN : public P_MemBlock, public ArrayBase<GenericN<P_type, P_rank, P_opts, P_MemBlock>, P_rank, P_opts>
-{
-protected:
-  typedef P_MemBlock                        Base1;
-  typedef ArrayBase<GenericN,P_rank,P_opts> Base2;
+  template<class... Idx, class = typename internal::IfIndices<Idx...>::type>
+  reference operator() (Idx... i)
+  {
+    MA_STATIC_CHECK(sizeof...(Idx) == Rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);
 
-  typedef typename Base2::reference reference;
-  typedef typename Base2::const_reference const_reference;
-  typedef typename Base2::size_type size_type;
+    size_type const indices[] = {size_type(i)...};
 
-  friend class ArrayBase<GenericN,P_rank,P_opts>;
+    internal::BoundCheck<Rank>::check(THIS->rdims(), indices);
 
-//  using P_MemBlock::m_data;
+    typedef IdxComputer ToGlobal;
 
-public:
+    return THIS->access( ToGlobal::idx(THIS->rstrides(), indices) );
+  }
 
-  typedef P_type UserT;
-  static const int Rank = Base2::Rank;
-  static const bool isRowMajor = Base2::isRowMajor;
+  template<class... Idx, class = typename internal::IfIndices<Idx...>::type>
+  const_reference operator() (Idx... i) const
+  {
+    MA_STATIC_CHECK(sizeof...(Idx) == Rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);
 
-protected:
-  size_type m_rdims[Rank];   // size of each rank
+    size_type const indices[] = {size_type(i)...};
 
-  // user can't use this
-  using Base1::resize;
+    internal::BoundCheck<Rank>::check(CONST_THIS->rdims(), indices);
 
-public:
-  using Base2::operator[];
+    typedef IdxComputer ToGlobal;
 
-  GenericN() : Base1(), Base2(), m_rdims() {};
-  //Array(Array const& ) = default;
-  //Array& operator<< (Array const&) = default;
+    return CONST_THIS->access( ToGlobal::idx(CONST_THIS->rstrides(), indices) );
+  }
 
-  int rank() const
-  { return Rank; }
+  // e.g. `A.slice(range(2,10), 5, range(0,n,2))`: one argument per rank, each
+  // a `range` or a fixed index; the result has one rank per `range` argument
+  template<class... I>
+  ArrayView<UserT, internal::SliceRank<I...>::value, P_opts>
+  slice(I const&... i)
+  {
+    MA_STATIC_CHECK(sizeof...(I) == Rank, INVALID_NUMBER_OF_ARGS_IN_SLICE);
+    typedef ArrayView<UserT, internal::SliceRank<I...>::value, P_opts> V;
+    internal::SliceArg const args[] = {i...};
+    size_type       vdims[V::Rank];
+    difference_type vstrides[V::Rank];
+    difference_type const offset = internal::sliceLayout<Rank>(THIS->rdims(),
+                                     THIS->rstrides(), args, vdims, vstrides);
+    return V(THIS->data() + offset, vdims, vstrides);
+  }
 
-  size_type dim(size_type r) const
+  template<class... I>
+  ArrayView<UserT const, internal::SliceRank<I...>::value, P_opts>
+  slice(I const&... i) const
+  {
+    MA_STATIC_CHECK(sizeof...(I) == Rank, INVALID_NUMBER_OF_ARGS_IN_SLICE);
+    typedef ArrayView<UserT const, internal::SliceRank<I...>::value, P_opts> V;
+    internal::SliceArg const args[] = {i...};
+    size_type       vdims[V::Rank];
+    difference_type vstrides[V::Rank];
+    difference_type const offset = internal::sliceLayout<Rank>(CONST_THIS->rdims(),
+                                     CONST_THIS->rstrides(), args, vdims, vstrides);
+    return V(CONST_THIS->data() + offset, vdims, vstrides);
+  }
+};
+
+#else
+
+// C++98: one specialization per rank, up to 10
+#define MA_ARRAY_BASE_FIXED_ARITY(P_rank)                                                     \
+  reference operator() (MA_EXPAND_ARGS(P_rank, size_type))                                    \
+  {                                                                                           \
+    MA_STATIC_CHECK(Rank==P_rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);                         \
+                                                                                              \
+    size_type const indices[] = {MA_EXPAND_SEQ(P_rank)};                                      \
+                                                                                              \
+    internal::BoundCheck<Rank>::check(THIS->rdims(), indices);                                \
+                                                                                              \
+    typedef IdxComputer ToGlobal;                                                             \
+                                                                                              \
+    return THIS->access( ToGlobal::idx(THIS->rstrides(), indices) );                          \
+  }                                                                                           \
+                                                                                              \
+  const_reference operator() (MA_EXPAND_ARGS(P_rank, size_type)) const                        \
+  {                                                                                           \
+    MA_STATIC_CHECK(Rank==P_rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);                         \
+                                                                                              \
+    size_type const indices[] = {MA_EXPAND_SEQ(P_rank)};                                      \
+                                                                                              \
+    internal::BoundCheck<Rank>::check(CONST_THIS->rdims(), indices);                          \
+                                                                                              \
+    typedef IdxComputer ToGlobal;                                                             \
+                                                                                              \
+    return CONST_THIS->access( ToGlobal::idx(CONST_THIS->rstrides(), indices) );              \
+  }                                                                                           \
+                                                                                              \
+  /* e.g. `A.slice(range(2,10), 5, range(0,n,2))`: one argument per rank, each */             \
+  /* a `range` or a fixed index; the result has one rank per `range` argument  */             \
+  template<MA_EXPAND_TPARAMS(P_rank)>                                                         \
+  ArrayView<UserT, internal::SliceRank<MA_EXPAND_TSEQ(P_rank)>::value, P_opts>                \
+  slice(MA_EXPAND_TARGS(P_rank))                                                              \
+  {                                                                                           \
+    typedef ArrayView<UserT, internal::SliceRank<MA_EXPAND_TSEQ(P_rank)>::value, P_opts> V;   \
+    internal::SliceArg const args[] = {MA_EXPAND_SEQ(P_rank)};                                \
+    size_type       vdims[V::Rank];                                                           \
+    difference_type vstrides[V::Rank];                                                        \
+    difference_type const offset = internal::sliceLayout<Rank>(THIS->rdims(),                 \
+                                     THIS->rstrides(), args, vdims, vstrides);                \
+    return V(THIS->data() + offset, vdims, vstrides);                                         \
+  }                                                                                           \
+                                                                                              \
+  template<MA_EXPAND_TPARAMS(P_rank)>                                                         \
+  ArrayView<UserT const, internal::SliceRank<MA_EXPAND_TSEQ(P_rank)>::value, P_opts>          \
+  slice(MA_EXPAND_TARGS(P_rank)) const                                                        \
+  {                                                                                           \
+    typedef ArrayView<UserT const, internal::SliceRank<MA_EXPAND_TSEQ(P_rank)>::value,        \
+                      P_opts> V;                                                              \
+    internal::SliceArg const args[] = {MA_EXPAND_SEQ(P_rank)};                                \
+    size_type       vdims[V::Rank];                                                           \
+    difference_type vstrides[V::Rank];                                                        \
+    difference_type const offset = internal::sliceLayout<Rank>(CONST_THIS->rdims(),           \
+                                     CONST_THIS->rstrides(), args, vdims, vstrides);          \
+    return V(CONST_THIS->data() + offset, vdims, vstrides);                                   \
+  }
+
+#define IMPLEMENT_BASE(P_rank)                                                                \
+template<typename Derived, Options P_opts>                                                    \
+class ArrayBase<Derived, P_rank, P_opts>                                                      \
+  : public internal::ExprBase<ArrayBase<Derived, P_rank, P_opts> >                            \
+{                                                                                             \
+  MA_ARRAY_BASE_BODY(P_rank)                                                                  \
+  MA_ARRAY_BASE_FIXED_ARITY(P_rank)                                                           \
+};
+
+
+IMPLEMENT_BASE(1)
+IMPLEMENT_BASE(2)
+IMPLEMENT_BASE(3)
+IMPLEMENT_BASE(4)
+IMPLEMENT_BASE(5)
+IMPLEMENT_BASE(6)
+IMPLEMENT_BASE(7)
+IMPLEMENT_BASE(8)
+IMPLEMENT_BASE(9)
+IMPLEMENT_BASE(10)
+
+#undef IMPLEMENT_BASE
+#undef MA_ARRAY_BASE_FIXED_ARITY
+
+#endif
+
+#undef MA_ARRAY_BASE_BODY
+
+
+#undef THIS
+#undef CONST_THIS
+
+//              db
+//             d88b
+//            d8'`8b
+//           d8'  `8b     8b,dPPYba, 8b,dPPYba, ,adPPYYba, 8b       d8
+//          d8YaaaaY8b    88P'   "Y8 88P'   "Y8 ""     `Y8 `8b     d8'
+//         d8""""""""8b   88         88         ,adPPPPP88  `8b   d8'
+//        d8'        `8b  88         88         88,    ,88   `8b,d8'
+//       d8'          `8b 88         88         `"8bbdP"Y8     Y88'
+//                                                             d8'
+//                                                            d8'
+
+template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR, typename P_MemBlock = std::vector<P_type> >
+class GenericN : public P_MemBlock, public ArrayBase<GenericN<P_type, P_rank, P_opts, P_MemBlock>, P_rank, P_opts>
+{
+protected:
+  typedef P_MemBlock                        Base1;
+  typedef ArrayBase<GenericN,P_rank,P_opts> Base2;
+
+  typedef typename Base2::reference reference;
+  typedef typename Base2::const_reference const_reference;
+  typedef typename Base2::size_type size_type;
+  typedef typename Base2::difference_type difference_type;
+
+  friend class ArrayBase<GenericN,P_rank,P_opts>;
+
+//  using P_MemBlock::m_data;
+
+public:
+
+  typedef P_type UserT;
+  static const int Rank = Base2::Rank;
+  static const bool isRowMajor = Base2::isRowMajor;
+
+protected:
+  size_type       m_rdims[Rank];   // size of each rank
+  difference_type m_strides[Rank]; // distance between consecutive indices of each rank
+
+  // user can't use this
+  using Base1::resize;
+
+public:
+  using Base2::operator[];
+
+  GenericN() : Base1(), Base2(), m_rdims(), m_strides() {};
+  //Array(Array const& ) = default;
+  //Array& operator<< (Array const&) = default;
+
+  // O(1) for std::vector-like blocks: exchanges the buffers, not the elements
+  void swap(GenericN& x)
+  {
+    Base1::swap(x);
+    std::swap_ranges(m_rdims, m_rdims+Rank, x.m_rdims);
+    std::swap_ranges(m_strides, m_strides+Rank, x.m_strides);
+  }
+
+  int rank() const
+  { return Rank; }
+
+  size_type dim(size_type r) const
   {
     internal::assertTrue(r < (size_type)Rank, "**ERROR**: Array<>: invalid index in function `size()`");
     return m_rdims[r];
   }
+  // number of elements; a tiled layout stores more (the padding of the
+  // tiles on the edges), which `begin()`/`end()` walk as well
   size_type size() const
-  { return Base1::size(); }
+  {
+    if (internal::IsStridedLayout<P_opts>::value)
+      return Base1::size();
+    size_type n = 1;
+    for (int r = 0; r < Rank; ++r)
+      n *= m_rdims[r];
+    return n;
+  }
 
 
 
@@ -603,9 +1181,32 @@ protected:
   size_type const* rdims() const
   { return m_rdims; }
 
+  // vector with rank strides
+  difference_type* rstrides()
+  { return m_strides; }
+
+  difference_type const* rstrides() const
+  { return m_strides; }
+
+  // returns the number of elements to store
+  size_type updateStrides()
+  {
+    typedef typename internal::LayoutTraits<Rank, P_opts>::StrideComputer StrideComputer;
+    return StrideComputer::compute(m_rdims, m_strides);
+  }
+
 };
 
 
+// Tag for the constructors and reshapes that leave the elements
+// uninitialized if the memory block allows it, e.g.
+// `Array<double,3,RowMajor,AlignedBlock<double> > A(uninitialized, n,n,n);`
+// (the default std::vector block still zero-fills). Only for trivially
+// constructible types; meant for arrays that are about to be overwritten
+// (I/O, kernels).
+struct uninitialized_t {};
+static const uninitialized_t uninitialized = uninitialized_t();
+
 namespace internal
 {
   template<class T>
@@ -614,6 +1215,112 @@ namespace internal
   template<class T, std::size_t N>
   struct IsStaticArray<T[N]> { static const bool value = 1;};
 
+  template<class T>
+  struct IsTriviallyConstructible
+#if __cplusplus >= 201103L
+    : std::is_trivially_default_constructible<T>
+#else
+    : Tr1::is_pod<T>
+#endif
+  { };
+
+  // resizes a memory block without initializing the new elements when
+  // `isTrivial` and the block supports it (AlignedBlock, and std::vector
+  // with default_init_allocator in C++11); a std::vector with the default
+  // allocator has no such operation and value-initializes them
+  template<class M, bool isTrivial>
+  struct ResizeUninitialized
+  {
+    static void run(M& m, std::size_t n)
+    { m.resize(n, typename M::value_type()); }
+  };
+
+  template<class T, std::size_t Al>
+  struct ResizeUninitialized<AlignedBlock<T,Al>, true>
+  {
+    static void run(AlignedBlock<T,Al>& m, std::size_t n)
+    { m.resize_uninitialized(n); }
+  };
+
+  template<class T>
+  struct ResizeUninitialized<std::vector<T, default_init_allocator<T> >, true>
+  {
+    // construct(p) of the allocator default-initializes
+    static void run(std::vector<T, default_init_allocator<T> >& m, std::size_t n)
+    { m.resize(n); }
+  };
+
+  // Moves, in place, the elements of a compact block laid out with dims
+  // `from` to the position they take with dims `to` (both listed from the
+  // slowest to the fastest rank); the positions of `to` outside `from`
+  // get UserT(). Safe in ascending order when `to` <= `from` in every
+  // rank, and in descending order when `to` >= `from`.
+  template<class Derived>
+  void relayout(Derived& a, std::size_t const from[], std::size_t const to[], int rank, bool ascending)
+  {
+    typedef typename Derived::UserT UserT;
+
+    std::size_t n = 1;
+    std::size_t idx[MA_MAX_RANK];
+    for (int k = 0; k < rank; ++k)
+    {
+      n *= to[k];
+      idx[k] = ascending ? 0 : to[k]-1;
+    }
+
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      std::size_t pf = 0, pt = 0;
+      bool inside = true;
+      for (int k = 0; k < rank; ++k)
+      {
+        inside = inside && idx[k] < from[k];
+        pf = pf*from[k] + idx[k];
+        pt = pt*to[k] + idx[k];
+      }
+      if (!inside)
+        a.access(pt) = UserT();
+      else if (pf != pt)
+        a.access(pt) = a.access(pf);
+
+      for (int k = rank-1; k >= 0; --k)
+      {
+        if (ascending)
+        {
+          if (++idx[k] < to[k])
+            break;
+          idx[k] = 0;
+        }
+        else
+        {
+          if (idx[k]-- > 0)
+            break;
+          idx[k] = to[k]-1;
+        }
+      }
+    }
+  }
+
+  // the dims of `a` and `new_dims`, their minimum, in major order (slowest
+  // rank first); returns true if only the slowest rank changes
+  template<int Rank, class T>
+  bool preserveDims(std::size_t const dims[], T const new_dims[], bool isRowMajor,
+                    std::size_t od[], std::size_t md[], std::size_t nd[])
+  {
+    bool slowestOnly = true;
+    for (int k = 0; k < Rank; ++k)
+    {
+      int const r = isRowMajor ? k : Rank-1-k;
+      assertTrue(new_dims[r] > 0, "**ERROR**: Array<>: dimension must be greater than 0");
+      od[k] = dims[r];
+      nd[k] = new_dims[r];
+      md[k] = std::min(od[k], nd[k]);
+      if (k > 0 && od[k] != nd[k])
+        slowestOnly = false;
+    }
+    return slowestOnly;
+  }
+
 }
 
 template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR, typename P_MemBlock = std::vector<P_type>, bool hasSizeLimit = internal::IsStaticArray<P_MemBlock>::value >
@@ -645,17 +1352,39 @@ public:
 
   Array() {};
 
+#if __cplusplus >= 201103L
+  Array(Array const&) = default;
+  Array& operator=(Array const&) = default;
+
+  // takes the buffer of `x`, which is left empty
+  Array(Array&& x) noexcept(std::is_nothrow_move_constructible<P_MemBlock>::value)
+    : Base0(std::move(x))
+  { x.clear(); }
+
+  Array& operator=(Array&& x) noexcept(std::is_nothrow_move_assignable<P_MemBlock>::value)
+  {
+    if (this != &x)
+    {
+      Base0::operator=(std::move(x));
+      x.clear();
+    }
+    return *this;
+  }
+#endif
+
   internal::ListInitializationSwitch<UserT, UserT*> operator<<(const_reference x)
   {
+    MA_STATIC_CHECK(internal::IsStridedLayout<P_opts>::value, LIST_INITIALIZATION_REQUIRES_A_STRIDED_LAYOUT);
     return internal::ListInitializationSwitch<UserT, UserT*>(this->data(), x);
   }
 
   template<typename Q_MemBlock, bool Q_hasSizeLimit>
   Array(Array<UserT,Rank,Opts,Q_MemBlock,Q_hasSizeLimit> const& x)
   {
-    this->resize(x.size());
-    std::copy(x.begin(), x.end(), this->begin());
     std::copy(x.rdims(), x.rdims()+Rank, Base0::rdims());
+    size_type const n = Base0::updateStrides();
+    internal::ResizeUninitialized<P_MemBlock, internal::IsTriviallyConstructible<UserT>::value>::run(*this, n);
+    internal::copyFlat(x, *this);
   }
 
   template<class T>
@@ -666,16 +1395,38 @@ public:
   Array(T const new_dims[])
   { reshape(new_dims); }
 
+  template<class T>
+  Array(uninitialized_t, T const new_dims[])
+  { reshape_uninitialized(new_dims); }
+
+  // evaluates an elementwise expression, e.g. `Array<double,3> C = a*A + B;`
+  template<class E>
+  Array(internal::ExprBase<E> const& e)
+  { *this = e; }
+
+  template<class E>
+  Array& operator=(internal::ExprBase<E> const& e)
+  {
+    typedef typename internal::ExprLeaf<E>::type Expr;
+    MA_STATIC_CHECK(Expr::Rank == Rank, INVALID_RANK_IN_EXPRESSION_ASSIGNMENT);
+    Expr const x(e.derived());
+    size_type new_dims[Rank];
+    for (int i = 0; i < Rank; ++i)
+      new_dims[i] = x.dim(i);
+    reshapeForOverwrite(new_dims);
+    internal::assignExpr(*this, e);
+    return *this;
+  }
+
   template<class T>
   void reshape(T const new_dims[], UserT val)
   {
-    size_type new_size = 1;
     for (int i = 0; i < Rank; ++i)
     {
       internal::assertTrue(new_dims[i] > 0, "**ERROR**: Array<>: dimension must be greater than 0");
       Base0::m_rdims[i] = new_dims[i];
-      new_size *= new_dims[i];
     }
+    size_type const new_size = Base0::updateStrides();
 
     this->resize(new_size, val);
   }
@@ -683,15 +1434,48 @@ public:
   template<class T>
   void reshape(T const new_dims[])
   {
-    size_type new_size = 1;
     for (int i = 0; i < Rank; ++i)
     {
       internal::assertTrue(new_dims[i] > 0, "**ERROR**: Array<>: dimension must be greater than 0");
       Base0::m_rdims[i] = new_dims[i];
-      new_size *= new_dims[i];
     }
+    size_type const new_size = Base0::updateStrides();
 
-    this->resize(new_size);
+    // an explicit value: resize(n) may default-initialize (default_init_allocator)
+    this->resize(new_size, UserT());
+  }
+
+  // the elements are left uninitialized if the memory block allows it
+  // (AlignedBlock, std::vector with default_init_allocator); a plain
+  // std::vector still value-initializes them
+  template<class T>
+  void reshape_uninitialized(T const new_dims[])
+  {
+    MA_STATIC_CHECK(internal::IsTriviallyConstructible<UserT>::value, UNINITIALIZED_RESHAPE_REQUIRES_A_TRIVIAL_TYPE);
+    reshapeForOverwrite(new_dims);
+  }
+
+  // reshape that keeps each element at its multi-index; the new elements
+  // are value-initialized. When only the slowest rank changes (e.g. the
+  // first one in RowMajor) no element is moved; otherwise they are moved
+  // in place, with at most one reallocation.
+  template<class T>
+  void resize_preserve(T const new_dims[])
+  {
+    if (!internal::IsStridedLayout<P_opts>::value)
+    {
+      resizeCopying(new_dims);
+      return;
+    }
+    size_type od[Rank], md[Rank], nd[Rank];
+    if (internal::preserveDims<Rank>(Base0::m_rdims, new_dims, isRowMajor, od, md, nd))
+    {
+      reshape(new_dims);
+      return;
+    }
+    internal::relayout(*this, od, md, Rank, true);
+    reshapeForOverwrite(new_dims);
+    internal::relayout(*this, md, nd, Rank, false);
   }
 
   void clear()
@@ -700,9 +1484,51 @@ public:
     for (int i=0; i<Rank; ++i)
     {
       Base0::m_rdims[i] = 0;
+      Base0::m_strides[i] = 0;
     }
   }
 
+#if __cplusplus >= 201103L
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  Array(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void reshape(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  Array(uninitialized_t, D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape_uninitialized(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void reshape_uninitialized(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape_uninitialized(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void resize_preserve(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    resize_preserve(new_dims);
+  }
+#else
 #define MA_IMPLEMENT_FUN(n_args)                                                                       \
   Array(MA_EXPAND_ARGS(n_args, size_type))                                                             \
   {                                                                                                    \
@@ -715,15 +1541,35 @@ public:
     MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);                                     \
     size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
                                                                                                        \
-    size_type new_size = 1;                                                                            \
     for (int i = 0; i < Rank; ++i)                                                                     \
     {                                                                                                  \
       internal::assertTrue(new_dims[i] > 0, "**ERROR**: Array<>: dimension must be greater than 0");   \
       Base0::m_rdims[i] = new_dims[i];                                                                 \
-      new_size *= new_dims[i];                                                                         \
     }                                                                                                  \
+    size_type const new_size = Base0::updateStrides();                                                 \
                                                                                                        \
-    this->resize(new_size);                                                                            \
+    this->resize(new_size, UserT());                                                                   \
+  }                                                                                                    \
+                                                                                                       \
+  Array(uninitialized_t, MA_EXPAND_ARGS(n_args, size_type))                                            \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);                                 \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    reshape_uninitialized(new_dims);                                                                   \
+  }                                                                                                    \
+                                                                                                       \
+  void reshape_uninitialized(MA_EXPAND_ARGS(n_args, size_type))                                        \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);                                     \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    reshape_uninitialized(new_dims);                                                                   \
+  }                                                                                                    \
+                                                                                                       \
+  void resize_preserve(MA_EXPAND_ARGS(n_args, size_type))                                              \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);                                     \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    resize_preserve(new_dims);                                                                         \
   }
 
   MA_IMPLEMENT_FUN( 1)
@@ -737,7 +1583,43 @@ public:
   MA_IMPLEMENT_FUN( 9)
   MA_IMPLEMENT_FUN(10)
 #undef MA_IMPLEMENT_FUN
+#endif
+
+private:
+  // reshape for arrays whose elements are all written next: skips the
+  // initialization when UserT is trivial
+  template<class T>
+  void reshapeForOverwrite(T const new_dims[])
+  {
+    for (int i = 0; i < Rank; ++i)
+    {
+      internal::assertTrue(new_dims[i] > 0, "**ERROR**: Array<>: dimension must be greater than 0");
+      Base0::m_rdims[i] = new_dims[i];
+    }
+    size_type const new_size = Base0::updateStrides();
+
+    internal::ResizeUninitialized<P_MemBlock, internal::IsTriviallyConstructible<UserT>::value>::run(*this, new_size);
+  }
+
+  // resize_preserve of the tiled and Morton layouts, through a copy of the
+  // common box
+  template<class T>
+  void resizeCopying(T const new_dims[])
+  {
+    Array old;
+    old.swap(*this);
+    reshape(new_dims);
 
+    size_type md[Rank], idx[Rank] = {};
+    size_type n = 1;
+    for (int i = 0; i < Rank; ++i)
+      n *= md[i] = std::min(old.dim(i), Base0::m_rdims[i]);
+    for (size_type c = 0; c < n; ++c)
+    {
+      (*this)(idx) = old(idx);
+      internal::nextIndex<Rank>(idx, md, isRowMajor);
+    }
+  }
 };
 
 
@@ -763,6 +1645,7 @@ class Array<P_type, P_rank, P_opts, P_MemBlock, true> : public ArrayBase< Array<
   struct ERROR_INCOMPATIBLE_TYPE_AND_STORAGE_TYPE<T,true> {};
 
   enum { Dummy1 = sizeof(ERROR_INCOMPATIBLE_TYPE_AND_STORAGE_TYPE<Array, Tr1::is_same<P_type,typename Tr1::remove_extent<P_MemBlock>::type>::value>) };
+  enum { DummyLayout = sizeof(internal::ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<P_opts>) };
 
 
 public:
@@ -783,19 +1666,70 @@ public:
   static const Options Opts = P_opts;
 
 private:
-  UserT        m_data[MaxSize];
-  size_type    m_size;
-  size_type    m_rdims[Rank];
+  UserT           m_data[MaxSize];
+  size_type       m_size;
+  size_type       m_rdims[Rank];
+  difference_type m_strides[Rank];
 
 
 public:
 
 
 
-  Array() : m_data(), m_size(), m_rdims() {};
+  Array() : m_data(), m_size(), m_rdims(), m_strides() {};
 
-  //Array(Array const& ) = default;
-  //Array& operator<< (Array const&) = default;
+  // only the `size()` elements in use are copied
+  Array(Array const& x) : m_size(x.m_size)
+  {
+    std::copy(x.m_data, x.m_data+m_size, m_data);
+    std::copy(x.m_rdims, x.m_rdims+Rank, m_rdims);
+    std::copy(x.m_strides, x.m_strides+Rank, m_strides);
+  }
+
+  Array& operator=(Array const& x)
+  {
+    if (this != &x)
+    {
+      std::copy(x.m_data, x.m_data+x.m_size, m_data);
+      m_size = x.m_size;
+      std::copy(x.m_rdims, x.m_rdims+Rank, m_rdims);
+      std::copy(x.m_strides, x.m_strides+Rank, m_strides);
+    }
+    return *this;
+  }
+
+#if __cplusplus >= 201103L
+  // the elements are moved one by one; `x` is left empty
+  Array(Array&& x) noexcept(std::is_nothrow_move_assignable<UserT>::value) : m_size(x.m_size)
+  {
+    std::move(x.m_data, x.m_data+m_size, m_data);
+    std::copy(x.m_rdims, x.m_rdims+Rank, m_rdims);
+    std::copy(x.m_strides, x.m_strides+Rank, m_strides);
+    x.clear();
+  }
+
+  Array& operator=(Array&& x) noexcept(std::is_nothrow_move_assignable<UserT>::value)
+  {
+    if (this != &x)
+    {
+      std::move(x.m_data, x.m_data+x.m_size, m_data);
+      m_size = x.m_size;
+      std::copy(x.m_rdims, x.m_rdims+Rank, m_rdims);
+      std::copy(x.m_strides, x.m_strides+Rank, m_strides);
+      x.clear();
+    }
+    return *this;
+  }
+#endif
+
+  // element-wise over the elements in use, without a temporary array
+  void swap(Array& x)
+  {
+    std::swap_ranges(m_data, m_data+std::max(m_size, x.m_size), x.m_data);
+    std::swap(m_size, x.m_size);
+    std::swap_ranges(m_rdims, m_rdims+Rank, x.m_rdims);
+    std::swap_ranges(m_strides, m_strides+Rank, x.m_strides);
+  }
 
   internal::ListInitializationSwitch<UserT, UserT*> operator<<(const_reference x)
   {
@@ -805,8 +1739,9 @@ public:
   template<typename Q_MemBlock, bool Q_hasSizeLimit>
   Array(Array<UserT,Rank,Opts,Q_MemBlock,Q_hasSizeLimit> const& x) : m_size(x.size())
   {
-    std::copy(x.begin(), x.end(), m_data);
-    std::copy(x.m_rdims, x.m_rdims+Rank, m_rdims);
+    internal::copyFlat(x, *this);
+    std::copy(x.rdims(), x.rdims()+Rank, m_rdims);
+    std::copy(x.rstrides(), x.rstrides()+Rank, m_strides);
   }
 
   template<class T>
@@ -818,8 +1753,31 @@ public:
   { reshape(new_dims); }
 
   template<class T>
-  void reshape(T const new_dims[], UserT const& val)
-  {
+  Array(uninitialized_t, T const new_dims[]) : m_size()
+  { reshape_uninitialized(new_dims); }
+
+  // evaluates an elementwise expression, e.g. `Array<double,3> C = a*A + B;`
+  template<class E>
+  Array(internal::ExprBase<E> const& e) : m_size()
+  { *this = e; }
+
+  template<class E>
+  Array& operator=(internal::ExprBase<E> const& e)
+  {
+    typedef typename internal::ExprLeaf<E>::type Expr;
+    MA_STATIC_CHECK(Expr::Rank == Rank, INVALID_RANK_IN_EXPRESSION_ASSIGNMENT);
+    Expr const x(e.derived());
+    size_type new_dims[Rank];
+    for (int i = 0; i < Rank; ++i)
+      new_dims[i] = x.dim(i);
+    reshapeForOverwrite(new_dims);
+    internal::assignExpr(*this, e);
+    return *this;
+  }
+
+  template<class T>
+  void reshape(T const new_dims[], UserT const& val)
+  {
     size_type new_size = 1;
     for (int i = 0; i < Rank; ++i)
     {
@@ -827,6 +1785,7 @@ public:
       m_rdims[i] = new_dims[i];
       new_size *= new_dims[i];
     }
+    updateStrides();
 
     this->resize(new_size, val);
   }
@@ -841,9 +1800,34 @@ public:
       m_rdims[i] = new_dims[i];
       new_size *= new_dims[i];
     }
+    updateStrides();
 
     this->resize(new_size);
   }
+
+  // only sets the dimensions: the elements keep their previous values
+  template<class T>
+  void reshape_uninitialized(T const new_dims[])
+  {
+    MA_STATIC_CHECK(internal::IsTriviallyConstructible<UserT>::value, UNINITIALIZED_RESHAPE_REQUIRES_A_TRIVIAL_TYPE);
+    reshapeForOverwrite(new_dims);
+  }
+
+  // reshape that keeps each element at its multi-index, in place; the new
+  // elements are value-initialized
+  template<class T>
+  void resize_preserve(T const new_dims[])
+  {
+    size_type od[Rank], md[Rank], nd[Rank];
+    if (internal::preserveDims<Rank>(m_rdims, new_dims, isRowMajor, od, md, nd))
+    {
+      reshape(new_dims);
+      return;
+    }
+    internal::relayout(*this, od, md, Rank, true);
+    reshapeForOverwrite(new_dims);
+    internal::relayout(*this, md, nd, Rank, false);
+  }
   
   void clear()
   {
@@ -851,10 +1835,52 @@ public:
     for(int i=0; i<Rank; ++i)
     {
       m_rdims[i] = 0;
+      m_strides[i] = 0;
     }
   }
 
 
+#if __cplusplus >= 201103L
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  Array(D... dims) : m_size()
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void reshape(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  Array(uninitialized_t, D... dims) : m_size()
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape_uninitialized(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void reshape_uninitialized(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape_uninitialized(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void resize_preserve(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    resize_preserve(new_dims);
+  }
+#else
 #define MA_IMPLEMENT_FUN(n_args)                                                                       \
   Array(MA_EXPAND_ARGS(n_args, size_type)) : m_size()                                                  \
   {                                                                                                    \
@@ -874,8 +1900,30 @@ public:
       m_rdims[i] = new_dims[i];                                                                        \
       new_size *= new_dims[i];                                                                         \
     }                                                                                                  \
+    updateStrides();                                                                                   \
     this->resize(new_size);                                                                            \
                                                                                                        \
+  }                                                                                                    \
+                                                                                                       \
+  Array(uninitialized_t, MA_EXPAND_ARGS(n_args, size_type)) : m_size()                                 \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);                                 \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    reshape_uninitialized(new_dims);                                                                   \
+  }                                                                                                    \
+                                                                                                       \
+  void reshape_uninitialized(MA_EXPAND_ARGS(n_args, size_type))                                        \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);                                     \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    reshape_uninitialized(new_dims);                                                                   \
+  }                                                                                                    \
+                                                                                                       \
+  void resize_preserve(MA_EXPAND_ARGS(n_args, size_type))                                              \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);                                     \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    resize_preserve(new_dims);                                                                         \
   }
 
   MA_IMPLEMENT_FUN( 1)
@@ -889,6 +1937,7 @@ public:
   MA_IMPLEMENT_FUN( 9)
   MA_IMPLEMENT_FUN(10)
 #undef MA_IMPLEMENT_FUN
+#endif
 
 
 
@@ -942,6 +1991,22 @@ public:
 
 protected:
 
+  template<class T>
+  void reshapeForOverwrite(T const new_dims[])
+  {
+    size_type new_size = 1;
+    for (int i = 0; i < Rank; ++i)
+    {
+      internal::assertTrue(new_dims[i] > 0, "**ERROR**: Array<>: dimension must be greater than 0");
+      m_rdims[i] = new_dims[i];
+      new_size *= new_dims[i];
+    }
+    updateStrides();
+
+    internal::assertTrue(new_size <= MaxSize, "**ERROR**: Size limit exceeded");
+    m_size = new_size;
+  }
+
   void resize(size_type n)
   {
     internal::assertTrue(n <= MaxSize, "**ERROR**: Size limit exceeded");
@@ -965,9 +2030,205 @@ protected:
 
   size_type const* rdims() const
   { return m_rdims; }
+
+  // vector with rank strides
+  difference_type* rstrides()
+  { return m_strides; }
+
+  difference_type const* rstrides() const
+  { return m_strides; }
+
+  void updateStrides()
+  {
+    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::StrideComputer StrideComputer;
+    StrideComputer::compute(m_rdims, m_strides);
+  }
+};
+
+template<typename T, int R, Options O, typename M, bool L>
+inline void swap(Array<T,R,O,M,L>& a, Array<T,R,O,M,L>& b)
+{ a.swap(b); }
+
+
+//
+// Fixed-extent version
+//
+
+// Compile-time shape, e.g. `Extents<3,3,3,3>`; the extents after the last
+// one given are 0.
+template<std::size_t N0,     std::size_t N1 = 0, std::size_t N2 = 0, std::size_t N3 = 0, std::size_t N4 = 0,
+         std::size_t N5 = 0, std::size_t N6 = 0, std::size_t N7 = 0, std::size_t N8 = 0, std::size_t N9 = 0>
+struct Extents
+{
+  static const int rank = N0 == 0 ? 0 : N1 == 0 ? 1 : N2 == 0 ? 2 : N3 == 0 ? 3 : N4 == 0 ? 4 :
+                          N5 == 0 ? 5 : N6 == 0 ? 6 : N7 == 0 ? 7 : N8 == 0 ? 8 : N9 == 0 ? 9 : 10;
+
+#define MA_NZ(N) ((N) + ((N) == 0))
+  static const std::size_t size = MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9);
+
+  static const std::size_t    dims[10];
+  static const std::ptrdiff_t rowMajorStrides[10];
+  static const std::ptrdiff_t colMajorStrides[10];
+};
+
+template<std::size_t N0, std::size_t N1, std::size_t N2, std::size_t N3, std::size_t N4,
+         std::size_t N5, std::size_t N6, std::size_t N7, std::size_t N8, std::size_t N9>
+const std::size_t Extents<N0,N1,N2,N3,N4,N5,N6,N7,N8,N9>::dims[10] = { N0, N1, N2, N3, N4, N5, N6, N7, N8, N9 };
+
+template<std::size_t N0, std::size_t N1, std::size_t N2, std::size_t N3, std::size_t N4,
+         std::size_t N5, std::size_t N6, std::size_t N7, std::size_t N8, std::size_t N9>
+const std::ptrdiff_t Extents<N0,N1,N2,N3,N4,N5,N6,N7,N8,N9>::rowMajorStrides[10] = {
+  MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N7)*MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N8)*MA_NZ(N9),
+  MA_NZ(N9),
+  1
+};
+
+template<std::size_t N0, std::size_t N1, std::size_t N2, std::size_t N3, std::size_t N4,
+         std::size_t N5, std::size_t N6, std::size_t N7, std::size_t N8, std::size_t N9>
+const std::ptrdiff_t Extents<N0,N1,N2,N3,N4,N5,N6,N7,N8,N9>::colMajorStrides[10] = {
+  1,
+  MA_NZ(N0),
+  MA_NZ(N0)*MA_NZ(N1),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7),
+  MA_NZ(N0)*MA_NZ(N1)*MA_NZ(N2)*MA_NZ(N3)*MA_NZ(N4)*MA_NZ(N5)*MA_NZ(N6)*MA_NZ(N7)*MA_NZ(N8)
+};
+#undef MA_NZ
+
+
+// Array whose shape is a template argument: dims and strides are constants
+// shared by all the instances, so the index computation folds at compile
+// time, and the object holds only the elements
+// (`sizeof(FixedArray<double, Extents<3,3> >) == 9*sizeof(double)`).
+// Like a C array, the default constructor leaves the elements of trivial
+// types uninitialized.
+template<typename P_type, class P_extents, Options P_opts = MA_DEFAULT_MAJOR>
+class FixedArray : public ArrayBase<FixedArray<P_type, P_extents, P_opts>, P_extents::rank, P_opts>
+{
+  typedef ArrayBase<FixedArray, P_extents::rank, P_opts> Base;
+
+  friend class ArrayBase<FixedArray, P_extents::rank, P_opts>;
+
+  enum { DummyLayout = sizeof(internal::ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<P_opts>) };
+
+public:
+
+  typedef typename Base::reference        reference;
+  typedef typename Base::const_reference  const_reference;
+  typedef typename Base::iterator         iterator;
+  typedef typename Base::const_iterator   const_iterator;
+  typedef typename Base::size_type        size_type;
+  typedef typename Base::difference_type  difference_type;
+  typedef typename Base::pointer          pointer;
+  typedef typename Base::const_pointer    const_pointer;
+
+  typedef P_type    UserT;
+  typedef P_extents ExtentsT;
+  static const int Rank = P_extents::rank;
+  static const bool isRowMajor = P_opts & RowMajor;
+  static const Options Opts = P_opts;
+  static const size_type Size = P_extents::size;
+
+private:
+  UserT m_data[Size];
+
+public:
+
+  FixedArray()
+  { }
+
+  explicit FixedArray(UserT const& val)
+  { std::fill(m_data, m_data+Size, val); }
+
+  // evaluates an elementwise expression; shapes must agree
+  template<class E>
+  FixedArray(internal::ExprBase<E> const& e)
+  { internal::assignExpr(*this, e); }
+
+  template<class E>
+  FixedArray& operator=(internal::ExprBase<E> const& e)
+  {
+    internal::assignExpr(*this, e);
+    return *this;
+  }
+
+  internal::ListInitializationSwitch<UserT, UserT*> operator<<(const_reference x)
+  {
+    return internal::ListInitializationSwitch<UserT, UserT*>(m_data, x);
+  }
+
+  int rank() const
+  { return Rank; }
+
+  size_type dim(size_type r) const
+  {
+    internal::assertTrue(r < (size_type)Rank, "**ERROR**: FixedArray<>: invalid index in function `dim()`");
+    return P_extents::dims[r];
+  }
+
+  size_type size() const
+  { return Size; }
+
+  pointer data()
+  { return m_data; }
+
+  const_pointer data() const
+  { return m_data; }
+
+  inline
+  reference access(size_type i)
+  { return m_data[i]; }
+
+  inline
+  const_reference access(size_type i) const
+  { return m_data[i]; }
+
+  iterator begin()
+  { return m_data; }
+
+  const_iterator begin() const
+  { return m_data; }
+
+  iterator end()
+  { return m_data+Size; }
+
+  const_iterator end() const
+  { return m_data+Size; }
+
+protected:
+  size_type const* rdims() const
+  { return P_extents::dims; }
+
+  difference_type const* rstrides() const
+  { return isRowMajor ? P_extents::rowMajorStrides : P_extents::colMajorStrides; }
 };
 
 
+
+// number of elements of a buffer that holds an array of layout `O`, e.g.
+// the data of an `Amaps<float, 3, Morton>`; larger than the product of the
+// dims for the tiled and Morton layouts, which pad the dims
+template<Options O, int Rank, class T>
+std::size_t storage_size(T const (&dims)[Rank])
+{
+  std::size_t d[Rank];
+  std::ptrdiff_t strides[Rank];
+  std::copy(dims, dims+Rank, d);
+  return internal::LayoutTraits<Rank, O>::StrideComputer::compute(d, strides);
+}
+
+
 //               db
 //              d88b
 //             d8'`8b
@@ -1003,9 +2264,10 @@ public:
   static const bool isRowMajor = P_opts & RowMajor;
 
 private:
-  UserT*       m_data;
-  size_type    m_size;
-  size_type    m_rdims[Rank];
+  UserT*          m_data;
+  size_type       m_size;
+  size_type       m_rdims[Rank];
+  difference_type m_strides[Rank];
 
   Amaps();
 public:
@@ -1014,9 +2276,56 @@ public:
 
   internal::ListInitializationSwitch<UserT, UserT*> operator<<(const_reference x)
   {
+    MA_STATIC_CHECK(internal::IsStridedLayout<P_opts>::value, LIST_INITIALIZATION_REQUIRES_A_STRIDED_LAYOUT);
     return internal::ListInitializationSwitch<UserT, UserT*>(this->data(), x);
   }
 
+  // writes an elementwise expression into the mapped data; shapes must agree
+  template<class E>
+  Amaps& operator=(internal::ExprBase<E> const& e)
+  {
+    internal::assignExpr(*this, e);
+    return *this;
+  }
+
+  template<class T>
+  Amaps(UserT* mapped, T const new_dims[])
+  {
+    m_size = 1;
+    for (int i = 0; i < Rank; ++i)
+    {
+      internal::assertTrue(new_dims[i] > 0, "**ERROR**: Amaps<>: dimension must be greater than 0");
+      m_rdims[i] = new_dims[i];
+      m_size *= new_dims[i];
+    }
+    updateStrides();
+
+    if (mapped == NULL)
+      throw std::runtime_error("**ERROR**: Amaps<>: null pointer");
+    m_data = mapped;
+  }
+
+#if __cplusplus >= 201103L
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  Amaps(UserT* mapped, D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_AMAPS_CONSTRUCTOR);
+
+    size_type const new_dims[] = { size_type(dims)... };
+    m_size = 1;
+    for (int i = 0; i < Rank; ++i)
+    {
+      internal::assertTrue(new_dims[i] > 0, "**ERROR**: Amaps<>: dimension must be greater than 0");
+      m_rdims[i] = new_dims[i];
+      m_size *= new_dims[i];
+    }
+    updateStrides();
+
+    if (mapped == NULL)
+      throw std::runtime_error("**ERROR**: Amaps<>: null pointer");
+    m_data = mapped;
+  }
+#else
 #define MA_AMAPS_CONSTRUCTOR(n_args)                                                                 \
   Amaps(UserT* mapped, MA_EXPAND_ARGS(n_args, size_type))                                            \
   {                                                                                                  \
@@ -1030,6 +2339,7 @@ public:
       m_rdims[i] = new_dims[i];                                                                      \
       m_size *= new_dims[i];                                                                         \
     }                                                                                                \
+    updateStrides();                                                                                 \
                                                                                                      \
     if (mapped == NULL)                                                                              \
       throw std::runtime_error("**ERROR**: Amaps<>: null pointer");                                  \
@@ -1047,6 +2357,7 @@ public:
   MA_AMAPS_CONSTRUCTOR( 9)
   MA_AMAPS_CONSTRUCTOR(10)
 #undef MA_AMAPS_CONSTRUCTOR
+#endif
 
 
   //internal::ListInitializationSwitch<Amaps, UserT*> operator<<(UserT const& x)
@@ -1098,62 +2409,1337 @@ protected:
 
   size_type const* rdims() const
   { return m_rdims; }
+
+  // vector with rank strides
+  difference_type* rstrides()
+  { return m_strides; }
+
+  difference_type const* rstrides() const
+  { return m_strides; }
+
+  void updateStrides()
+  {
+    typedef typename internal::LayoutTraits<Rank, P_opts>::StrideComputer StrideComputer;
+    StrideComputer::compute(m_rdims, m_strides);
+  }
 };
 
-namespace internal
-{
 
-template<class T, int A, Options O, class M>
-struct Traits<GenericN<T,A,O,M> > {
-  typedef T UserT;
-  typedef M MemBlockT;
+//              db                                                     8b           d8 88
+//             d88b                                                    `8b         d8' ""
+//            d8'`8b                                                    `8b       d8'
+//           d8'  `8b     8b,dPPYba, 8b,dPPYba, ,adPPYYba, 8b       d8   `8b     d8'   88  ,adPPYba, 8b      db      d8
+//          d8YaaaaY8b    88P'   "Y8 88P'   "Y8 ""     `Y8 `8b     d8'    `8b   d8'    88 a8P_____88 `8b    d88b    d8'
+//         d8""""""""8b   88         88         ,adPPPPP88  `8b   d8'      `8b d8'     88 8PP"""""""  `8b  d8'`8b  d8'
+//        d8'        `8b  88         88         88,    ,88   `8b,d8'        `888'      88 "8b,   ,aa   `8bd8'  `8bd8'
+//       d8'          `8b 88         88         `"8bbdP"Y8     Y88'          `8'       88  `"Ybbd8"'     YP      YP
+//                                                             d8'
+//                                                            d8'
 
-  typedef typename MemBlockT::reference        reference;
-  typedef typename MemBlockT::const_reference  const_reference;
-  typedef typename MemBlockT::iterator         iterator;
-  typedef typename MemBlockT::const_iterator   const_iterator;
-  typedef typename MemBlockT::size_type        size_type;
-  typedef typename MemBlockT::difference_type  difference_type;
-  typedef typename MemBlockT::pointer          pointer;
-  typedef typename MemBlockT::const_pointer    const_pointer;
+// Non-owning view with arbitrary (signed) per-rank strides. The base pointer
+// points to the element (0,0,...,0); strides are given in elements.
+template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR >
+class ArrayView : public ArrayBase<ArrayView<P_type,P_rank,P_opts>,P_rank,P_opts>
+{
 
-};
+  typedef ArrayBase<ArrayView,P_rank,P_opts> Base;
 
-template<typename T, int R, Options O, typename M>
-struct Traits<Array<T,R,O,M,true> > {
+  friend class ArrayBase<ArrayView,P_rank,P_opts>;
 
-  typedef T UserT;
+  enum { DummyLayout = sizeof(internal::ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<P_opts>) };
 
-  typedef  UserT&          reference;
-  typedef  UserT const&    const_reference;
-  typedef  UserT*          iterator;
-  typedef  UserT const*    const_iterator;
-  typedef  std::size_t     size_type;
-  typedef  std::ptrdiff_t  difference_type;
-  typedef  UserT*          pointer;
-  typedef  UserT const*    const_pointer;
+public:
 
-};
+  typedef typename Base::reference        reference;
+  typedef typename Base::const_reference  const_reference;
+  typedef typename Base::size_type        size_type;
+  typedef typename Base::difference_type  difference_type;
+  typedef typename Base::pointer          pointer;
+  typedef typename Base::const_pointer    const_pointer;
 
+  typedef P_type UserT;
+  static const int Rank = P_rank;
+  static const bool isRowMajor = P_opts & RowMajor;
 
-template<class T, int A, Options O>
-struct Traits<Amaps<T,A,O> > {
-  typedef T UserT;
+private:
+  UserT*          m_data;
+  size_type       m_size;
+  size_type       m_rdims[Rank];
+  difference_type m_strides[Rank];
 
-  typedef  UserT&          reference;
-  typedef  UserT const&    const_reference;
-  typedef  UserT*          iterator;
-  typedef  UserT const*    const_iterator;
-  typedef  std::size_t     size_type;
-  typedef  std::ptrdiff_t  difference_type;
-  typedef  UserT*          pointer;
-  typedef  UserT const*    const_pointer;
+  ArrayView();
+public:
+  //ArrayView(ArrayView const& ) = default;
+  //ArrayView& operator= (ArrayView const&) = default;
 
-};
+  template<class D, class S>
+  ArrayView(UserT* base, D const dims[], S const strides[]) : m_data(base), m_size(1)
+  {
+    for (int i = 0; i < Rank; ++i)
+    {
+      m_rdims[i] = dims[i];
+      m_strides[i] = strides[i];
+      m_size *= dims[i];
+    }
+  }
 
+  // dense block in `P_opts` order
+  template<class D>
+  ArrayView(UserT* base, D const dims[]) : m_data(base), m_size(1)
+  {
+    for (int i = 0; i < Rank; ++i)
+    {
+      m_rdims[i] = dims[i];
+      m_size *= dims[i];
+    }
+    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::StrideComputer StrideComputer;
+    StrideComputer::compute(m_rdims, m_strides);
+  }
 
+  // view with const elements from a mutable one
+  template<typename Q_type>
+  ArrayView(ArrayView<Q_type,P_rank,P_opts> const& x) : m_data(x.data()), m_size(x.size())
+  {
+    for (int i = 0; i < Rank; ++i)
+    {
+      m_rdims[i] = x.dim(i);
+      m_strides[i] = x.stride(i);
+    }
+  }
 
+  // writes an elementwise expression through the view; shapes must agree
+  template<class E>
+  ArrayView& operator=(internal::ExprBase<E> const& e)
+  {
+    internal::assignExpr(*this, e);
+    return *this;
+  }
 
+  // swap two ranks
+  ArrayView transposed(int r0, int r1) const
+  {
+    internal::assertTrue(r0 < Rank && r1 < Rank, "**ERROR**: ArrayView<>: invalid rank in function `transposed()`");
+    ArrayView v(*this);
+    std::swap(v.m_rdims[r0], v.m_rdims[r1]);
+    std::swap(v.m_strides[r0], v.m_strides[r1]);
+    return v;
+  }
+
+  // ranks in the order `perm[0], perm[1], ...`
+  template<class T>
+  ArrayView permuted(T const perm[]) const
+  {
+    internal::assertPermutation<Rank>(perm, "**ERROR**: ArrayView<>: invalid permutation in function `permuted()`");
+    ArrayView v(*this);
+    for (int i = 0; i < Rank; ++i)
+    {
+      v.m_rdims[i] = m_rdims[perm[i]];
+      v.m_strides[i] = m_strides[perm[i]];
+    }
+    return v;
+  }
+
+  // traverse rank `r` backwards
+  ArrayView reversed(int r) const
+  {
+    internal::assertTrue(r < Rank, "**ERROR**: ArrayView<>: invalid rank in function `reversed()`");
+    ArrayView v(*this);
+    if (m_rdims[r] > 0)
+      v.m_data += (difference_type)(m_rdims[r]-1) * m_strides[r];
+    v.m_strides[r] = -m_strides[r];
+    return v;
+  }
+
+  int rank() const
+  { return Rank; }
+
+  size_type dim(size_type r) const
+  {
+    internal::assertTrue(r < (size_type)Rank, "**ERROR**: ArrayView<>: invalid index in function `dim()`");
+    return m_rdims[r];
+  }
+
+  difference_type stride(size_type r) const
+  {
+    internal::assertTrue(r < (size_type)Rank, "**ERROR**: ArrayView<>: invalid index in function `stride()`");
+    return m_strides[r];
+  }
+
+  size_type size() const
+  { return m_size; }
+
+  // true if the elements are packed in `P_opts` order
+  bool isContiguous() const
+  {
+    difference_type dense[Rank];
+    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::StrideComputer StrideComputer;
+    StrideComputer::compute(m_rdims, dense);
+    for (int i = 0; i < Rank; ++i)
+      if (m_rdims[i] > 1 && dense[i] != m_strides[i])
+        return false;
+    return true;
+  }
+
+  // pointer to the element (0,0,...,0)
+  pointer data() const
+  {return m_data; }
+
+  // strided: these walk the multi-index (see NdIterator)
+  typedef typename Base::iterator        iterator;
+  typedef typename Base::const_iterator  const_iterator;
+
+  iterator begin()
+  { return iterator(*this, m_rdims, m_strides, false); }
+
+  iterator end()
+  { return iterator(*this, m_rdims, m_strides, true); }
+
+  const_iterator begin() const
+  { return const_iterator(*this, m_rdims, m_strides, false); }
+
+  const_iterator end() const
+  { return const_iterator(*this, m_rdims, m_strides, true); }
+
+
+  // `i` is an offset relative to `data()`, as computed from the strides
+  inline
+  reference access(difference_type i) const
+  { return m_data[i];}
+
+
+protected:
+
+  // vecotr with rank sizes
+  size_type* rdims()
+  { return m_rdims; }
+
+  size_type const* rdims() const
+  { return m_rdims; }
+
+  // vector with rank strides
+  difference_type* rstrides()
+  { return m_strides; }
+
+  difference_type const* rstrides() const
+  { return m_strides; }
+};
+
+namespace internal
+{
+
+template<class T, int A, Options O, class M>
+struct Traits<GenericN<T,A,O,M> > {
+  typedef T UserT;
+  typedef M MemBlockT;
+
+  typedef typename MemBlockT::reference        reference;
+  typedef typename MemBlockT::const_reference  const_reference;
+  typedef typename MemBlockT::iterator         iterator;
+  typedef typename MemBlockT::const_iterator   const_iterator;
+  typedef typename MemBlockT::size_type        size_type;
+  typedef typename MemBlockT::difference_type  difference_type;
+  typedef typename MemBlockT::pointer          pointer;
+  typedef typename MemBlockT::const_pointer    const_pointer;
+
+};
+
+template<typename T, int R, Options O, typename M>
+struct Traits<Array<T,R,O,M,false> > : Traits<GenericN<T,R,O,M> > {};
+
+template<typename T, int R, Options O, typename M>
+struct Traits<Array<T,R,O,M,true> > {
+
+  typedef T UserT;
+
+  typedef  UserT&          reference;
+  typedef  UserT const&    const_reference;
+  typedef  UserT*          iterator;
+  typedef  UserT const*    const_iterator;
+  typedef  std::size_t     size_type;
+  typedef  std::ptrdiff_t  difference_type;
+  typedef  UserT*          pointer;
+  typedef  UserT const*    const_pointer;
+
+};
+
+template<typename T, class E, Options O>
+struct Traits<FixedArray<T,E,O> > {
+
+  typedef T UserT;
+
+  typedef  UserT&          reference;
+  typedef  UserT const&    const_reference;
+  typedef  UserT*          iterator;
+  typedef  UserT const*    const_iterator;
+  typedef  std::size_t     size_type;
+  typedef  std::ptrdiff_t  difference_type;
+  typedef  UserT*          pointer;
+  typedef  UserT const*    const_pointer;
+
+};
+
+template<class T, int A, Options O>
+struct Traits<Amaps<T,A,O> > {
+  typedef T UserT;
+
+  typedef  UserT&          reference;
+  typedef  UserT const&    const_reference;
+  typedef  UserT*          iterator;
+  typedef  UserT const*    const_iterator;
+  typedef  std::size_t     size_type;
+  typedef  std::ptrdiff_t  difference_type;
+  typedef  UserT*          pointer;
+  typedef  UserT const*    const_pointer;
+
+};
+
+template<class T, int A, Options O>
+struct Traits<ArrayView<T,A,O> > {
+  typedef T UserT;
+
+  typedef  UserT&          reference;
+  typedef  UserT const&    const_reference;
+  typedef  NdIterator<ArrayView<T,A,O> >        iterator;
+  typedef  NdIterator<ArrayView<T,A,O> const>  const_iterator;
+  typedef  std::size_t     size_type;
+  typedef  std::ptrdiff_t  difference_type;
+  typedef  UserT*          pointer;
+  typedef  UserT const*    const_pointer;
+
+};
+
+
+// reference and pointer through an iterator over `Derived` (possibly const)
+template<class Derived>
+struct NdIteratorRef
+{
+  typedef typename Traits<Derived>::reference  reference;
+  typedef typename Traits<Derived>::pointer    pointer;
+};
+
+template<class Derived>
+struct NdIteratorRef<Derived const>
+{
+  typedef typename Traits<Derived>::const_reference  reference;
+  typedef typename Traits<Derived>::const_pointer    pointer;
+};
+
+// Walks the elements of an array, map or view in its major order, keeping
+// the multi-index and the storage offset up to date: `++` adds the stride
+// of the fastest rank and carries into the slower ones when a rank wraps
+// (amortized O(1)), so `index()` and `*it` never recompute the offset.
+// The array must outlive the iterator, and must not be reshaped.
+template<class Derived>
+class NdIterator
+{
+  typedef typename Tr1::remove_const<Derived>::type Array_t;
+  typedef Traits<Array_t>                            Traits_Array;
+
+public:
+  typedef std::forward_iterator_tag                                         iterator_category;
+  typedef typename Tr1::remove_const<typename Traits_Array::UserT>::type  value_type;
+  typedef typename NdIteratorRef<Derived>::reference                        reference;
+  typedef typename NdIteratorRef<Derived>::pointer                          pointer;
+  typedef typename Traits_Array::size_type                                  size_type;
+  typedef typename Traits_Array::difference_type                            difference_type;
+
+  static const int Rank = Array_t::Rank;
+  static const bool isRowMajor = Array_t::isRowMajor;
+
+  NdIterator() : m_a(NULL), m_dims(NULL), m_strides(NULL), m_off(0), m_count(0), m_idx()
+  { }
+
+  NdIterator(Derived& a, size_type const dims[], difference_type const strides[], bool atEnd)
+    : m_a(&a), m_dims(dims), m_strides(strides), m_off(0), m_count(0), m_idx()
+  {
+    if (atEnd)
+      m_count = a.size();
+  }
+
+  // from an iterator over a mutable array
+  NdIterator(NdIterator<Array_t> const& x)
+    : m_a(x.m_a), m_dims(x.m_dims), m_strides(x.m_strides), m_off(x.m_off), m_count(x.m_count)
+  { std::copy(x.m_idx, x.m_idx+Rank, m_idx); }
+
+  reference operator*() const
+  { return m_a->access(m_off); }
+
+  pointer operator->() const
+  { return &m_a->access(m_off); }
+
+  NdIterator& operator++()
+  {
+    typedef typename Array_t::IdxComputer IdxComputer;
+    ++m_count;
+    for (int k = 0; k < Rank; ++k)
+    {
+      int const r = isRowMajor ? Rank-1-k : k;
+      m_off += IdxComputer::step(m_strides, r, m_idx[r]);
+      if (++m_idx[r] < m_dims[r] || k == Rank-1)
+        break;
+      m_off -= IdxComputer::term(m_strides, r, m_dims[r]);
+      m_idx[r] = 0;
+    }
+    return *this;
+  }
+
+  NdIterator operator++(int)
+  {
+    NdIterator tmp(*this);
+    ++*this;
+    return tmp;
+  }
+
+  bool operator==(NdIterator const& x) const
+  { return m_count == x.m_count; }
+
+  bool operator!=(NdIterator const& x) const
+  { return m_count != x.m_count; }
+
+  // current multi-index
+  size_type const* index() const
+  { return m_idx; }
+
+  size_type index(int r) const
+  { return m_idx[r]; }
+
+  // argument of `access()` for the current element
+  difference_type offset() const
+  { return m_off; }
+
+private:
+  template<class D>
+  friend class NdIterator;
+
+  Derived*               m_a;
+  size_type const*       m_dims;
+  difference_type const* m_strides;
+  difference_type        m_off;
+  size_type              m_count;
+  size_type              m_idx[Rank];
+};
+
+
+// true if `access(i)`, i = 0 .. size()-1, walks the elements in major order
+template<class T>
+struct HasLinearAccess { static const bool value = true; };
+
+template<class T, int A, Options O>
+struct HasLinearAccess<ArrayView<T,A,O> > { static const bool value = false; };
+
+template<class T, int A, Options O, class M>
+struct HasLinearAccess<GenericN<T,A,O,M> > { static const bool value = IsStridedLayout<O>::value; };
+
+template<class T, int A, Options O, class M, bool L>
+struct HasLinearAccess<Array<T,A,O,M,L> > { static const bool value = IsStridedLayout<O>::value; };
+
+template<class T, int A, Options O>
+struct HasLinearAccess<Amaps<T,A,O> > { static const bool value = IsStridedLayout<O>::value; };
+
+
+// true if the memory block stores its elements in one contiguous buffer
+template<class M>
+struct IsContiguousBlock { static const bool value = false; };
+
+template<class T, class Alloc>
+struct IsContiguousBlock<std::vector<T,Alloc> > { static const bool value = true; };
+
+template<class Alloc>
+struct IsContiguousBlock<std::vector<bool,Alloc> > { static const bool value = false; };
+
+template<class T, std::size_t N>
+struct IsContiguousBlock<T[N]> { static const bool value = true; };
+
+template<class T, std::size_t Al>
+struct IsContiguousBlock<AlignedBlock<T,Al> > { static const bool value = true; };
+
+// alignment in bytes guaranteed for `data()` of a memory block, 0 if unknown
+template<class M>
+struct BlockAlignment { static const std::size_t value = 0; };
+
+template<class T, std::size_t Al>
+struct BlockAlignment<AlignedBlock<T,Al> > { static const std::size_t value = Al; };
+
+template<class T>
+struct DataAlignment { static const std::size_t value = 0; };
+
+template<class T, int A, Options O, class M>
+struct DataAlignment<GenericN<T,A,O,M> > : BlockAlignment<M> { };
+
+template<class T, int A, Options O, class M>
+struct DataAlignment<Array<T,A,O,M,false> > : BlockAlignment<M> { };
+
+// kernels for the contiguous data of `D1` (and `D2`); aligned loads and
+// stores are used when both blocks are aligned to the SIMD register size
+template<class D1, class D2 = D1>
+struct BulkTraits
+{
+  typedef typename Tr1::remove_const<typename Traits<D1>::UserT>::type value_type;
+  typedef simd::Pack<value_type> Pack;
+
+  static const bool isAligned = DataAlignment<D1>::value >= Pack::alignment &&
+                                DataAlignment<D2>::value >= Pack::alignment;
+
+  typedef simd::Kernels<value_type, Pack::enabled, isAligned> Kernels;
+};
+
+// true if `data()[i] == access(i)` for every linear index `i`
+template<class T>
+struct IsContiguous { static const bool value = false; };
+
+template<class T, int A, Options O, class M>
+struct IsContiguous<GenericN<T,A,O,M> >
+{ static const bool value = IsContiguousBlock<M>::value && IsStridedLayout<O>::value; };
+
+template<class T, int A, Options O, class M, bool L>
+struct IsContiguous<Array<T,A,O,M,L> >
+{ static const bool value = (L || IsContiguousBlock<M>::value) && IsStridedLayout<O>::value; };
+
+template<class T, int A, Options O>
+struct IsContiguous<Amaps<T,A,O> > { static const bool value = IsStridedLayout<O>::value; };
+
+template<class T, class E, Options O>
+struct IsContiguous<FixedArray<T,E,O> > { static const bool value = true; };
+
+
+// pointer to the first element if the array is contiguous, NULL otherwise
+template<class Derived, bool = IsContiguous<Derived>::value>
+struct ContiguousData
+{
+  static typename Traits<Derived>::pointer get(Derived&)
+  { return NULL; }
+
+  static typename Traits<Derived>::const_pointer get(Derived const&)
+  { return NULL; }
+};
+
+template<class Derived>
+struct ContiguousData<Derived, true>
+{
+  static typename Traits<Derived>::pointer get(Derived& a)
+  { return a.data(); }
+
+  static typename Traits<Derived>::const_pointer get(Derived const& a)
+  { return a.data(); }
+};
+
+// views are checked at run time
+template<class T, int A, Options O>
+struct ContiguousData<ArrayView<T,A,O>, false>
+{
+  static T* get(ArrayView<T,A,O> const& a)
+  { return a.isContiguous() ? a.data() : NULL; }
+};
+
+
+// pointer to the element (0,0,...,0) if the elements can be addressed
+// through `data()` and the strides, NULL otherwise
+template<class Derived, bool = IsContiguous<Derived>::value>
+struct StridedData
+{
+  static typename Traits<Derived>::pointer get(Derived&)
+  { return NULL; }
+
+  static typename Traits<Derived>::const_pointer get(Derived const&)
+  { return NULL; }
+};
+
+template<class Derived>
+struct StridedData<Derived, true> : ContiguousData<Derived, true>
+{ };
+
+template<class T, int A, Options O>
+struct StridedData<ArrayView<T,A,O>, false>
+{
+  static T* get(ArrayView<T,A,O> const& a)
+  { return a.data(); }
+};
+
+
+#ifndef MA_TRANSPOSE_BLOCK
+#define MA_TRANSPOSE_BLOCK 32
+#endif
+
+// rank with the smallest stride, ignoring ranks of extent 1
+inline int fastestRank(int rank, std::size_t const dims[], std::ptrdiff_t const strides[])
+{
+  int f = -1;
+  for (int i = 0; i < rank; ++i)
+  {
+    if (dims[i] < 2)
+      continue;
+    std::ptrdiff_t const s = strides[i] < 0 ? -strides[i] : strides[i];
+    if (f < 0 || s < (strides[f] < 0 ? -strides[f] : strides[f]))
+      f = i;
+  }
+  return f < 0 ? 0 : f;
+}
+
+// dst(idx) = src(idx) for every multi-index of extents `dims`, both sides
+// given by a pointer to the element (0,...,0) and strides. When the
+// fastest ranks of `dst` and `src` differ (e.g. RowMajor <-> ColMajor, or
+// a permutation of the ranks) the copy is done in MA_TRANSPOSE_BLOCK^2
+// tiles over these two ranks, so that both sides stay in cache.
+template<class T, class U>
+void stridedCopy(int rank, std::size_t const dims[],
+                 T* dst, std::ptrdiff_t const ds[], U const* src, std::ptrdiff_t const ss[])
+{
+  for (int i = 0; i < rank; ++i)
+    if (dims[i] == 0)
+      return;
+
+  int const a = fastestRank(rank, dims, ds);  // contiguous writes
+  int const b = fastestRank(rank, dims, ss);  // contiguous reads
+
+  // remaining ranks, walked with an odometer
+  int         outer[MA_MAX_RANK];
+  std::size_t oidx[MA_MAX_RANK] = {};
+  int no = 0;
+  for (int i = 0; i < rank; ++i)
+    if (i != a && i != b)
+      outer[no++] = i;
+
+  std::size_t const    na = dims[a], nb = dims[b];
+  std::ptrdiff_t const da = ds[a], db = ds[b], sa = ss[a], sb = ss[b];
+  std::size_t const    B = MA_TRANSPOSE_BLOCK;
+
+  std::ptrdiff_t od = 0, os = 0;
+  for (;;)
+  {
+    if (a == b)
+    {
+      for (std::size_t i = 0; i < na; ++i)
+        dst[od + (std::ptrdiff_t)i*da] = src[os + (std::ptrdiff_t)i*sa];
+    }
+    else
+    {
+      for (std::size_t jb = 0; jb < nb; jb += B)
+        for (std::size_t ja = 0; ja < na; ja += B)
+        {
+          std::size_t const eb = std::min(jb + B, nb), ea = std::min(ja + B, na);
+          for (std::size_t ib = jb; ib < eb; ++ib)
+          {
+            T*       d = dst + od + (std::ptrdiff_t)ib*db;
+            U const* s = src + os + (std::ptrdiff_t)ib*sb;
+            for (std::size_t ia = ja; ia < ea; ++ia)
+              d[(std::ptrdiff_t)ia*da] = s[(std::ptrdiff_t)ia*sa];
+          }
+        }
+    }
+
+    int k = 0;
+    for (; k < no; ++k)
+    {
+      int const r = outer[k];
+      od += ds[r];
+      os += ss[r];
+      if (++oidx[k] < dims[r])
+        break;
+      od -= (std::ptrdiff_t)dims[r]*ds[r];
+      os -= (std::ptrdiff_t)dims[r]*ss[r];
+      oidx[k] = 0;
+    }
+    if (k == no)
+      return;
+  }
+}
+
+
+// flat copy of `src.size()` elements, used by the copy constructors
+template<class Src, class Dst>
+void copyFlat(Src const& src, Dst& dst)
+{
+  if (IsContiguous<Src>::value && IsContiguous<Dst>::value)
+    BulkTraits<Dst,Src>::Kernels::copy(ContiguousData<Dst>::get(dst), ContiguousData<Src>::get(src), src.size());
+  else
+    std::copy(src.begin(), src.end(), dst.begin());
+}
+
+
+template<class D1, class D2>
+bool sameLinearLayout(D1 const& a, D2 const& b)
+{
+  if (D1::isRowMajor != D2::isRowMajor)
+    return false;
+  for (int i = 0; i < D1::Rank; ++i)
+    if (a.dim(i) != b.dim(i))
+      return false;
+  return true;
+}
+
+// SIMD paths of copy(), axpy() and dot(); they return false when the
+// storages are not contiguous with the same linear layout. The kernels take
+// a single element type, so they are only instantiated when both agree.
+template<class D1, class D2,
+         bool = Tr1::is_same<typename BulkTraits<D1>::value_type, typename BulkTraits<D2>::value_type>::value>
+struct BulkPair
+{
+  typedef typename BulkTraits<D2,D1>::Kernels Kernels;
+  typedef typename BulkTraits<D1>::value_type T;
+
+  static bool copy(D1 const& a, D2& b)
+  {
+    typename Traits<D1>::const_pointer pa = ContiguousData<D1>::get(a);
+    typename Traits<D2>::pointer       pb = ContiguousData<D2>::get(b);
+    if (!(pa && pb && sameLinearLayout(a, b)))
+      return false;
+    Kernels::copy(pb, pa, a.size());
+    return true;
+  }
+
+  static bool axpy(T const& a, D1 const& x, D2& y)
+  {
+    typename Traits<D1>::const_pointer px = ContiguousData<D1>::get(x);
+    typename Traits<D2>::pointer       py = ContiguousData<D2>::get(y);
+    if (!(px && py && sameLinearLayout(x, y)))
+      return false;
+    Kernels::axpy(py, a, px, x.size());
+    return true;
+  }
+
+  static bool dot(D1 const& a, D2 const& b, T& s)
+  {
+    typename Traits<D1>::const_pointer pa = ContiguousData<D1>::get(a);
+    typename Traits<D2>::const_pointer pb = ContiguousData<D2>::get(b);
+    if (!(pa && pb && sameLinearLayout(a, b)))
+      return false;
+    s = Kernels::dot(pa, pb, a.size());
+    return true;
+  }
+};
+
+template<class D1, class D2>
+struct BulkPair<D1, D2, false>
+{
+  static bool copy(D1 const&, D2&)
+  { return false; }
+
+  template<class T>
+  static bool axpy(T const&, D1 const&, D2&)
+  { return false; }
+
+  template<class T>
+  static bool dot(D1 const&, D2 const&, T&)
+  { return false; }
+};
+
+
+// next multi-index in major order
+template<int Rank>
+void nextIndex(std::size_t idx[], std::size_t const dims[], bool isRowMajor)
+{
+  if (isRowMajor)
+  {
+    for (int r = Rank-1; r >= 0; --r)
+    {
+      if (++idx[r] < dims[r])
+        return;
+      idx[r] = 0;
+    }
+  }
+  else
+  {
+    for (int r = 0; r < Rank; ++r)
+    {
+      if (++idx[r] < dims[r])
+        return;
+      idx[r] = 0;
+    }
+  }
+}
+
+}
+
+
+
+//
+// Elementwise expressions
+//
+// `C = a*A + B` builds a tree of lightweight nodes that is evaluated in a
+// single pass by the assignment; no temporary arrays are created. Every node
+// provides
+//
+//   value_type                       element type (the type of `l op r`, see Promote)
+//   Rank                             rank of the result
+//   dim(r)                           shape of the result
+//   operator()(idx)                  value at the multi-index `idx`
+//   linear(i)                        value at the flat index `i`, valid only when
+//   isLinear(rowMajor)               returns true for the major order of the destination
+//
+
+namespace internal
+{
+  template<bool C, class A, class B>
+  struct Select { typedef A type; };
+
+  template<class A, class B>
+  struct Select<false, A, B> { typedef B type; };
+
+  // rank of an arithmetic type in the usual arithmetic conversions, 0 for
+  // the other types
+  template<class T> struct ArithmeticRank { static const int value = 0; };
+
+#define MA_ARITHMETIC_RANK(T, r) template<> struct ArithmeticRank<T> { static const int value = r; };
+  MA_ARITHMETIC_RANK(bool, 1)
+  MA_ARITHMETIC_RANK(char, 2)
+  MA_ARITHMETIC_RANK(signed char, 2)
+  MA_ARITHMETIC_RANK(unsigned char, 2)
+  MA_ARITHMETIC_RANK(short, 3)
+  MA_ARITHMETIC_RANK(unsigned short, 3)
+  MA_ARITHMETIC_RANK(int, 4)
+  MA_ARITHMETIC_RANK(unsigned, 5)
+  MA_ARITHMETIC_RANK(long, 6)
+  MA_ARITHMETIC_RANK(unsigned long, 7)
+#if __cplusplus >= 201103L
+  MA_ARITHMETIC_RANK(long long, 8)
+  MA_ARITHMETIC_RANK(unsigned long long, 9)
+#endif
+  MA_ARITHMETIC_RANK(float, 10)
+  MA_ARITHMETIC_RANK(double, 11)
+  MA_ARITHMETIC_RANK(long double, 12)
+#undef MA_ARITHMETIC_RANK
+
+  // type of `a op b` for operands of types A and B: the usual arithmetic
+  // conversions, e.g. Promote<int, double> is double and Promote<char,
+  // short> is int. A non-arithmetic type (e.g. std::complex) wins over an
+  // arithmetic one.
+  template<class A, class B>
+  struct Promote
+  {
+    static const int ra = ArithmeticRank<A>::value;
+    static const int rb = ArithmeticRank<B>::value;
+    typedef typename Select<(ra == 0 || (rb != 0 && ra >= rb)), A, B>::type higher;
+    typedef typename Select<(ra != 0 && rb != 0 && ArithmeticRank<higher>::value < ArithmeticRank<int>::value),
+                            int, higher>::type type;
+  };
+
+  template<class A>
+  struct Promote<A, A> { typedef A type; };
+
+  // scalars of expressions: the arithmetic types and the element type
+  template<class S, class E>
+  struct IsScalar
+  { static const bool value = Tr1::is_arithmetic<S>::value || Tr1::is_same<S, typename E::value_type>::value; };
+
+  struct OpPlus  { template<class T> static T apply(T const& a, T const& b) { return a + b; } };
+  struct OpMinus { template<class T> static T apply(T const& a, T const& b) { return a - b; } };
+  struct OpMul   { template<class T> static T apply(T const& a, T const& b) { return a * b; } };
+  struct OpDiv   { template<class T> static T apply(T const& a, T const& b) { return a / b; } };
+
+  // a leaf: reference to an array
+  template<class Derived>
+  class ArrayLeaf
+  {
+    Derived const& m_a;
+
+  public:
+    typedef typename Tr1::remove_const<typename Traits<Derived>::UserT>::type value_type;
+    static const int Rank = Derived::Rank;
+
+    template<int R, Options O>
+    ArrayLeaf(ArrayBase<Derived,R,O> const& a) : m_a(static_cast<Derived const&>(a))
+    { }
+
+    std::size_t dim(int r) const
+    { return m_a.dim(r); }
+
+    value_type operator()(std::size_t const idx[]) const
+    { return m_a(idx); }
+
+    value_type linear(std::size_t i) const
+    { return m_a.access(i); }
+
+    bool isLinear(bool rowMajor) const
+    { return HasLinearAccess<Derived>::value && Derived::isRowMajor == rowMajor; }
+  };
+
+  // maps an expression operand to the node stored in the tree
+  template<class E>
+  struct ExprLeaf
+  { typedef E type; };
+
+  template<class Derived, int R, Options O>
+  struct ExprLeaf<ArrayBase<Derived,R,O> >
+  { typedef ArrayLeaf<Derived> type; };
+
+
+  template<class L, class R, class Op>
+  class BinaryExpr : public ExprBase<BinaryExpr<L,R,Op> >
+  {
+    L m_l;
+    R m_r;
+
+  public:
+    typedef typename Promote<typename L::value_type, typename R::value_type>::type value_type;
+    static const int Rank = L::Rank;
+
+    template<class EL, class ER>
+    BinaryExpr(EL const& l, ER const& r) : m_l(l), m_r(r)
+    {
+      MA_STATIC_CHECK(L::Rank == R::Rank, INCOMPATIBLE_RANKS_IN_EXPRESSION);
+#ifdef DEBUG
+      for (int i = 0; i < Rank; ++i)
+        assertTrue(m_l.dim(i) == m_r.dim(i), "**ERROR**: Array<>: incompatible shapes in expression");
+#endif
+    }
+
+    std::size_t dim(int r) const
+    { return m_l.dim(r); }
+
+    value_type operator()(std::size_t const idx[]) const
+    { return Op::apply((value_type)m_l(idx), (value_type)m_r(idx)); }
+
+    value_type linear(std::size_t i) const
+    { return Op::apply((value_type)m_l.linear(i), (value_type)m_r.linear(i)); }
+
+    bool isLinear(bool rowMajor) const
+    { return m_l.isLinear(rowMajor) && m_r.isLinear(rowMajor); }
+  };
+
+  // `E op s` (ScalarLeft = false) or `s op E` (ScalarLeft = true), with a
+  // scalar of type S
+  template<class E, class Op, bool ScalarLeft, class S>
+  class ScalarExpr : public ExprBase<ScalarExpr<E,Op,ScalarLeft,S> >
+  {
+  public:
+    typedef typename Promote<typename E::value_type, S>::type value_type;
+    static const int Rank = E::Rank;
+
+  private:
+    E          m_e;
+    value_type m_s;
+
+    value_type apply(value_type const& x) const
+    { return ScalarLeft ? Op::apply(m_s, x) : Op::apply(x, m_s); }
+
+  public:
+    template<class EE>
+    ScalarExpr(EE const& e, value_type const& s) : m_e(e), m_s(s)
+    { }
+
+    std::size_t dim(int r) const
+    { return m_e.dim(r); }
+
+    value_type operator()(std::size_t const idx[]) const
+    { return apply((value_type)m_e(idx)); }
+
+    value_type linear(std::size_t i) const
+    { return apply((value_type)m_e.linear(i)); }
+
+    bool isLinear(bool rowMajor) const
+    { return m_e.isLinear(rowMajor); }
+  };
+
+  template<class E>
+  class NegateExpr : public ExprBase<NegateExpr<E> >
+  {
+    E m_e;
+
+  public:
+    typedef typename E::value_type value_type;
+    static const int Rank = E::Rank;
+
+    template<class EE>
+    explicit NegateExpr(EE const& e) : m_e(e)
+    { }
+
+    std::size_t dim(int r) const
+    { return m_e.dim(r); }
+
+    value_type operator()(std::size_t const idx[]) const
+    { return -m_e(idx); }
+
+    value_type linear(std::size_t i) const
+    { return -m_e.linear(i); }
+
+    bool isLinear(bool rowMajor) const
+    { return m_e.isLinear(rowMajor); }
+  };
+
+
+  // plain array-to-array assignment between strided storages: a SIMD
+  // copy if both have the same element type and linear layout, a blocked
+  // copy otherwise
+  template<class E>
+  struct ArrayCopy
+  {
+    template<class Dst>
+    static bool run(Dst&, E const&)
+    { return false; }
+  };
+
+  template<class D2, int R2, Options O2>
+  struct ArrayCopy<ArrayBase<D2,R2,O2> >
+  {
+    template<class D1, int R1, Options O1>
+    static bool run(ArrayBase<D1,R1,O1>& dst, ArrayBase<D2,R2,O2> const& src)
+    {
+      D1&       a = static_cast<D1&>(dst);
+      D2 const& b = static_cast<D2 const&>(src);
+      typename Traits<D1>::pointer       pa = StridedData<D1>::get(a);
+      typename Traits<D2>::const_pointer pb = StridedData<D2>::get(b);
+      if (!pa || !pb)
+        return false;
+
+      std::size_t dims[R1];
+      for (int i = 0; i < R1; ++i)
+      {
+        assertTrue(a.dim(i) == b.dim(i), "**ERROR**: Array<>: incompatible shapes in assignment");
+        dims[i] = a.dim(i);
+      }
+
+      if (!BulkPair<D2,D1>::copy(b, a))
+        stridedCopy(R1, dims, pa, dst.rstrides(), pb, src.rstrides());
+      return true;
+    }
+  };
+
+
+  template<class Derived, int Rank, Options Opts, class E>
+  void assignExpr(ArrayBase<Derived,Rank,Opts>& dst, ExprBase<E> const& expr)
+  {
+    typedef typename ExprLeaf<E>::type Expr;
+    MA_STATIC_CHECK(Expr::Rank == Rank, INCOMPATIBLE_RANKS_IN_ASSIGNMENT);
+
+    if (ArrayCopy<E>::run(dst, expr.derived()))
+      return;
+
+    Derived&   a = static_cast<Derived&>(dst);
+    Expr const e(expr.derived());
+
+    std::size_t n = 1;
+    for (int i = 0; i < Rank; ++i)
+    {
+      assertTrue(a.dim(i) == e.dim(i), "**ERROR**: Array<>: incompatible shapes in assignment");
+      n *= a.dim(i);
+    }
+
+    if (HasLinearAccess<Derived>::value && e.isLinear(Derived::isRowMajor))
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        a.access(i) = e.linear(i);
+      return;
+    }
+
+    // walk the multi-index in the major order of the destination
+    std::size_t dims[Rank];
+    std::size_t idx[Rank] = {};
+    for (int i = 0; i < Rank; ++i)
+      dims[i] = a.dim(i);
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      a(idx) = e(idx);
+      nextIndex<Rank>(idx, dims, Derived::isRowMajor);
+    }
+  }
+
+} // end internal
+
+
+#define MA_IMPLEMENT_BINARY_OP(op, Op)                                                               \
+template<class E1, class E2>                                                                         \
+internal::BinaryExpr<typename internal::ExprLeaf<E1>::type, typename internal::ExprLeaf<E2>::type, Op> \
+operator op (internal::ExprBase<E1> const& l, internal::ExprBase<E2> const& r)                       \
+{                                                                                                    \
+  return internal::BinaryExpr<typename internal::ExprLeaf<E1>::type,                                 \
+                              typename internal::ExprLeaf<E2>::type, Op>(l.derived(), r.derived());  \
+}                                                                                                    \
+                                                                                                     \
+template<class E, class S>                                                                           \
+typename marray_internal::EnableIf<                                                                  \
+  internal::IsScalar<S, typename internal::ExprLeaf<E>::type>::value,                                \
+  internal::ScalarExpr<typename internal::ExprLeaf<E>::type, Op, false, S> >::type                   \
+operator op (internal::ExprBase<E> const& e, S s)                                                    \
+{                                                                                                    \
+  return internal::ScalarExpr<typename internal::ExprLeaf<E>::type, Op, false, S>(e.derived(), s);   \
+}                                                                                                    \
+                                                                                                     \
+template<class E, class S>                                                                           \
+typename marray_internal::EnableIf<                                                                  \
+  internal::IsScalar<S, typename internal::ExprLeaf<E>::type>::value,                                \
+  internal::ScalarExpr<typename internal::ExprLeaf<E>::type, Op, true, S> >::type                    \
+operator op (S s, internal::ExprBase<E> const& e)                                                    \
+{                                                                                                    \
+  return internal::ScalarExpr<typename internal::ExprLeaf<E>::type, Op, true, S>(e.derived(), s);    \
+}                                                                                                    \
+                                                                                                     \
+template<class Derived, int Rank, Options Opts, class E>                                             \
+Derived& operator op##= (ArrayBase<Derived,Rank,Opts>& a, internal::ExprBase<E> const& e)            \
+{                                                                                                    \
+  internal::assignExpr(a, a op e);                                                                   \
+  return static_cast<Derived&>(a);                                                                   \
+}                                                                                                    \
+                                                                                                     \
+template<class Derived, int Rank, Options Opts, class S>                                             \
+typename marray_internal::EnableIf<internal::IsScalar<S, internal::ArrayLeaf<Derived> >::value,      \
+                                   Derived&>::type                                                   \
+operator op##= (ArrayBase<Derived,Rank,Opts>& a, S s)                                                \
+{                                                                                                    \
+  internal::assignExpr(a, a op s);                                                                   \
+  return static_cast<Derived&>(a);                                                                   \
+}
+
+MA_IMPLEMENT_BINARY_OP(+, internal::OpPlus)
+MA_IMPLEMENT_BINARY_OP(-, internal::OpMinus)
+MA_IMPLEMENT_BINARY_OP(*, internal::OpMul)
+MA_IMPLEMENT_BINARY_OP(/, internal::OpDiv)
+
+#undef MA_IMPLEMENT_BINARY_OP
+
+template<class E>
+internal::NegateExpr<typename internal::ExprLeaf<E>::type>
+operator- (internal::ExprBase<E> const& e)
+{
+  return internal::NegateExpr<typename internal::ExprLeaf<E>::type>(e.derived());
+}
+
+
+
+//
+// Bulk operations
+//
+// Contiguous storage (std::vector and T[N] memory blocks, Amaps, dense
+// views) goes through the kernels of simd.hpp; anything else is traversed
+// through the multi-index. Binary operations take the fast path only when
+// both operands are contiguous and have the same major order.
+//
+
+namespace internal
+{
+  template<class Derived, int Rank, Options Opts, class Fun>
+  void forEachIndex(ArrayBase<Derived,Rank,Opts> const& x, Fun& f)
+  {
+    Derived const& a = static_cast<Derived const&>(x);
+    std::size_t dims[Rank];
+    std::size_t idx[Rank] = {};
+    std::size_t n = 1;
+    for (int i = 0; i < Rank; ++i)
+      n *= dims[i] = a.dim(i);
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      f(idx);
+      nextIndex<Rank>(idx, dims, Derived::isRowMajor);
+    }
+  }
+
+  template<class Derived, class T>
+  struct FillFun
+  {
+    Derived& a; T const& v;
+    FillFun(Derived& a_, T const& v_) : a(a_), v(v_) {}
+    void operator()(std::size_t const idx[]) { a(idx) = v; }
+  };
+
+  template<class Derived, class T>
+  struct SumFun
+  {
+    Derived const& a; T s;
+    SumFun(Derived const& a_) : a(a_), s() {}
+    void operator()(std::size_t const idx[]) { s += a(idx); }
+  };
+
+  template<class Derived, class T>
+  struct MinMaxFun
+  {
+    Derived const& a; T lo, hi;
+    MinMaxFun(Derived const& a_, T const& x) : a(a_), lo(x), hi(x) {}
+    void operator()(std::size_t const idx[])
+    {
+      T const& x = a(idx);
+      if (x < lo) lo = x;
+      if (hi < x) hi = x;
+    }
+  };
+
+  template<class D1, class D2, class T>
+  struct DotFun
+  {
+    D1 const& a; D2 const& b; T s;
+    DotFun(D1 const& a_, D2 const& b_) : a(a_), b(b_), s() {}
+    void operator()(std::size_t const idx[]) { s += a(idx)*b(idx); }
+  };
+
+  template<class D1, class D2>
+  void assertSameShape(D1 const& a, D2 const& b, const char* msg)
+  {
+    MA_STATIC_CHECK(D1::Rank == D2::Rank, INCOMPATIBLE_RANKS);
+#ifdef DEBUG
+    for (int i = 0; i < D1::Rank; ++i)
+      assertTrue(a.dim(i) == b.dim(i), msg);
+#else
+    (void)a; (void)b; (void)msg;
+#endif
+  }
+}
+
+
+// f(idx, x(idx)) for every multi-index `idx` (a `size_type const*`), in
+// major order; returns `f`
+template<class Derived, int Rank, Options Opts, class F>
+F for_each_indexed(ArrayBase<Derived,Rank,Opts>& x, F f)
+{
+  typedef typename ArrayBase<Derived,Rank,Opts>::nd_iterator It;
+  for (It it = x.ndbegin(), end = x.ndend(); it != end; ++it)
+    f(it.index(), *it);
+  return f;
+}
+
+template<class Derived, int Rank, Options Opts, class F>
+F for_each_indexed(ArrayBase<Derived,Rank,Opts> const& x, F f)
+{
+  typedef typename ArrayBase<Derived,Rank,Opts>::const_nd_iterator It;
+  for (It it = x.ndbegin(), end = x.ndend(); it != end; ++it)
+    f(it.index(), *it);
+  return f;
+}
+
+// dst(i_0, ..., i_{R-1}) = src(j) with j_perm[k] = i_k, i.e. rank `k` of
+// `dst` is rank `perm[k]` of `src`; dst.dim(k) must be src.dim(perm[k]).
+// Strided storages go through the blocked copy (see `stridedCopy`).
+template<class D1, int Rank, Options O1, class D2, Options O2, class P>
+void permute(ArrayBase<D1,Rank,O1> const& src, P const perm[], ArrayBase<D2,Rank,O2>& dst)
+{
+  D1 const& a = static_cast<D1 const&>(src);
+  D2&       b = static_cast<D2&>(dst);
+
+  internal::assertPermutation<Rank>(perm, "**ERROR**: permute(): invalid permutation");
+  std::size_t    dims[Rank];
+  std::ptrdiff_t ss[Rank];
+  for (int k = 0; k < Rank; ++k)
+  {
+    internal::assertTrue(b.dim(k) == a.dim(perm[k]), "**ERROR**: permute(): incompatible shapes");
+    dims[k] = b.dim(k);
+    ss[k] = src.rstrides()[perm[k]];
+  }
+
+  typename internal::Traits<D1>::const_pointer pa = internal::StridedData<D1>::get(a);
+  typename internal::Traits<D2>::pointer       pb = internal::StridedData<D2>::get(b);
+  if (pa && pb)
+  {
+    internal::stridedCopy(Rank, dims, pb, dst.rstrides(), pa, ss);
+    return;
+  }
+
+  std::size_t n = b.size();
+  std::size_t idx[Rank] = {}, sidx[Rank];
+  for (std::size_t c = 0; c < n; ++c)
+  {
+    for (int k = 0; k < Rank; ++k)
+      sidx[perm[k]] = idx[k];
+    b(idx) = a(sidx);
+    internal::nextIndex<Rank>(idx, dims, D2::isRowMajor);
+  }
+}
+
+// x(i) = v for every i
+template<class Derived, int Rank, Options Opts>
+void fill(ArrayBase<Derived,Rank,Opts>& x, typename internal::BulkTraits<Derived>::value_type const& v)
+{
+  typedef typename internal::BulkTraits<Derived>::Kernels Kernels;
+  Derived& a = static_cast<Derived&>(x);
+  if (typename internal::Traits<Derived>::pointer p = internal::ContiguousData<Derived>::get(a))
+    Kernels::fill(p, a.size(), v);
+  else
+  {
+    internal::FillFun<Derived, typename internal::BulkTraits<Derived>::value_type> f(a, v);
+    internal::forEachIndex(x, f);
+  }
+}
+
+// dst(i) = src(i); shapes must agree
+template<class D1, int Rank, Options O1, class D2, Options O2>
+void copy(ArrayBase<D1,Rank,O1> const& src, ArrayBase<D2,Rank,O2>& dst)
+{
+  D1 const& a = static_cast<D1 const&>(src);
+  D2&       b = static_cast<D2&>(dst);
+  internal::assertSameShape(a, b, "**ERROR**: copy(): incompatible shapes");
+  if (!internal::BulkPair<D1,D2>::copy(a, b))
+    internal::assignExpr(dst, src);
+}
+
+// y += a*x; shapes must agree
+template<class D1, int Rank, Options O1, class D2, Options O2>
+void axpy(typename internal::BulkTraits<D2>::value_type const& a, ArrayBase<D1,Rank,O1> const& x,
+          ArrayBase<D2,Rank,O2>& y)
+{
+  D1 const& xx = static_cast<D1 const&>(x);
+  D2&       yy = static_cast<D2&>(y);
+  internal::assertSameShape(xx, yy, "**ERROR**: axpy(): incompatible shapes");
+  if (!internal::BulkPair<D1,D2>::axpy(a, xx, yy))
+    internal::assignExpr(y, y + a*x);
+}
+
+// x(i) *= a
+template<class Derived, int Rank, Options Opts>
+void scale(ArrayBase<Derived,Rank,Opts>& x, typename internal::BulkTraits<Derived>::value_type const& a)
+{
+  typedef typename internal::BulkTraits<Derived>::Kernels Kernels;
+  Derived& xx = static_cast<Derived&>(x);
+  if (typename internal::Traits<Derived>::pointer p = internal::ContiguousData<Derived>::get(xx))
+    Kernels::scale(p, a, xx.size());
+  else
+    internal::assignExpr(x, x*a);
+}
+
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type sum(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::Kernels    Kernels;
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  Derived const& a = static_cast<Derived const&>(x);
+  if (typename internal::Traits<Derived>::const_pointer p = internal::ContiguousData<Derived>::get(a))
+    return Kernels::sum(p, a.size());
+  internal::SumFun<Derived, T> f(a);
+  internal::forEachIndex(x, f);
+  return f.s;
+}
+
+// x must not be empty
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type minValue(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::Kernels    Kernels;
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  Derived const& a = static_cast<Derived const&>(x);
+  internal::assertTrue(a.size() > 0, "**ERROR**: minValue(): empty array");
+  if (typename internal::Traits<Derived>::const_pointer p = internal::ContiguousData<Derived>::get(a))
+    return Kernels::min(p, a.size());
+  std::size_t const zero[Rank] = {};
+  internal::MinMaxFun<Derived, T> f(a, a(zero));
+  internal::forEachIndex(x, f);
+  return f.lo;
+}
+
+// x must not be empty
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type maxValue(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::Kernels    Kernels;
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  Derived const& a = static_cast<Derived const&>(x);
+  internal::assertTrue(a.size() > 0, "**ERROR**: maxValue(): empty array");
+  if (typename internal::Traits<Derived>::const_pointer p = internal::ContiguousData<Derived>::get(a))
+    return Kernels::max(p, a.size());
+  std::size_t const zero[Rank] = {};
+  internal::MinMaxFun<Derived, T> f(a, a(zero));
+  internal::forEachIndex(x, f);
+  return f.hi;
+}
+
+// sum of x(i)*y(i); shapes must agree
+template<class D1, int Rank, Options O1, class D2, Options O2>
+typename internal::BulkTraits<D1>::value_type dot(ArrayBase<D1,Rank,O1> const& x, ArrayBase<D2,Rank,O2> const& y)
+{
+  typedef typename internal::BulkTraits<D1>::value_type T;
+  D1 const& a = static_cast<D1 const&>(x);
+  D2 const& b = static_cast<D2 const&>(y);
+  internal::assertSameShape(a, b, "**ERROR**: dot(): incompatible shapes");
+  T s = T();
+  if (internal::BulkPair<D1,D2>::dot(a, b, s))
+    return s;
+  internal::DotFun<D1, D2, T> f(a, b);
+  internal::forEachIndex(x, f);
+  return f.s;
 }
 
 
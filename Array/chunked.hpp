@@ -0,0 +1,563 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_CHUNKED_HPP
+#define MA_CHUNKED_HPP
+
+#include "io.hpp"
+#include <list>
+#include <map>
+
+// Arrays larger than memory, stored in one file as fixed-size tiles
+// (chunks) and accessed through an LRU cache of tiles. The file is
+//
+//    page 0      a FileHeader (see Array/io.hpp) tagged "MACHUNK", then the
+//                tile extents, one word per rank
+//    page 1...   the tile index: offset and size in bytes of each stored
+//                tile, two words per tile; (0, 0) for tiles never written,
+//                which read as zeros
+//    then        the tiles, each a dense block of the tile extents (edge
+//                tiles are padded) in the major order of the array, or
+//                that block encoded by Array/codec.hpp when compressed
+//
+// The tiles are numbered in the major order of the array too.
+
+// default memory budget of the tile cache, in bytes
+#ifndef MA_CHUNK_CACHE
+#define MA_CHUNK_CACHE (std::size_t(1) << 28)
+#endif
+
+namespace marray {
+
+namespace internal
+{
+  inline char const* chunkedTag()
+  { return "MACHUNK"; }
+
+  inline std::size_t roundToPage(std::size_t n)
+  { return (n + MA_FILE_DATA_OFFSET - 1) / MA_FILE_DATA_OFFSET * MA_FILE_DATA_OFFSET; }
+
+  inline void throwChunkedError(char const* what, char const* where)
+  {
+    throw std::runtime_error(std::string("**ERROR**: ChunkedArray<>: ") + what + " `" + where + "`");
+  }
+
+  // the tile index and the raw tile reads and writes of a chunked file
+  class TileFile
+  {
+  public:
+    TileFile() : m_end(0), m_indexDirty(false)
+    { }
+
+    void open(char const* path, bool writable, bool create)
+    {
+      m_path = path;
+      std::ios::openmode mode = std::ios::in | std::ios::binary;
+      if (writable)
+        mode |= std::ios::out;
+      if (create)
+        mode |= std::ios::trunc;
+      m_file.open(path, mode);
+      if (!m_file)
+        throwChunkedError(create ? "cannot create" : "cannot open", path);
+    }
+
+    char const* path() const
+    { return m_path.c_str(); }
+
+    // a new, empty index of `ntiles` tiles
+    void initIndex(std::size_t ntiles)
+    {
+      m_index.assign(2*ntiles, 0);
+      m_end = roundToPage(MA_FILE_DATA_OFFSET + 16*ntiles);
+      m_indexDirty = true;
+    }
+
+    void readIndex(std::size_t ntiles)
+    {
+      std::vector<char> buf(16*ntiles + 1);
+      readAt(MA_FILE_DATA_OFFSET, &buf[0], 16*ntiles);
+      m_index.resize(2*ntiles);
+      m_end = roundToPage(MA_FILE_DATA_OFFSET + 16*ntiles);
+      for (std::size_t i = 0; i < 2*ntiles; ++i)
+        m_index[i] = getWord(&buf[8*i]);
+      for (std::size_t t = 0; t < ntiles; ++t)
+        m_end = std::max(m_end, m_index[2*t] + m_index[2*t+1]);
+      m_indexDirty = false;
+    }
+
+    bool stored(std::size_t t) const
+    { return m_index[2*t+1] > 0; }
+
+    std::size_t storedBytes(std::size_t t) const
+    { return m_index[2*t+1]; }
+
+    // the `n` bytes of tile `t`, which must be stored
+    void readTile(std::size_t t, char* p, std::size_t n)
+    {
+      if (m_index[2*t+1] != n)
+        throwChunkedError("corrupt tile index in", path());
+      readAt(m_index[2*t], p, n);
+    }
+
+    // tiles keep their place in the file when rewritten with the same size
+    void writeTile(std::size_t t, char const* p, std::size_t n)
+    {
+      if (m_index[2*t+1] < n)
+      {
+        m_index[2*t] = m_end;
+        m_end += n;
+      }
+      m_index[2*t+1] = n;
+      m_indexDirty = true;
+      writeAt(m_index[2*t], p, n);
+    }
+
+    void writeHeader(char const* page)
+    { writeAt(0, page, MA_FILE_DATA_OFFSET); }
+
+    void readHeader(char* page)
+    { readAt(0, page, MA_FILE_DATA_OFFSET); }
+
+    void flush()
+    {
+      if (m_indexDirty)
+      {
+        std::vector<char> buf(8*m_index.size() + 1);
+        for (std::size_t i = 0; i < m_index.size(); ++i)
+          putWord(&buf[8*i], m_index[i]);
+        writeAt(MA_FILE_DATA_OFFSET, &buf[0], 8*m_index.size());
+        m_indexDirty = false;
+      }
+      m_file.flush();
+      if (!m_file)
+        throwChunkedError("write failed on", path());
+    }
+
+  private:
+    void readAt(std::size_t pos, char* p, std::size_t n)
+    {
+      m_file.seekg(std::streamoff(pos));
+      if (!m_file.read(p, std::streamsize(n)))
+        throwChunkedError("truncated file", path());
+    }
+
+    void writeAt(std::size_t pos, char const* p, std::size_t n)
+    {
+      m_file.seekp(std::streamoff(pos));
+      if (!m_file.write(p, std::streamsize(n)))
+        throwChunkedError("write failed on", path());
+    }
+
+    std::fstream             m_file;
+    std::string              m_path;
+    std::vector<std::size_t> m_index;
+    std::size_t              m_end;
+    bool                     m_indexDirty;
+  };
+}
+
+
+// An N-D array stored on disk in tiles, e.g.
+//
+//    std::size_t dims[] = {4096, 4096, 4096}, tile[] = {64, 64, 64};
+//    ChunkedArray<float, 3> V("volume.chunks", dims, tile, 1 << 30);   // 1 GiB of cache
+//    V.set(idx, 1.f);
+//    Array<float, 3> B(128, 128, 128);
+//    V.read(first, B);      // the box [first, first + dims of B)
+//
+// Elements are read and written by value, through the cache: `operator()`
+// and `set()` for single elements, `read()` and `write()` for boxes, which
+// go tile by tile. The cache holds at most `cacheBytes` of tiles (at least
+// one tile); dirty tiles are written back when evicted, by `flush()` and
+// on destruction. With `ShuffleLz` compression the tiles are encoded when
+// written back and decoded when loaded. Not thread safe.
+template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR>
+class ChunkedArray
+{
+  // the tiles are in row or column major order
+  enum { DummyLayout = sizeof(internal::ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<P_opts>) };
+
+public:
+  typedef P_type      UserT;
+  typedef std::size_t size_type;
+  static const int  Rank = P_rank;
+  static const bool isRowMajor = P_opts & RowMajor;
+
+  // creates (or truncates) the file; the elements are zero. `tile[r]` is
+  // the tile extent of rank r, 0 meaning the whole extent. Compressed
+  // tiles take their encoded size in the file.
+  template<class D, class E>
+  ChunkedArray(char const* path, D const dims[], E const tile[], std::size_t cacheBytes = MA_CHUNK_CACHE,
+               Compression compression = Uncompressed)
+    : m_writable(true), m_compression(compression)
+  {
+    m_file.open(path, true, true);
+    for (int r = 0; r < Rank; ++r)
+    {
+      internal::assertTrue(dims[r] > 0, "**ERROR**: ChunkedArray<>: dimension must be greater than 0");
+      m_dims[r] = dims[r];
+      m_tile[r] = tile[r] > 0 && size_type(tile[r]) < m_dims[r] ? tile[r] : m_dims[r];
+    }
+    setup(cacheBytes);
+    m_file.initIndex(m_ntiles);
+
+    internal::FileHeader h = internal::FileHeader::make<UserT,Rank>(m_dims, isRowMajor);
+    h.compression = compression;
+    h.blockBytes = compression == Uncompressed ? 0 : m_tileSize*sizeof(UserT);
+    char page[MA_FILE_DATA_OFFSET];
+    h.encode(page, internal::chunkedTag());
+    for (int r = 0; r < Rank; ++r)
+      internal::putWord(page + h.endOffset() + 8*r, m_tile[r]);
+    m_file.writeHeader(page);
+    m_file.flush();
+  }
+
+  // opens a file written by ChunkedArray; the element type, rank and major
+  // order must match
+  explicit ChunkedArray(char const* path, MapMode mode = ReadOnly, std::size_t cacheBytes = MA_CHUNK_CACHE)
+    : m_writable(mode == ReadWrite), m_compression(Uncompressed)
+  {
+    m_file.open(path, m_writable, false);
+    char page[MA_FILE_DATA_OFFSET];
+    m_file.readHeader(page);
+    internal::FileHeader h;
+    char const* err = h.decode(page, internal::chunkedTag());
+    if (err || (err = h.check<UserT,Rank>(isRowMajor)))
+      internal::throwChunkedError(err, path);
+    for (int r = 0; r < Rank; ++r)
+    {
+      m_dims[r] = h.dims[r];
+      m_tile[r] = internal::getWord(page + h.endOffset() + 8*r);
+      if (m_dims[r] == 0 || m_tile[r] == 0 || m_tile[r] > m_dims[r])
+        internal::throwChunkedError("invalid tile extents in", path);
+    }
+    setup(cacheBytes);
+    m_compression = Compression(h.compression);
+    if (m_compression != Uncompressed && h.blockBytes != m_tileSize*sizeof(UserT))
+      internal::throwChunkedError("invalid tile size in", path);
+    m_file.readIndex(m_ntiles);
+  }
+
+  ~ChunkedArray()
+  {
+    try { flush(); }
+    catch (...) { }
+  }
+
+  int rank() const
+  { return Rank; }
+
+  size_type dim(int r) const
+  {
+    internal::assertTrue(r < Rank, "**ERROR**: ChunkedArray<>: invalid rank in function `dim()`");
+    return m_dims[r];
+  }
+
+  size_type size() const
+  { return m_size; }
+
+  // tile extent of rank `r`
+  size_type tile(int r) const
+  {
+    internal::assertTrue(r < Rank, "**ERROR**: ChunkedArray<>: invalid rank in function `tile()`");
+    return m_tile[r];
+  }
+
+  size_type numTiles() const
+  { return m_ntiles; }
+
+  Compression compression() const
+  { return m_compression; }
+
+  // number of tiles the cache can hold
+  size_type cacheTiles() const
+  { return m_capacity; }
+
+  // tile lookups served by the cache, and tiles read from the file
+  std::size_t hits() const   { return m_hits; }
+  std::size_t misses() const { return m_misses; }
+
+  template<class Idx_t>
+  UserT operator() (Idx_t const idx[]) const
+  {
+    size_type t, off;
+    locate(idx, t, off);
+    return fetch(t, false)[off];
+  }
+
+#if __cplusplus >= 201103L
+  template<class... Idx, class = typename internal::IfIndices<Idx...>::type>
+  UserT operator() (Idx... i) const
+  {
+    MA_STATIC_CHECK(sizeof...(Idx) == Rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP);
+    size_type const idx[] = {size_type(i)...};
+    return (*this)(idx);
+  }
+#else
+#define MA_CHUNKED_CALL_OP(n_args)                                \
+  UserT operator() (MA_EXPAND_ARGS(n_args, size_type)) const      \
+  {                                                               \
+    MA_STATIC_CHECK(n_args == Rank, INVALID_NUMBER_OF_ARGS_IN_CALL_OP); \
+    size_type const idx[] = {MA_EXPAND_SEQ(n_args)};              \
+    return (*this)(idx);                                          \
+  }
+
+  MA_CHUNKED_CALL_OP( 1)
+  MA_CHUNKED_CALL_OP( 2)
+  MA_CHUNKED_CALL_OP( 3)
+  MA_CHUNKED_CALL_OP( 4)
+  MA_CHUNKED_CALL_OP( 5)
+  MA_CHUNKED_CALL_OP( 6)
+  MA_CHUNKED_CALL_OP( 7)
+  MA_CHUNKED_CALL_OP( 8)
+  MA_CHUNKED_CALL_OP( 9)
+  MA_CHUNKED_CALL_OP(10)
+#undef MA_CHUNKED_CALL_OP
+#endif
+
+  template<class Idx_t>
+  void set(Idx_t const idx[], UserT const& v)
+  {
+    size_type t, off;
+    locate(idx, t, off);
+    fetch(t, true)[off] = v;
+  }
+
+  // out(i) = (*this)(first + i) for every multi-index i of `out`
+  template<class Idx_t, class Derived, Options Opts>
+  void read(Idx_t const first[], ArrayBase<Derived,Rank,Opts>& out) const
+  {
+    Derived& o = static_cast<Derived&>(out);
+    CopyOut<Derived> f(o);
+    forEachInBox(first, out.rdims(), f, false);
+  }
+
+  // (*this)(first + i) = in(i) for every multi-index i of `in`
+  template<class Idx_t, class Derived, Options Opts>
+  void write(Idx_t const first[], ArrayBase<Derived,Rank,Opts> const& in)
+  {
+    Derived const& a = static_cast<Derived const&>(in);
+    CopyIn<Derived> f(a);
+    forEachInBox(first, in.rdims(), f, true);
+  }
+
+  // writes the dirty tiles and the tile index to the file
+  void flush()
+  {
+    if (!m_writable)
+      return;
+    for (typename Lru::iterator s = m_lru.begin(); s != m_lru.end(); ++s)
+      store(*s);
+    m_file.flush();
+  }
+
+private:
+  ChunkedArray(ChunkedArray const&);
+  ChunkedArray& operator=(ChunkedArray const&);
+
+  struct Slot
+  {
+    size_type           tile;
+    bool                dirty;
+    AlignedBlock<UserT> data;
+  };
+
+  // most recently used first
+  typedef std::list<Slot>                                Lru;
+  typedef std::map<size_type, typename Lru::iterator>    Where;
+
+  template<class Derived>
+  struct CopyOut
+  {
+    Derived& a;
+    explicit CopyOut(Derived& a_) : a(a_) { }
+    void operator()(size_type const i[], UserT* p) const { a(i) = *p; }
+  };
+
+  template<class Derived>
+  struct CopyIn
+  {
+    Derived const& a;
+    explicit CopyIn(Derived const& a_) : a(a_) { }
+    void operator()(size_type const i[], UserT* p) const { *p = a(i); }
+  };
+
+  void setup(std::size_t cacheBytes)
+  {
+    m_size = m_tileSize = m_ntiles = 1;
+    for (int k = 0; k < Rank; ++k)
+    {
+      int const r = isRowMajor ? Rank-1-k : k;     // from the fastest rank
+      m_ntile[r] = (m_dims[r] + m_tile[r] - 1) / m_tile[r];
+      m_tileStride[r] = m_ntiles;
+      m_elemStride[r] = m_tileSize;
+      m_size *= m_dims[r];
+      m_ntiles *= m_ntile[r];
+      m_tileSize *= m_tile[r];
+    }
+    m_capacity = std::max(cacheBytes / (m_tileSize*sizeof(UserT)), std::size_t(1));
+    m_hits = m_misses = 0;
+  }
+
+  template<class Idx_t>
+  void locate(Idx_t const idx[], size_type& t, size_type& off) const
+  {
+    internal::BoundCheck<Rank>::check(m_dims, idx);
+    t = off = 0;
+    for (int r = 0; r < Rank; ++r)
+    {
+      t += (idx[r] / m_tile[r]) * m_tileStride[r];
+      off += (idx[r] % m_tile[r]) * m_elemStride[r];
+    }
+  }
+
+  // the elements of tile `t`, through the cache
+  UserT* fetch(size_type t, bool forWrite) const
+  {
+    if (!m_lru.empty() && m_lru.front().tile == t)
+      ++m_hits;
+    else
+    {
+      typename Where::iterator w = m_where.find(t);
+      if (w != m_where.end())
+      {
+        ++m_hits;
+        m_lru.splice(m_lru.begin(), m_lru, w->second);
+      }
+      else
+      {
+        ++m_misses;
+        if (m_lru.size() < m_capacity)
+        {
+          m_lru.push_front(Slot());
+          m_lru.front().data.resize(m_tileSize);
+        }
+        else
+        {
+          store(m_lru.back());
+          m_where.erase(m_lru.back().tile);
+          m_lru.splice(m_lru.begin(), m_lru, --m_lru.end());
+        }
+        Slot& s = m_lru.front();
+        s.tile = t;
+        s.dirty = false;
+        load(s);
+        m_where[t] = m_lru.begin();
+      }
+    }
+    if (forWrite)
+    {
+      if (!m_writable)
+        internal::throwChunkedError("write to a read-only file", m_file.path());
+      m_lru.front().dirty = true;
+    }
+    return m_lru.front().data.data();
+  }
+
+  void load(Slot& s) const
+  {
+    char* p = reinterpret_cast<char*>(s.data.data());
+    if (m_file.stored(s.tile) && m_compression != Uncompressed)
+    {
+      m_packed.resize(m_file.storedBytes(s.tile));
+      m_file.readTile(s.tile, &m_packed[0], m_packed.size());
+      if (!internal::decodeBlock(&m_packed[0], m_packed.size(), p, m_tileSize, sizeof(UserT), m_scratch))
+        internal::throwChunkedError("corrupt tile in", m_file.path());
+    }
+    else if (m_file.stored(s.tile))
+      m_file.readTile(s.tile, p, m_tileSize*sizeof(UserT));
+    else
+      std::fill(s.data.begin(), s.data.end(), UserT());
+  }
+
+  void store(Slot& s) const
+  {
+    if (!s.dirty)
+      return;
+    char const* p = reinterpret_cast<char const*>(s.data.data());
+    if (m_compression != Uncompressed)
+    {
+      internal::encodeBlock(p, m_tileSize, sizeof(UserT), m_packed, m_scratch);
+      m_file.writeTile(s.tile, &m_packed[0], m_packed.size());
+    }
+    else
+      m_file.writeTile(s.tile, p, m_tileSize*sizeof(UserT));
+    s.dirty = false;
+  }
+
+  // f(i, p) for each multi-index i of the box [first, first + ext), p
+  // pointing to the element first + i in its tile; tile by tile. Nothing
+  // for an empty box.
+  template<class Idx_t, class F>
+  void forEachInBox(Idx_t const first_[], size_type const ext[], F const& f, bool forWrite) const
+  {
+    for (int r = 0; r < Rank; ++r)
+      if (ext[r] == 0)
+        return;
+
+    size_type first[Rank], nt[Rank], tlo[Rank], tk[Rank];
+    for (int r = 0; r < Rank; ++r)
+    {
+      first[r] = first_[r];
+      internal::assertTrue(first[r] + ext[r] <= m_dims[r], "**ERROR**: ChunkedArray<>: box out of range");
+      tlo[r] = first[r] / m_tile[r];
+      nt[r] = (first[r] + ext[r] - 1) / m_tile[r] - tlo[r] + 1;
+      tk[r] = 0;
+    }
+    size_type ntiles = 1;
+    for (int r = 0; r < Rank; ++r)
+      ntiles *= nt[r];
+
+    for (size_type n = 0; n < ntiles; ++n, internal::nextIndex<Rank>(tk, nt, isRowMajor))
+    {
+      // the part of the box in this tile, relative to the box
+      size_type lo[Rank], cnt[Rank], k[Rank], i[Rank], t = 0, count = 1;
+      for (int r = 0; r < Rank; ++r)
+      {
+        size_type const ts = (tlo[r] + tk[r]) * m_tile[r];
+        size_type const a = std::max(ts, first[r]);
+        size_type const b = std::min(ts + m_tile[r], first[r] + ext[r]);
+        lo[r] = a - first[r];
+        cnt[r] = b - a;
+        k[r] = 0;
+        t += (tlo[r] + tk[r]) * m_tileStride[r];
+        count *= cnt[r];
+      }
+      UserT* p = fetch(t, forWrite);
+      for (size_type e = 0; e < count; ++e, internal::nextIndex<Rank>(k, cnt, isRowMajor))
+      {
+        size_type off = 0;
+        for (int r = 0; r < Rank; ++r)
+        {
+          i[r] = lo[r] + k[r];
+          off += ((first[r] + i[r]) % m_tile[r]) * m_elemStride[r];
+        }
+        f(static_cast<size_type const*>(i), p + off);
+      }
+    }
+  }
+
+  size_type m_dims[Rank], m_tile[Rank], m_ntile[Rank];
+  size_type m_tileStride[Rank], m_elemStride[Rank];
+  size_type   m_size, m_tileSize, m_ntiles, m_capacity;
+  bool        m_writable;
+  Compression m_compression;
+
+  mutable internal::TileFile m_file;
+  mutable Lru                m_lru;
+  mutable Where              m_where;
+  mutable std::size_t        m_hits, m_misses;
+
+  // encoded tiles, when compressed
+  mutable std::vector<char>      m_packed;
+  mutable internal::CodecScratch m_scratch;
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,230 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_CODEC_HPP
+#define MA_CODEC_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+// The block codec of compressed array files (see Array/io.hpp). A block of
+// n elements of e bytes is
+//
+//  1. XORed with the previous element: the sign, exponent and leading
+//     mantissa bits of smooth floating point data cancel out;
+//  2. byte shuffled: byte k of every element goes to plane k, so the
+//     zeroed high bytes form long runs;
+//  3. compressed by a byte-oriented LZ coder (LZ4-like sequences of
+//     literals and matches within 64 KiB).
+//
+// An encoded block no smaller than the raw one is stored raw instead, so a
+// block never grows. The low mantissa bytes of full-precision data do not
+// cancel out, so the gain comes mostly from quantized data (values that
+// are multiples of a power of two).
+
+namespace marray {
+
+// how the elements of an array file are stored
+enum Compression {
+  Uncompressed = 0,
+  ShuffleLz    = 1    // per block: XOR delta, byte shuffle and LZ
+};
+
+namespace internal
+{
+  // per-thread buffers of the codec
+  struct CodecScratch
+  {
+    std::vector<unsigned char> bytes;
+    std::vector<std::size_t>   table;
+  };
+
+  static const int         lzHashBits = 14;
+  static const std::size_t lzMinMatch = 4;
+  static const std::size_t lzMaxOffset = 65535;
+
+  inline std::size_t lzBound(std::size_t n)
+  { return n + n/255 + 16; }
+
+  inline std::size_t lzHash(unsigned char const* p)
+  {
+    unsigned long const v = p[0] | (unsigned long)p[1] << 8 | (unsigned long)p[2] << 16 | (unsigned long)p[3] << 24;
+    return ((v * 2654435761UL) & 0xffffffffUL) >> (32 - lzHashBits);
+  }
+
+  // a length continued in bytes of 255 when it does not fit its nibble
+  inline unsigned char* lzPutLength(unsigned char* op, std::size_t len)
+  {
+    for (; len >= 255; len -= 255)
+      *op++ = 255;
+    *op++ = (unsigned char)len;
+    return op;
+  }
+
+  // one sequence: a token, the literals [lit, lit+nlit), and a match of
+  // `len` bytes at distance `off` unless `len` is 0 (the last sequence)
+  inline unsigned char* lzPutSequence(unsigned char* op, unsigned char const* lit, std::size_t nlit,
+                                      std::size_t off, std::size_t len)
+  {
+    std::size_t const m = len ? len - lzMinMatch : 0;
+    unsigned char* token = op++;
+    *token = (unsigned char)((std::min(nlit, std::size_t(15)) << 4) | std::min(m, std::size_t(15)));
+    if (nlit >= 15)
+      op = lzPutLength(op, nlit - 15);
+    std::memcpy(op, lit, nlit);
+    op += nlit;
+    if (len)
+    {
+      *op++ = (unsigned char)(off & 0xff);
+      *op++ = (unsigned char)(off >> 8);
+      if (m >= 15)
+        op = lzPutLength(op, m - 15);
+    }
+    return op;
+  }
+
+  // compresses the n bytes of `in` into `out`, of lzBound(n) bytes; returns
+  // the compressed size
+  inline std::size_t lzCompress(unsigned char const* in, std::size_t n, unsigned char* out,
+                                std::vector<std::size_t>& table)
+  {
+    table.assign(std::size_t(1) << lzHashBits, 0);    // positions + 1
+    unsigned char* op = out;
+    std::size_t ip = 0, anchor = 0;
+    while (ip + lzMinMatch <= n)
+    {
+      std::size_t& slot = table[lzHash(in + ip)];
+      std::size_t const ref = slot;
+      slot = ip + 1;
+      if (ref && ip + 1 - ref <= lzMaxOffset && std::memcmp(in + ref - 1, in + ip, lzMinMatch) == 0)
+      {
+        std::size_t len = lzMinMatch;
+        while (ip + len < n && in[ref - 1 + len] == in[ip + len])
+          ++len;
+        op = lzPutSequence(op, in + anchor, ip - anchor, ip + 1 - ref, len);
+        ip += len;
+        anchor = ip;
+      }
+      else
+        ip += 1 + ((ip - anchor) >> 6);     // skip faster through incompressible data
+    }
+    return lzPutSequence(op, in + anchor, n - anchor, 0, 0) - out;
+  }
+
+  inline bool lzGetLength(unsigned char const*& ip, unsigned char const* end, std::size_t& len)
+  {
+    unsigned char b;
+    do {
+      if (ip == end)
+        return false;
+      b = *ip++;
+      len += b;
+    } while (b == 255);
+    return true;
+  }
+
+  // decompresses `in` into exactly n bytes of `out`; false if corrupt
+  inline bool lzDecompress(unsigned char const* in, std::size_t csize, unsigned char* out, std::size_t n)
+  {
+    unsigned char const* ip = in;
+    unsigned char const* const end = in + csize;
+    std::size_t op = 0;
+    while (ip != end)
+    {
+      unsigned char const token = *ip++;
+      std::size_t nlit = token >> 4;
+      if (nlit == 15 && !lzGetLength(ip, end, nlit))
+        return false;
+      if (nlit > std::size_t(end - ip) || nlit > n - op)
+        return false;
+      std::memcpy(out + op, ip, nlit);
+      ip += nlit;
+      op += nlit;
+      if (ip == end)
+        break;
+
+      if (end - ip < 2)
+        return false;
+      std::size_t const off = ip[0] | std::size_t(ip[1]) << 8;
+      ip += 2;
+      std::size_t len = token & 15;
+      if (len == 15 && !lzGetLength(ip, end, len))
+        return false;
+      len += lzMinMatch;
+      if (off == 0 || off > op || len > n - op)
+        return false;
+      for (std::size_t k = 0; k < len; ++k, ++op)   // the match may overlap its copy
+        out[op] = out[op - off];
+    }
+    return op == n;
+  }
+
+  // encodes the n elements of e bytes at `src` into `out`; returns the
+  // encoded size, equal to n*e when the block is stored raw
+  inline std::size_t encodeBlock(char const* src, std::size_t n, std::size_t e, std::vector<char>& out,
+                                 CodecScratch& s)
+  {
+    std::size_t const bytes = n*e;
+    unsigned char const* in = reinterpret_cast<unsigned char const*>(src);
+    s.bytes.resize(bytes + 1);
+    unsigned char* shuffled = &s.bytes[0];
+    for (std::size_t k = 0; k < e; ++k)
+    {
+      unsigned char* plane = shuffled + k*n;
+      unsigned char prev = 0;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        unsigned char const b = in[i*e + k];
+        plane[i] = b ^ prev;
+        prev = b;
+      }
+    }
+
+    out.resize(lzBound(bytes));
+    std::size_t const c = lzCompress(shuffled, bytes, reinterpret_cast<unsigned char*>(&out[0]), s.table);
+    if (c >= bytes)
+    {
+      out.assign(src, src + bytes);
+      return bytes;
+    }
+    out.resize(c);
+    return c;
+  }
+
+  // decodes a block of `csize` bytes into the n elements of e bytes at
+  // `dst`; false if corrupt
+  inline bool decodeBlock(char const* src, std::size_t csize, char* dst, std::size_t n, std::size_t e,
+                          CodecScratch& s)
+  {
+    std::size_t const bytes = n*e;
+    if (csize == bytes)
+    {
+      std::memcpy(dst, src, bytes);
+      return true;
+    }
+    s.bytes.resize(bytes + 1);
+    unsigned char* shuffled = &s.bytes[0];
+    if (!lzDecompress(reinterpret_cast<unsigned char const*>(src), csize, shuffled, bytes))
+      return false;
+
+    unsigned char* o = reinterpret_cast<unsigned char*>(dst);
+    for (std::size_t k = 0; k < e; ++k)
+    {
+      unsigned char const* plane = shuffled + k*n;
+      unsigned char prev = 0;
+      for (std::size_t i = 0; i < n; ++i)
+        o[i*e + k] = prev = plane[i] ^ prev;
+    }
+    return true;
+  }
+}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,682 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_IO_HPP
+#define MA_IO_HPP
+
+#include "parallel.hpp"
+#include "codec.hpp"
+#include <istream>
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <complex>
+#include <limits>
+
+// Binary array files. The header takes the first MA_FILE_DATA_OFFSET bytes
+// (one page, so that the file can be mapped, see Array/mapped.hpp); its
+// integers are 8-byte little-endian words:
+//
+//    bytes 0-7     "MARRAY1\0"
+//    word 1        element type (ElementType)
+//    word 2        element size in bytes
+//    word 3        flags: 1 = row major, 2 = little-endian payload
+//    word 4        rank
+//    words 5...    dims
+//    word 5+rank   compression (Compression)
+//    word 6+rank   block size in bytes, when compressed
+//
+// and the rest of the page is zero. Then come the elements, in the major
+// order given by the flags, as they are in memory or, when compressed, as
+// a sequence of blocks, each an 8-byte word with its encoded size followed
+// by the block encoded by Array/codec.hpp.
+#ifndef MA_FILE_DATA_OFFSET
+#define MA_FILE_DATA_OFFSET 4096
+#endif
+
+// default size of a compressed block, in bytes
+#ifndef MA_COMPRESS_BLOCK
+#define MA_COMPRESS_BLOCK (std::size_t(1) << 20)
+#endif
+
+// bytes moved per stream read/write when the elements are not contiguous
+#ifndef MA_IO_CHUNK
+#define MA_IO_CHUNK (std::size_t(1) << 16)
+#endif
+
+namespace marray {
+
+// how array files are opened
+enum MapMode {
+  ReadOnly,   // writes to the array stay in the process (for a mapping, copy-on-write)
+  ReadWrite   // writes go to the file
+};
+
+enum ElementType {
+  OtherType = 0,    // checked by size only
+  Int8Type,   UInt8Type,
+  Int16Type,  UInt16Type,
+  Int32Type,  UInt32Type,
+  Int64Type,  UInt64Type,
+  Float32Type, Float64Type,
+  Complex64Type, Complex128Type,
+  BoolType
+};
+
+namespace internal
+{
+  template<std::size_t Bytes, bool isSigned>
+  struct IntegerType { static const int value = OtherType; };
+
+  template<> struct IntegerType<1, true>  { static const int value = Int8Type; };
+  template<> struct IntegerType<1, false> { static const int value = UInt8Type; };
+  template<> struct IntegerType<2, true>  { static const int value = Int16Type; };
+  template<> struct IntegerType<2, false> { static const int value = UInt16Type; };
+  template<> struct IntegerType<4, true>  { static const int value = Int32Type; };
+  template<> struct IntegerType<4, false> { static const int value = UInt32Type; };
+  template<> struct IntegerType<8, true>  { static const int value = Int64Type; };
+  template<> struct IntegerType<8, false> { static const int value = UInt64Type; };
+
+  template<class T>
+  struct ElementTypeOf { static const int value = OtherType; };
+
+  template<class T>
+  struct ElementTypeOf<T const> : ElementTypeOf<T> { };
+
+#define MA_INTEGER_ELEMENT(T) \
+  template<> struct ElementTypeOf<T> : IntegerType<sizeof(T), std::numeric_limits<T>::is_signed> { };
+
+  MA_INTEGER_ELEMENT(char)
+  MA_INTEGER_ELEMENT(signed char)
+  MA_INTEGER_ELEMENT(unsigned char)
+  MA_INTEGER_ELEMENT(short)
+  MA_INTEGER_ELEMENT(unsigned short)
+  MA_INTEGER_ELEMENT(int)
+  MA_INTEGER_ELEMENT(unsigned int)
+  MA_INTEGER_ELEMENT(long)
+  MA_INTEGER_ELEMENT(unsigned long)
+#if __cplusplus >= 201103L
+  MA_INTEGER_ELEMENT(long long)
+  MA_INTEGER_ELEMENT(unsigned long long)
+#endif
+#undef MA_INTEGER_ELEMENT
+
+  template<> struct ElementTypeOf<bool>   { static const int value = sizeof(bool) == 1 ? BoolType : OtherType; };
+  template<> struct ElementTypeOf<float>  { static const int value = sizeof(float) == 4 ? Float32Type : OtherType; };
+  template<> struct ElementTypeOf<double> { static const int value = sizeof(double) == 8 ? Float64Type : OtherType; };
+  template<> struct ElementTypeOf<std::complex<float> >  { static const int value = ElementTypeOf<float>::value == Float32Type ? Complex64Type : OtherType; };
+  template<> struct ElementTypeOf<std::complex<double> > { static const int value = ElementTypeOf<double>::value == Float64Type ? Complex128Type : OtherType; };
+
+  inline bool isLittleEndian()
+  {
+    unsigned const one = 1;
+    return *reinterpret_cast<unsigned char const*>(&one) == 1;
+  }
+
+  inline void putWord(char* p, std::size_t x)
+  {
+    for (int b = 0; b < 8; ++b, x >>= 8)
+      p[b] = char(x & 0xff);
+  }
+
+  inline std::size_t getWord(char const* p)
+  {
+    std::size_t x = 0;
+    for (int b = 7; b >= 0; --b)
+      x = (x << 8) | (unsigned char)p[b];
+    return x;
+  }
+
+  // bytes = dims[0]*...*dims[rank-1]*elemSize; false if a dim is 0 or the
+  // element count or the bytes do not fit a size_t
+  template<class D>
+  bool payloadBytes(D const dims[], std::size_t rank, std::size_t elemSize, std::size_t& bytes)
+  {
+    std::size_t n = 1;
+    for (std::size_t r = 0; r < rank; ++r)
+    {
+      std::size_t const d = dims[r];
+      if (d == 0 || n > std::size_t(-1)/d)
+        return false;
+      n *= d;
+    }
+    if (elemSize != 0 && n > std::size_t(-1)/elemSize)
+      return false;
+    bytes = n*elemSize;
+    return true;
+  }
+
+  // the header of an array file, see MA_FILE_DATA_OFFSET
+  struct FileHeader
+  {
+    std::size_t type, elemSize, rank, dims[MA_MAX_RANK];
+    std::size_t compression, blockBytes;
+    bool        isRowMajor, isLittleEndian;
+
+    FileHeader() : type(0), elemSize(0), rank(0), compression(Uncompressed), blockBytes(0),
+                   isRowMajor(true), isLittleEndian(true)
+    { }
+
+    template<class T, int Rank>
+    static FileHeader make(std::size_t const dims[], bool isRowMajor)
+    {
+      FileHeader h;
+      h.type = ElementTypeOf<T>::value;
+      h.elemSize = sizeof(T);
+      h.rank = Rank;
+      std::copy(dims, dims + Rank, h.dims);
+      h.isRowMajor = isRowMajor;
+      h.isLittleEndian = internal::isLittleEndian();
+      return h;
+    }
+
+    static char const* magic()
+    { return "MARRAY1"; }
+
+    std::size_t size() const
+    {
+      std::size_t n = 1;
+      for (std::size_t r = 0; r < rank; ++r)
+        n *= dims[r];
+      return n;
+    }
+
+    // first byte of the page after the header, where the files built on it
+    // keep their own fields
+    std::size_t endOffset() const
+    { return 56 + 8*rank; }
+
+    // `buf` has MA_FILE_DATA_OFFSET bytes; other files built on this header
+    // have their own 7-character `tag` in place of the magic
+    void encode(char* buf, char const* tag = magic()) const
+    {
+      std::fill(buf, buf + MA_FILE_DATA_OFFSET, char(0));
+      std::copy(tag, tag + 8, buf);
+      putWord(buf + 8, type);
+      putWord(buf + 16, elemSize);
+      putWord(buf + 24, (isRowMajor ? 1 : 0) | (isLittleEndian ? 2 : 0));
+      putWord(buf + 32, rank);
+      for (std::size_t r = 0; r < rank; ++r)
+        putWord(buf + 40 + 8*r, dims[r]);
+      putWord(buf + 40 + 8*rank, compression);
+      putWord(buf + 48 + 8*rank, blockBytes);
+    }
+
+    // returns an error message, or NULL
+    char const* decode(char const* buf, char const* tag = magic())
+    {
+      if (!std::equal(tag, tag + 8, buf))
+        return "not an array file";
+      type = getWord(buf + 8);
+      elemSize = getWord(buf + 16);
+      std::size_t const flags = getWord(buf + 24);
+      isRowMajor = flags & 1;
+      isLittleEndian = flags & 2;
+      rank = getWord(buf + 32);
+      if (rank < 1 || rank > MA_MAX_RANK)
+        return "invalid rank in";
+      for (std::size_t r = 0; r < rank; ++r)
+        dims[r] = getWord(buf + 40 + 8*r);
+      std::size_t bytes;
+      if (!payloadBytes(dims, rank, elemSize, bytes))
+        return "invalid dims in";
+      compression = getWord(buf + 40 + 8*rank);
+      blockBytes = getWord(buf + 48 + 8*rank);
+      if (compression > ShuffleLz)
+        return "unknown compression in";
+      if (compression != Uncompressed && (elemSize == 0 || blockBytes == 0 || blockBytes % elemSize != 0))
+        return "invalid block size in";
+      return NULL;
+    }
+
+    // returns an error message if the elements can not be read as an array
+    // of type T, rank `Rank` and major order `isRowMajor_`, NULL otherwise
+    template<class T, int Rank>
+    char const* check(bool isRowMajor_) const
+    {
+      if (elemSize != sizeof(T) || (int)type != ElementTypeOf<T>::value)
+        return "element type mismatch in";
+      if (rank != (std::size_t)Rank)
+        return "rank mismatch in";
+      if (isRowMajor != isRowMajor_)
+        return "major order mismatch in";
+      if (isLittleEndian != internal::isLittleEndian())
+        return "byte order mismatch in";
+      return NULL;
+    }
+  };
+
+  template<bool isTrivial>
+  struct ReshapeForLoad
+  {
+    template<class A>
+    static void run(A& a, std::size_t const dims[])
+    { a.reshape(dims); }
+  };
+
+  template<>
+  struct ReshapeForLoad<true>
+  {
+    template<class A>
+    static void run(A& a, std::size_t const dims[])
+    { a.reshape_uninitialized(dims); }
+  };
+
+  inline void throwIoError(char const* what, char const* where)
+  {
+    throw std::runtime_error(std::string("**ERROR**: array file: ") + what + " `" + where + "`");
+  }
+
+  // byte destination of `writeElements`
+  struct StreamSink
+  {
+    std::ostream& os;
+
+    explicit StreamSink(std::ostream& os_) : os(os_)
+    { }
+
+    void put(char const* p, std::size_t n)
+    { os.write(p, std::streamsize(n)); }
+  };
+
+  // sends the elements of `x` to `sink` in major order: straight from
+  // `data()` when contiguous, otherwise gathered MA_IO_CHUNK bytes at a time
+  template<class Sink, class Derived, int Rank, Options Opts>
+  void writeElements(Sink& sink, ArrayBase<Derived,Rank,Opts> const& x)
+  {
+    typedef typename Tr1::remove_const<typename Traits<Derived>::UserT>::type T;
+    Derived const& a = static_cast<Derived const&>(x);
+
+    if (T const* p = ContiguousData<Derived>::get(a))
+      sink.put(reinterpret_cast<char const*>(p), a.size()*sizeof(T));
+    else
+    {
+      std::size_t const chunk = std::max(MA_IO_CHUNK / sizeof(T), std::size_t(1));
+      AlignedBlock<T> buf(std::min(chunk, std::size_t(a.size())));
+      typedef typename ArrayBase<Derived,Rank,Opts>::const_nd_iterator It;
+      for (It it = x.ndbegin(), end = x.ndend(); it != end; )
+      {
+        std::size_t n = 0;
+        for (; it != end && n < buf.size(); ++it)
+          buf[n++] = *it;
+        sink.put(reinterpret_cast<char const*>(buf.data()), n*sizeof(T));
+      }
+    }
+  }
+
+  // reshapes `A` to `dims` and reads its elements, stored in its major
+  // order, with no intermediate buffer when its storage is contiguous
+  template<class T, int Rank, Options Opts, class M, bool L>
+  void readElements(std::istream& is, Array<T,Rank,Opts,M,L>& A, std::size_t const dims[], char const* where)
+  {
+    typedef Array<T,Rank,Opts,M,L> A_t;
+    ReshapeForLoad<IsTriviallyConstructible<T>::value>::run(A, dims);
+
+    std::size_t const chunk = std::max(MA_IO_CHUNK / sizeof(T), std::size_t(1));
+    std::size_t const n = A.size();
+    if (typename Traits<A_t>::pointer p = ContiguousData<A_t>::get(A))
+    {
+      for (std::size_t i = 0; i < n; i += chunk)
+        if (!is.read(reinterpret_cast<char*>(p + i), std::streamsize(std::min(chunk, n - i)*sizeof(T))))
+          throwIoError("truncated data in", where);
+    }
+    else
+    {
+      AlignedBlock<T> buf(std::min(chunk, n));
+      typename A_t::nd_iterator it = A.ndbegin();
+      for (std::size_t i = 0; i < n; i += chunk)
+      {
+        std::size_t const m = std::min(chunk, n - i);
+        if (!is.read(reinterpret_cast<char*>(buf.data()), std::streamsize(m*sizeof(T))))
+          throwIoError("truncated data in", where);
+        for (std::size_t k = 0; k < m; ++k, ++it)
+          *it = buf[k];
+      }
+    }
+  }
+
+  // Encodes the blocks of `blockN` elements of a batch of n elements at
+  // `src`, block k by worker k % parts.
+  struct EncodeBatch
+  {
+    char const*                      src;
+    std::size_t                      n, blockN, elemSize;
+    std::vector<std::vector<char> >& packed;
+    std::vector<CodecScratch>&       scratch;
+    int                              parts;
+
+    void operator()(int p)
+    {
+      for (std::size_t k = p; k*blockN < n; k += parts)
+        encodeBlock(src + k*blockN*elemSize, std::min(blockN, n - k*blockN), elemSize, packed[k], scratch[p]);
+    }
+  };
+
+  // the inverse of EncodeBatch; bad[p] is set if worker p met a corrupt block
+  struct DecodeBatch
+  {
+    char*                                  dst;
+    std::size_t                            n, blockN, elemSize;
+    std::vector<std::vector<char> > const& packed;
+    std::vector<CodecScratch>&             scratch;
+    std::vector<int>&                      bad;
+    int                                    parts;
+
+    void operator()(int p)
+    {
+      for (std::size_t k = p; k*blockN < n; k += parts)
+        if (!decodeBlock(&packed[k][0], packed[k].size(), dst + k*blockN*elemSize,
+                         std::min(blockN, n - k*blockN), elemSize, scratch[p]))
+          bad[p] = 1;
+    }
+  };
+
+  // writes the elements of `x`, in major order, as compressed blocks of
+  // `blockN` elements; batches of blocks are encoded in parallel, straight
+  // from `data()` when contiguous
+  template<class Derived, int Rank, Options Opts>
+  void writeCompressed(std::ostream& os, ArrayBase<Derived,Rank,Opts> const& x, std::size_t blockN)
+  {
+    typedef typename Tr1::remove_const<typename Traits<Derived>::UserT>::type T;
+    Derived const& a = static_cast<Derived const&>(x);
+
+    std::size_t const n = a.size();
+    int const parts = num_threads();
+    std::size_t const batch = std::min(4*parts*blockN, n);
+    T const* p = ContiguousData<Derived>::get(a);
+    AlignedBlock<T> stage(p ? 0 : batch);
+    std::vector<std::vector<char> > packed(4*parts);
+    std::vector<CodecScratch> scratch(parts);
+    typename ArrayBase<Derived,Rank,Opts>::const_nd_iterator it = x.ndbegin();
+
+    for (std::size_t i = 0; i < n; i += batch)
+    {
+      std::size_t const m = std::min(batch, n - i), nblocks = (m + blockN - 1) / blockN;
+      if (!p)
+        for (std::size_t k = 0; k < m; ++k, ++it)
+          stage[k] = *it;
+      int const workers = (int)std::min(std::size_t(parts), nblocks);
+      EncodeBatch body = {reinterpret_cast<char const*>(p ? p + i : stage.data()), m, blockN, sizeof(T),
+                          packed, scratch, workers};
+      runParallel(workers, body);
+
+      char word[8];
+      for (std::size_t k = 0; k < nblocks; ++k)
+      {
+        putWord(word, packed[k].size());
+        os.write(word, 8);
+        os.write(&packed[k][0], std::streamsize(packed[k].size()));
+      }
+    }
+  }
+
+  // reshapes `A` to the dims of `h` and reads its elements, stored as
+  // compressed blocks; batches of blocks are decoded in parallel, straight
+  // into `data()` when contiguous
+  template<class T, int Rank, Options Opts, class M, bool L>
+  void readCompressed(std::istream& is, Array<T,Rank,Opts,M,L>& A, FileHeader const& h, char const* where)
+  {
+    typedef Array<T,Rank,Opts,M,L> A_t;
+    ReshapeForLoad<IsTriviallyConstructible<T>::value>::run(A, h.dims);
+
+    std::size_t const n = A.size(), blockN = h.blockBytes / sizeof(T);
+    int const parts = num_threads();
+    std::size_t const batch = std::min(4*parts*blockN, n);
+    typename Traits<A_t>::pointer p = ContiguousData<A_t>::get(A);
+    AlignedBlock<T> stage(p ? 0 : batch);
+    typename A_t::nd_iterator it = A.ndbegin();
+    std::vector<std::vector<char> > packed(4*parts);
+    std::vector<CodecScratch> scratch(parts);
+    std::vector<int> bad(parts);
+
+    for (std::size_t i = 0; i < n; i += batch)
+    {
+      std::size_t const m = std::min(batch, n - i), nblocks = (m + blockN - 1) / blockN;
+      for (std::size_t k = 0; k < nblocks; ++k)
+      {
+        char word[8];
+        if (!is.read(word, 8))
+          throwIoError("truncated data in", where);
+        std::size_t const c = getWord(word);
+        if (c == 0 || c > std::min(blockN, m - k*blockN)*sizeof(T))
+          throwIoError("corrupt compressed data in", where);
+        packed[k].resize(c);
+        if (!is.read(&packed[k][0], std::streamsize(c)))
+          throwIoError("truncated data in", where);
+      }
+      int const workers = (int)std::min(std::size_t(parts), nblocks);
+      DecodeBatch body = {reinterpret_cast<char*>(p ? p + i : stage.data()), m, blockN, sizeof(T),
+                          packed, scratch, bad, workers};
+      runParallel(workers, body);
+      if (std::count(bad.begin(), bad.end(), 1))
+        throwIoError("corrupt compressed data in", where);
+      if (!p)
+        for (std::size_t k = 0; k < m; ++k, ++it)
+          *it = stage[k];
+    }
+  }
+}
+
+
+// Writes the header and the elements of `x`. Contiguous arrays are written
+// straight from `data()`; the others are gathered in major order,
+// MA_IO_CHUNK bytes at a time.
+template<class Derived, int Rank, Options Opts>
+void save(std::ostream& os, ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename Tr1::remove_const<typename internal::Traits<Derived>::UserT>::type T;
+
+  char head[MA_FILE_DATA_OFFSET];
+  internal::FileHeader::make<T,Rank>(x.rdims(), Derived::isRowMajor).encode(head);
+  os.write(head, MA_FILE_DATA_OFFSET);
+
+  internal::StreamSink sink(os);
+  internal::writeElements(sink, x);
+  if (!os)
+    throw std::runtime_error("**ERROR**: array file: write failed");
+}
+
+template<class Derived, int Rank, Options Opts>
+void save(char const* path, ArrayBase<Derived,Rank,Opts> const& x)
+{
+  std::ofstream os(path, std::ios::binary);
+  if (!os)
+    internal::throwIoError("cannot create", path);
+  save(os, x);
+}
+
+// Same, with the elements compressed in blocks of about `blockBytes`
+// (see Array/codec.hpp), encoded in parallel. `load` and `ArrayReader`
+// decompress them transparently.
+template<class Derived, int Rank, Options Opts>
+void save(std::ostream& os, ArrayBase<Derived,Rank,Opts> const& x, Compression c,
+          std::size_t blockBytes = MA_COMPRESS_BLOCK)
+{
+  typedef typename Tr1::remove_const<typename internal::Traits<Derived>::UserT>::type T;
+  if (c == Uncompressed)
+  {
+    save(os, x);
+    return;
+  }
+
+  std::size_t const blockN = std::max(blockBytes / sizeof(T), std::size_t(1));
+  internal::FileHeader h = internal::FileHeader::make<T,Rank>(x.rdims(), Derived::isRowMajor);
+  h.compression = c;
+  h.blockBytes = blockN*sizeof(T);
+  char head[MA_FILE_DATA_OFFSET];
+  h.encode(head);
+  os.write(head, MA_FILE_DATA_OFFSET);
+
+  internal::writeCompressed(os, x, blockN);
+  if (!os)
+    throw std::runtime_error("**ERROR**: array file: write failed");
+}
+
+template<class Derived, int Rank, Options Opts>
+void save(char const* path, ArrayBase<Derived,Rank,Opts> const& x, Compression c,
+          std::size_t blockBytes = MA_COMPRESS_BLOCK)
+{
+  std::ofstream os(path, std::ios::binary);
+  if (!os)
+    internal::throwIoError("cannot create", path);
+  save(os, x, c, blockBytes);
+}
+
+
+// Reads an array file from a stream: the header on construction, then the
+// elements, either all at once into an Array or in chunks of any size
+// into user memory, e.g.
+//
+//    ArrayReader r(is);
+//    Array<double, 3> A;
+//    r.read(A);           // A takes the stored shape
+//
+// The element type, rank and major order must match those stored.
+// Compressed files are decoded block by block; `read(A)` decodes the
+// blocks in parallel.
+class ArrayReader
+{
+public:
+  explicit ArrayReader(std::istream& is) : m_is(is), m_pos(0), m_decoded(0), m_blockPos(0)
+  {
+    char head[MA_FILE_DATA_OFFSET];
+    if (!m_is.read(head, MA_FILE_DATA_OFFSET))
+      internal::throwIoError("truncated header in", "stream");
+    if (char const* err = m_h.decode(head))
+      internal::throwIoError(err, "stream");
+  }
+
+  int rank() const
+  { return (int)m_h.rank; }
+
+  std::size_t dim(int r) const
+  {
+    internal::assertTrue(r < rank(), "**ERROR**: ArrayReader: invalid rank in function `dim()`");
+    return m_h.dims[r];
+  }
+
+  std::size_t const* dims() const
+  { return m_h.dims; }
+
+  std::size_t size() const
+  { return m_h.size(); }
+
+  bool isRowMajor() const
+  { return m_h.isRowMajor; }
+
+  // ElementType
+  int elementType() const
+  { return (int)m_h.type; }
+
+  std::size_t elementSize() const
+  { return m_h.elemSize; }
+
+  Compression compression() const
+  { return Compression(m_h.compression); }
+
+  // number of elements not read yet
+  std::size_t remaining() const
+  { return size() - m_pos; }
+
+  // reads the next min(n, remaining()) elements into `p` and returns their
+  // number; the elements come in the stored major order
+  template<class T>
+  std::size_t read(T* p, std::size_t n)
+  {
+    if (m_h.elemSize != sizeof(T) || (int)m_h.type != internal::ElementTypeOf<T>::value)
+      internal::throwIoError("element type mismatch in", "stream");
+    n = std::min(n, remaining());
+    if (m_h.compression == Uncompressed)
+    {
+      if (!m_is.read(reinterpret_cast<char*>(p), std::streamsize(n*sizeof(T))))
+        internal::throwIoError("truncated data in", "stream");
+    }
+    else
+      for (std::size_t i = 0; i < n; )
+      {
+        if (m_blockPos == m_block.size())
+          nextBlock();
+        std::size_t const k = std::min(n - i, (m_block.size() - m_blockPos) / sizeof(T));
+        std::memcpy(reinterpret_cast<char*>(p + i), &m_block[m_blockPos], k*sizeof(T));
+        m_blockPos += k*sizeof(T);
+        i += k;
+      }
+    m_pos += n;
+    return n;
+  }
+
+  // reshapes `A` to the stored dims and reads all the elements into it,
+  // with no intermediate buffer when its storage is contiguous
+  template<class T, int Rank, Options Opts, class M, bool L>
+  void read(Array<T,Rank,Opts,M,L>& A)
+  {
+    if (char const* err = m_h.check<T,Rank>(Array<T,Rank,Opts,M,L>::isRowMajor))
+      internal::throwIoError(err, "stream");
+    if (m_pos != 0)
+      internal::throwIoError("elements already read from", "stream");
+
+    if (m_h.compression == Uncompressed)
+      internal::readElements(m_is, A, m_h.dims, "stream");
+    else
+      internal::readCompressed(m_is, A, m_h, "stream");
+    m_pos = size();
+  }
+
+private:
+  ArrayReader(ArrayReader const&);
+  ArrayReader& operator=(ArrayReader const&);
+
+  // decodes the next compressed block into m_block
+  void nextBlock()
+  {
+    std::size_t const blockN = m_h.blockBytes / m_h.elemSize;
+    std::size_t const bytes = std::min(blockN, size() - m_decoded) * m_h.elemSize;
+    char word[8];
+    if (!m_is.read(word, 8))
+      internal::throwIoError("truncated data in", "stream");
+    std::size_t const c = internal::getWord(word);
+    if (c == 0 || c > bytes)
+      internal::throwIoError("corrupt compressed data in", "stream");
+    m_packed.resize(c);
+    if (!m_is.read(&m_packed[0], std::streamsize(c)))
+      internal::throwIoError("truncated data in", "stream");
+    m_block.resize(bytes);
+    if (!internal::decodeBlock(&m_packed[0], c, &m_block[0], bytes / m_h.elemSize, m_h.elemSize, m_scratch))
+      internal::throwIoError("corrupt compressed data in", "stream");
+    m_decoded += bytes / m_h.elemSize;
+    m_blockPos = 0;
+  }
+
+  std::istream&          m_is;
+  internal::FileHeader   m_h;
+  std::size_t            m_pos;
+
+  // compressed files: the current block and the elements decoded so far
+  std::vector<char>      m_packed, m_block;
+  std::size_t            m_decoded, m_blockPos;
+  internal::CodecScratch m_scratch;
+};
+
+template<class T, int Rank, Options Opts, class M, bool L>
+void load(std::istream& is, Array<T,Rank,Opts,M,L>& A)
+{
+  ArrayReader r(is);
+  r.read(A);
+}
+
+template<class T, int Rank, Options Opts, class M, bool L>
+void load(char const* path, Array<T,Rank,Opts,M,L>& A)
+{
+  std::ifstream is(path, std::ios::binary);
+  if (!is)
+    internal::throwIoError("cannot open", path);
+  load(is, A);
+}
+
+} // end namespace
+
+#endif
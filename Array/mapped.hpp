@@ -0,0 +1,337 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_MAPPED_HPP
+#define MA_MAPPED_HPP
+
+#include "io.hpp"
+
+// Arrays backed by a memory-mapped file (POSIX). Opening is O(1) in the
+// size of the file: the pages are read when first touched, and the kernel
+// may drop clean pages under memory pressure, so the resident memory
+// follows the working set.
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "Array/mapped.hpp needs POSIX mmap"
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+namespace marray {
+
+// access pattern hints, see madvise(2)
+enum MapAdvice {
+  MapNormal,
+  MapSequential,
+  MapRandom,
+  MapWillNeed
+};
+
+namespace internal
+{
+  inline void throwSystemError(char const* what, char const* path)
+  {
+    throw std::runtime_error(std::string("**ERROR**: MappedFile: ") + what + " `" + path + "`: "
+                             + std::strerror(errno));
+  }
+}
+
+// Owns the shared mapping of a whole file.
+class MappedFile
+{
+public:
+  MappedFile() : m_data(NULL), m_size(0), m_writable(false)
+  { }
+
+  // maps an existing file
+  MappedFile(char const* path, MapMode mode) : m_data(NULL), m_size(0), m_writable(mode == ReadWrite)
+  {
+    int const fd = ::open(path, m_writable ? O_RDWR : O_RDONLY);
+    if (fd < 0)
+      internal::throwSystemError("cannot open", path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      internal::throwSystemError("cannot stat", path);
+    }
+    map(fd, (std::size_t)st.st_size, path);
+  }
+
+  // creates (or truncates) a file of `bytes` zero bytes and maps it for
+  // writing; the blocks are allocated when first written
+  MappedFile(char const* path, std::size_t bytes) : m_data(NULL), m_size(0), m_writable(true)
+  {
+    int const fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+      internal::throwSystemError("cannot create", path);
+    if (::ftruncate(fd, (off_t)bytes) != 0)
+    {
+      ::close(fd);
+      internal::throwSystemError("cannot resize", path);
+    }
+    map(fd, bytes, path);
+  }
+
+  // writable mappings are flushed first
+  ~MappedFile()
+  { close(); }
+
+  void* data()
+  { return m_data; }
+
+  void const* data() const
+  { return m_data; }
+
+  std::size_t size() const
+  { return m_size; }
+
+  bool writable() const
+  { return m_writable; }
+
+  // writes the modified pages back to the file (msync); waits for the
+  // writes to complete unless `async`
+  void flush(bool async = false)
+  {
+    if (m_data && m_writable && ::msync(m_data, m_size, async ? MS_ASYNC : MS_SYNC) != 0)
+      throw std::runtime_error(std::string("**ERROR**: MappedFile: msync failed: ") + std::strerror(errno));
+  }
+
+  void advise(MapAdvice a)
+  {
+    static int const flags[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED };
+    if (m_data)
+      ::madvise(m_data, m_size, flags[a]);
+  }
+
+  void close()
+  {
+    if (m_data)
+    {
+      if (m_writable)
+        ::msync(m_data, m_size, MS_SYNC);
+      ::munmap(m_data, m_size);
+    }
+    m_data = NULL;
+    m_size = 0;
+  }
+
+  void swap(MappedFile& x)
+  {
+    std::swap(m_data, x.m_data);
+    std::swap(m_size, x.m_size);
+    std::swap(m_writable, x.m_writable);
+  }
+
+private:
+  MappedFile(MappedFile const&);
+  MappedFile& operator=(MappedFile const&);
+
+  // read-only files are mapped privately, so that writing to them does not
+  // fault; the mapping outlives the descriptor
+  void map(int fd, std::size_t bytes, char const* path)
+  {
+    if (bytes == 0)
+    {
+      ::close(fd);
+      throw std::runtime_error(std::string("**ERROR**: MappedFile: empty file `") + path + "`");
+    }
+    void* p = ::mmap(NULL, bytes, PROT_READ | PROT_WRITE, m_writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+      internal::throwSystemError("cannot map", path);
+    m_data = p;
+    m_size = bytes;
+  }
+
+  void*       m_data;
+  std::size_t m_size;
+  bool        m_writable;
+};
+
+inline void swap(MappedFile& a, MappedFile& b)
+{ a.swap(b); }
+
+
+namespace internal
+{
+  // header of the array files (see Array/io.hpp); a format reads the
+  // `dims` and the `offset` of the elements from the first `n` bytes of a
+  // file, and returns an error message if they can not be mapped as an
+  // array of type T, rank `Rank` and major order `isRowMajor`
+  struct ArrayFileFormat
+  {
+    template<class T, int Rank>
+    char const* parse(char const* buf, std::size_t n, bool isRowMajor, std::size_t dims[], std::size_t& offset) const
+    {
+      if (n < MA_FILE_DATA_OFFSET)
+        return "not an array file";
+      FileHeader h;
+      char const* err = h.decode(buf);
+      if (err || (err = h.check<T,Rank>(isRowMajor)))
+        return err;
+      if (h.compression != Uncompressed)
+        return "can not map the compressed file";
+      std::copy(h.dims, h.dims + Rank, dims);
+      offset = MA_FILE_DATA_OFFSET;
+      return NULL;
+    }
+  };
+
+  // the mapping of a MappedArray; a base class, so that it is set up
+  // before the Amaps over it
+  template<class T, int Rank>
+  class MappedStorage
+  {
+  protected:
+    MappedFile  m_file;
+    std::size_t m_dims[Rank];
+    void*       m_elems;
+
+    // file with a header, read by `format.parse<T,Rank>()`
+    template<class Format>
+    MappedStorage(char const* path, MapMode mode, Format const& format, bool isRowMajor)
+      : m_file(path, mode)
+    {
+      std::size_t offset = 0;
+      if (char const* err = format.template parse<T,Rank>(static_cast<char const*>(m_file.data()), m_file.size(),
+                                                           isRowMajor, m_dims, offset))
+        fail(err, path);
+      setElems(offset, path);
+    }
+
+    // new array file, zero filled
+    template<class D>
+    MappedStorage(char const* path, D const dims[], bool isRowMajor)
+      : m_file(path, MA_FILE_DATA_OFFSET + sizeof(T)*product(dims))
+    {
+      std::copy(dims, dims + Rank, m_dims);
+      FileHeader::make<T,Rank>(m_dims, isRowMajor).encode(static_cast<char*>(m_file.data()));
+      m_elems = static_cast<char*>(m_file.data()) + MA_FILE_DATA_OFFSET;
+    }
+
+    // file without header, with the elements at byte `offset`, a multiple
+    // of sizeof(T) so that they are aligned in the (page aligned) mapping
+    template<class D>
+    MappedStorage(char const* path, D const dims[], MapMode mode, std::size_t offset)
+      : m_file(path, mode)
+    {
+      std::copy(dims, dims + Rank, m_dims);
+      setElems(offset, path);
+    }
+
+    ~MappedStorage()
+    { }
+
+  private:
+    template<class D>
+    static std::size_t product(D const dims[])
+    {
+      std::size_t n = 1;
+      for (int r = 0; r < Rank; ++r)
+        n *= dims[r];
+      return n;
+    }
+
+    void setElems(std::size_t offset, char const* path)
+    {
+      std::size_t bytes;
+      if (!payloadBytes(m_dims, Rank, sizeof(T), bytes))
+        fail("invalid dims in", path);
+      if (offset % sizeof(T) != 0)
+        fail("misaligned offset in", path);
+      if (offset > m_file.size() || bytes > m_file.size() - offset)
+        fail("file too small", path);
+      m_elems = static_cast<char*>(m_file.data()) + offset;
+    }
+
+    static void fail(char const* what, char const* path)
+    {
+      throw std::runtime_error(std::string("**ERROR**: MappedArray<>: ") + what + " `" + path + "`");
+    }
+  };
+}
+
+
+// An Amaps over a memory-mapped file, e.g.
+//
+//    MappedArray<double, 3> A("a.bin", dims);          // new file, zero filled
+//    MappedArray<double, 3> B("a.bin", ReadWrite);     // the shape is read from the file
+//    MappedArray<float, 2>  C("raw.f32", dims, ReadOnly, 0);  // file without header
+//    MappedArray<double, 2> D("d.npy", ReadOnly, npy);   // see Array/npy.hpp
+//
+// The files written by MappedArray, like those written by `save()`, keep
+// the element type, the shape and the major order, which must match the
+// template arguments when they are opened again.
+// Writes reach the file through `flush()` and when the array is destroyed.
+template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR>
+class MappedArray : private internal::MappedStorage<typename Tr1::remove_const<P_type>::type, P_rank>, public Amaps<P_type,P_rank,P_opts>
+{
+  typedef internal::MappedStorage<typename Tr1::remove_const<P_type>::type, P_rank> Storage;
+  typedef Amaps<P_type,P_rank,P_opts>     Base;
+
+  // the files are in row or column major order
+  enum { DummyLayout = sizeof(internal::ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<P_opts>) };
+
+public:
+  typedef P_type UserT;
+  static const int Rank = P_rank;
+  static const bool isRowMajor = P_opts & RowMajor;
+
+  explicit MappedArray(char const* path, MapMode mode = ReadOnly)
+    : Storage(path, mode, internal::ArrayFileFormat(), isRowMajor),
+      Base(static_cast<UserT*>(Storage::m_elems), Storage::m_dims)
+  { }
+
+  // file in another format, e.g. `npy` (see Array/npy.hpp)
+  template<class Format>
+  MappedArray(char const* path, MapMode mode, Format const& format)
+    : Storage(path, mode, format, isRowMajor),
+      Base(static_cast<UserT*>(Storage::m_elems), Storage::m_dims)
+  { }
+
+  template<class D>
+  MappedArray(char const* path, D const dims[])
+    : Storage(path, dims, isRowMajor),
+      Base(static_cast<UserT*>(Storage::m_elems), Storage::m_dims)
+  { }
+
+  template<class D>
+  MappedArray(char const* path, D const dims[], MapMode mode, std::size_t offset)
+    : Storage(path, dims, mode, offset),
+      Base(static_cast<UserT*>(Storage::m_elems), Storage::m_dims)
+  { }
+
+  template<class E>
+  MappedArray& operator=(internal::ExprBase<E> const& e)
+  {
+    Base::operator=(e);
+    return *this;
+  }
+
+  void flush(bool async = false)
+  { Storage::m_file.flush(async); }
+
+  void advise(MapAdvice a)
+  { Storage::m_file.advise(a); }
+
+  MappedFile const& file() const
+  { return Storage::m_file; }
+
+private:
+  MappedArray(MappedArray const&);
+  MappedArray& operator=(MappedArray const&);
+};
+
+} // end namespace
+
+#endif
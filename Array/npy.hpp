@@ -0,0 +1,633 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_NPY_HPP
+#define MA_NPY_HPP
+
+#include "io.hpp"
+#include <sstream>
+
+// NumPy .npy files and .npz archives of them (stored, not compressed, as
+// written by `numpy.savez`). RowMajor arrays are written with
+// `fortran_order: False` and ColMajor ones with `fortran_order: True`;
+// on reading, the order, the dtype and the rank must match the array.
+// Only the native byte order is read.
+
+namespace marray {
+
+namespace internal
+{
+  inline void throwNpyError(char const* what, char const* where)
+  {
+    throw std::runtime_error(std::string("**ERROR**: npy file: ") + what + " `" + where + "`");
+  }
+
+  inline std::size_t getLE(char const* p, int bytes)
+  {
+    std::size_t x = 0;
+    for (int b = bytes-1; b >= 0; --b)
+      x = (x << 8) | (unsigned char)p[b];
+    return x;
+  }
+
+  // numpy dtype of T, e.g. "<f8"; raw bytes ("|V16") for other types
+  template<class T>
+  std::string npyDescr()
+  {
+    static char const kinds[] = "Viuiuiuiuffccb";   // indexed by ElementType
+    int const t = ElementTypeOf<T>::value;
+    std::ostringstream s;
+    s << (sizeof(T) == 1 || t == OtherType ? '|' : isLittleEndian() ? '<' : '>') << kinds[t] << sizeof(T);
+    return s.str();
+  }
+
+  struct NpyHeader
+  {
+    std::string descr;
+    bool        fortranOrder;
+    std::size_t rank, dims[MA_MAX_RANK];
+
+    NpyHeader() : fortranOrder(false), rank(0)
+    { }
+
+    static char const* magic()
+    { return "\x93NUMPY"; }
+
+    // magic, version 1.0, header length and the header dict, padded with
+    // spaces so that the elements start at a multiple of 64 bytes
+    template<class T, int Rank>
+    static std::string make(std::size_t const dims[], bool isRowMajor)
+    {
+      std::ostringstream d;
+      d << "{'descr': '" << npyDescr<T>() << "', 'fortran_order': " << (isRowMajor ? "False" : "True")
+        << ", 'shape': (";
+      for (int r = 0; r < Rank; ++r)
+        d << dims[r] << (Rank == 1 || r < Rank-1 ? "," : "") << (r < Rank-1 ? " " : "");
+      d << "), }";
+      std::string dict = d.str();
+      dict.append(63 - (10 + dict.size()) % 64, ' ');
+      dict += '\n';
+
+      std::string pre(magic(), 6);
+      pre += char(1);
+      pre += char(0);
+      pre += char(dict.size() & 0xff);
+      pre += char(dict.size() >> 8);
+      return pre + dict;
+    }
+
+    // size of the magic, version and header length, and of the header
+    // dict, from the first `n` bytes of a file; `n` must be at least 12
+    static char const* prefix(char const* p, std::size_t& pre, std::size_t& len)
+    {
+      if (!std::equal(magic(), magic() + 6, p))
+        return "not an npy file";
+      if (p[6] == 1)
+      {
+        pre = 10;
+        len = getLE(p + 8, 2);
+      }
+      else if (p[6] == 2 || p[6] == 3)
+      {
+        pre = 12;
+        len = getLE(p + 8, 4);
+      }
+      else
+        return "unsupported npy version in";
+      return NULL;
+    }
+
+    // reads the python dict of the header
+    char const* parse(std::string const& dict)
+    {
+      std::size_t k = dict.find("descr");
+      std::size_t const q = k == std::string::npos ? k : dict.find_first_of("'\"", dict.find(':', k));
+      std::size_t const e = q == std::string::npos ? q : dict.find(dict[q], q+1);
+      if (e == std::string::npos)
+        return "no descr in npy header of";
+      descr = dict.substr(q+1, e-q-1);
+
+      k = dict.find("fortran_order");
+      k = k == std::string::npos ? k : dict.find_first_not_of(" :'\"", k + 13);
+      if (k == std::string::npos)
+        return "no fortran_order in npy header of";
+      fortranOrder = dict.compare(k, 4, "True") == 0;
+
+      k = dict.find("shape");
+      k = k == std::string::npos ? k : dict.find('(', k);
+      if (k == std::string::npos)
+        return "no shape in npy header of";
+      rank = 0;
+      for (++k; k < dict.size() && dict[k] != ')'; ++k)
+      {
+        if (dict[k] < '0' || dict[k] > '9')
+          continue;
+        if (rank == MA_MAX_RANK)
+          return "invalid rank in";
+        std::size_t n = 0;
+        for (; k < dict.size() && dict[k] >= '0' && dict[k] <= '9'; ++k)
+        {
+          std::size_t const d = dict[k] - '0';
+          if (n > (std::size_t(-1) - d)/10)
+            return "invalid shape in";
+          n = 10*n + d;
+        }
+        dims[rank++] = n;
+        --k;
+      }
+      std::size_t count;
+      if (!payloadBytes(dims, rank, 1, count))
+        return "invalid shape in";
+      return NULL;
+    }
+
+    template<class T, int Rank>
+    char const* check(bool isRowMajor) const
+    {
+      std::string const want = npyDescr<T>();
+      if (descr.size() != want.size() || descr.compare(1, std::string::npos, want, 1, std::string::npos) != 0)
+        return "dtype mismatch in";
+      if (descr[0] != want[0] && descr[0] != '=' && descr[0] != '|' && sizeof(T) > 1)
+        return "byte order mismatch in";
+      if (rank != (std::size_t)Rank)
+        return "rank mismatch in";
+      if (fortranOrder == isRowMajor)
+        return "major order (fortran_order) mismatch in";
+      std::size_t bytes;
+      if (!payloadBytes(dims, rank, sizeof(T), bytes))
+        return "invalid shape in";
+      return NULL;
+    }
+  };
+
+  inline char const* readNpyHeader(std::istream& is, NpyHeader& h)
+  {
+    char p[12];
+    std::size_t pre, len;
+    if (!is.read(p, 10) || (p[6] != 1 && !is.read(p + 10, 2)))
+      return "truncated npy header in";
+    if (char const* err = NpyHeader::prefix(p, pre, len))
+      return err;
+    std::string dict(len, ' ');
+    if (len > 0 && !is.read(&dict[0], std::streamsize(len)))
+      return "truncated npy header in";
+    return h.parse(dict);
+  }
+
+  // byte sink that only computes the CRC-32 (as in zip) and the length
+  struct Crc32Sink
+  {
+    unsigned long crc;
+    std::size_t   size;
+
+    Crc32Sink() : crc(0), size(0)
+    { }
+
+    void put(char const* p, std::size_t n)
+    {
+      static Table const table;
+      unsigned long c = crc ^ 0xffffffffUL;
+      for (std::size_t i = 0; i < n; ++i)
+        c = table.t[(c ^ (unsigned char)p[i]) & 0xff] ^ (c >> 8);
+      crc = c ^ 0xffffffffUL;
+      size += n;
+    }
+
+  private:
+    struct Table
+    {
+      unsigned long t[256];
+
+      Table()
+      {
+        for (unsigned long i = 0; i < 256; ++i)
+        {
+          unsigned long c = i;
+          for (int k = 0; k < 8; ++k)
+            c = c & 1 ? 0xedb88320UL ^ (c >> 1) : c >> 1;
+          t[i] = c;
+        }
+      }
+    };
+  };
+}
+
+
+template<class Derived, int Rank, Options Opts>
+void save_npy(std::ostream& os, ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename Tr1::remove_const<typename internal::Traits<Derived>::UserT>::type T;
+  std::string const pre = internal::NpyHeader::make<T,Rank>(x.rdims(), Derived::isRowMajor);
+  os.write(pre.data(), std::streamsize(pre.size()));
+  internal::StreamSink sink(os);
+  internal::writeElements(sink, x);
+  if (!os)
+    throw std::runtime_error("**ERROR**: npy file: write failed");
+}
+
+template<class Derived, int Rank, Options Opts>
+void save_npy(char const* path, ArrayBase<Derived,Rank,Opts> const& x)
+{
+  std::ofstream os(path, std::ios::binary);
+  if (!os)
+    internal::throwNpyError("cannot create", path);
+  save_npy(os, x);
+}
+
+// reshapes `A` to the stored shape and reads the elements into it
+template<class T, int Rank, Options Opts, class M, bool L>
+void load_npy(std::istream& is, Array<T,Rank,Opts,M,L>& A, char const* where = "stream")
+{
+  internal::NpyHeader h;
+  char const* err = internal::readNpyHeader(is, h);
+  if (err || (err = h.check<T,Rank>(Array<T,Rank,Opts,M,L>::isRowMajor)))
+    internal::throwNpyError(err, where);
+  internal::readElements(is, A, h.dims, where);
+}
+
+template<class T, int Rank, Options Opts, class M, bool L>
+void load_npy(char const* path, Array<T,Rank,Opts,M,L>& A)
+{
+  std::ifstream is(path, std::ios::binary);
+  if (!is)
+    internal::throwNpyError("cannot open", path);
+  load_npy(is, A, path);
+}
+
+
+// The .npy format for MappedArray, e.g.
+//
+//    MappedArray<double, 2> A("a.npy", ReadOnly, npy);
+//
+// maps the elements of the file in place.
+struct npy_t
+{
+  template<class T, int Rank>
+  char const* parse(char const* buf, std::size_t n, bool isRowMajor, std::size_t dims[], std::size_t& offset) const
+  {
+    internal::NpyHeader h;
+    std::size_t pre, len;
+    if (n < 12)
+      return "not an npy file";
+    char const* err = internal::NpyHeader::prefix(buf, pre, len);
+    if (err)
+      return err;
+    if (pre + len > n)
+      return "truncated npy header in";
+    if ((err = h.parse(std::string(buf + pre, len))) || (err = h.check<T,Rank>(isRowMajor)))
+      return err;
+    std::size_t bytes;
+    internal::payloadBytes(h.dims, h.rank, sizeof(T), bytes);   // no overflow after check()
+    if (bytes > n - (pre + len))
+      return "truncated npy data in";
+    std::copy(h.dims, h.dims + Rank, dims);
+    offset = pre + len;
+    return NULL;
+  }
+};
+static const npy_t npy = npy_t();
+
+
+// Writes arrays as the .npy members of a zip archive, readable by
+// `numpy.load`, e.g.
+//
+//    NpzWriter z("out.npz");
+//    z.add("u", U);
+//    z.add("p", P);
+//    z.close();
+//
+// The members are stored, not compressed; each array is read twice, once
+// for its CRC and once to write it. Archives and members over 4 GiB use
+// the zip64 extensions.
+class NpzWriter
+{
+public:
+  explicit NpzWriter(char const* path) : m_os(path, std::ios::binary), m_offset(0), m_closed(false)
+  {
+    if (!m_os)
+      internal::throwNpyError("cannot create", path);
+  }
+
+  ~NpzWriter()
+  {
+    try { close(); }
+    catch (...) { }
+  }
+
+  // adds the member `name`.npy
+  template<class Derived, int Rank, Options Opts>
+  void add(std::string const& name, ArrayBase<Derived,Rank,Opts> const& x)
+  {
+    typedef typename Tr1::remove_const<typename internal::Traits<Derived>::UserT>::type T;
+    internal::assertTrue(!m_closed, "**ERROR**: NpzWriter: archive already closed");
+
+    std::string const pre = internal::NpyHeader::make<T,Rank>(x.rdims(), Derived::isRowMajor);
+    internal::Crc32Sink crc;
+    crc.put(pre.data(), pre.size());
+    internal::writeElements(crc, x);
+
+    Entry e;
+    e.name = name + ".npy";
+    e.crc = crc.crc;
+    e.size = crc.size;
+    e.offset = m_offset;
+    m_entries.push_back(e);
+
+    bool const z64 = e.size >= 0xffffffffUL;
+    put(0x04034b50, 4);
+    put(z64 ? 45 : 20, 2);              // version needed
+    put(0, 2);                          // flags
+    put(0, 2);                          // stored
+    put(0, 2);                          // time
+    put(0x21, 2);                       // date: 1980-01-01
+    put(e.crc, 4);
+    put(z64 ? 0xffffffffUL : e.size, 4);
+    put(z64 ? 0xffffffffUL : e.size, 4);
+    put(e.name.size(), 2);
+    put(z64 ? 20 : 0, 2);
+    putBytes(e.name.data(), e.name.size());
+    if (z64)
+    {
+      put(1, 2);
+      put(16, 2);
+      put(e.size, 8);
+      put(e.size, 8);
+    }
+
+    putBytes(pre.data(), pre.size());
+    internal::StreamSink sink(m_os);
+    internal::writeElements(sink, x);
+    m_offset += e.size - pre.size();
+    if (!m_os)
+      throw std::runtime_error("**ERROR**: npy file: write failed");
+  }
+
+  // writes the central directory; called by the destructor
+  void close()
+  {
+    if (m_closed)
+      return;
+    m_closed = true;
+
+    std::size_t const cdOffset = m_offset;
+    for (std::size_t i = 0; i < m_entries.size(); ++i)
+    {
+      Entry const& e = m_entries[i];
+      bool const z64 = e.size >= 0xffffffffUL || e.offset >= 0xffffffffUL;
+      put(0x02014b50, 4);
+      put(z64 ? 45 : 20, 2);            // version made by
+      put(z64 ? 45 : 20, 2);            // version needed
+      put(0, 2);
+      put(0, 2);
+      put(0, 2);
+      put(0x21, 2);
+      put(e.crc, 4);
+      put(z64 ? 0xffffffffUL : e.size, 4);
+      put(z64 ? 0xffffffffUL : e.size, 4);
+      put(e.name.size(), 2);
+      put(z64 ? 28 : 0, 2);
+      put(0, 2);                        // comment
+      put(0, 2);                        // disk
+      put(0, 2);                        // internal attributes
+      put(0, 4);                        // external attributes
+      put(z64 ? 0xffffffffUL : e.offset, 4);
+      putBytes(e.name.data(), e.name.size());
+      if (z64)
+      {
+        put(1, 2);
+        put(24, 2);
+        put(e.size, 8);
+        put(e.size, 8);
+        put(e.offset, 8);
+      }
+    }
+    std::size_t const cdSize = m_offset - cdOffset;
+    std::size_t const n = m_entries.size();
+
+    if (n >= 0xffff || cdOffset >= 0xffffffffUL || cdSize >= 0xffffffffUL)
+    {
+      std::size_t const z64 = m_offset;
+      put(0x06064b50, 4);
+      put(44, 8);
+      put(45, 2);
+      put(45, 2);
+      put(0, 4);
+      put(0, 4);
+      put(n, 8);
+      put(n, 8);
+      put(cdSize, 8);
+      put(cdOffset, 8);
+      put(0x07064b50, 4);
+      put(0, 4);
+      put(z64, 8);
+      put(1, 4);
+    }
+    put(0x06054b50, 4);
+    put(0, 2);
+    put(0, 2);
+    put(std::min(n, std::size_t(0xffff)), 2);
+    put(std::min(n, std::size_t(0xffff)), 2);
+    put(std::min(cdSize, std::size_t(0xffffffffUL)), 4);
+    put(std::min(cdOffset, std::size_t(0xffffffffUL)), 4);
+    put(0, 2);
+    m_os.flush();
+    if (!m_os)
+      throw std::runtime_error("**ERROR**: npy file: write failed");
+  }
+
+private:
+  NpzWriter(NpzWriter const&);
+  NpzWriter& operator=(NpzWriter const&);
+
+  struct Entry
+  {
+    std::string   name;
+    unsigned long crc;
+    std::size_t   size, offset;
+  };
+
+  // little-endian integer of `bytes` bytes
+  void put(std::size_t x, int bytes)
+  {
+    char b[8];
+    for (int i = 0; i < bytes; ++i, x >>= 8)
+      b[i] = char(x & 0xff);
+    putBytes(b, bytes);
+  }
+
+  void putBytes(char const* p, std::size_t n)
+  {
+    m_os.write(p, std::streamsize(n));
+    m_offset += n;
+  }
+
+  std::ofstream      m_os;
+  std::size_t        m_offset;
+  std::vector<Entry> m_entries;
+  bool               m_closed;
+};
+
+
+// Reads the .npy members of a zip archive, e.g. one written by
+// `numpy.savez`. Compressed members (`numpy.savez_compressed`) are not
+// supported.
+class NpzReader
+{
+public:
+  explicit NpzReader(char const* path) : m_is(path, std::ios::binary), m_path(path)
+  {
+    if (!m_is)
+      internal::throwNpyError("cannot open", path);
+    readDirectory();
+  }
+
+  // member names, without the .npy extension
+  std::vector<std::string> names() const
+  {
+    std::vector<std::string> v;
+    for (std::size_t i = 0; i < m_entries.size(); ++i)
+    {
+      std::string const& s = m_entries[i].name;
+      v.push_back(s.size() > 4 && s.compare(s.size()-4, 4, ".npy") == 0 ? s.substr(0, s.size()-4) : s);
+    }
+    return v;
+  }
+
+  bool contains(std::string const& name) const
+  { return find(name) != NULL; }
+
+  // reshapes `A` to the shape of member `name` and reads it
+  template<class T, int Rank, Options Opts, class M, bool L>
+  void load(std::string const& name, Array<T,Rank,Opts,M,L>& A)
+  {
+    Entry const* e = find(name);
+    if (!e)
+      internal::throwNpyError(("no member " + name + " in").c_str(), m_path.c_str());
+    if (e->method != 0)
+      internal::throwNpyError(("compressed member " + name + " in").c_str(), m_path.c_str());
+
+    char h[30];
+    m_is.clear();
+    m_is.seekg(std::streamoff(e->offset));
+    if (!m_is.read(h, 30) || internal::getLE(h, 4) != 0x04034b50)
+      internal::throwNpyError("corrupt archive", m_path.c_str());
+    m_is.seekg(std::streamoff(internal::getLE(h + 26, 2) + internal::getLE(h + 28, 2)), std::ios::cur);
+    load_npy(m_is, A, m_path.c_str());
+  }
+
+private:
+  NpzReader(NpzReader const&);
+  NpzReader& operator=(NpzReader const&);
+
+  struct Entry
+  {
+    std::string name;
+    int         method;
+    std::size_t offset;
+  };
+
+  Entry const* find(std::string const& name) const
+  {
+    for (std::size_t i = 0; i < m_entries.size(); ++i)
+      if (m_entries[i].name == name || m_entries[i].name == name + ".npy")
+        return &m_entries[i];
+    return NULL;
+  }
+
+  void fail()
+  { internal::throwNpyError("corrupt archive", m_path.c_str()); }
+
+  void readAt(std::size_t pos, char* p, std::size_t n)
+  {
+    m_is.clear();
+    m_is.seekg(std::streamoff(pos));
+    if (!m_is.read(p, std::streamsize(n)))
+      fail();
+  }
+
+  // the end of central directory record is in the last 64 KiB + 22 bytes
+  void readDirectory()
+  {
+    using internal::getLE;
+    m_is.seekg(0, std::ios::end);
+    std::size_t const fileSize = std::size_t(m_is.tellg());
+    std::size_t const tailSize = std::min(fileSize, std::size_t(65535 + 22));
+    if (tailSize < 22)
+      fail();
+    std::vector<char> tail(tailSize);
+    readAt(fileSize - tailSize, &tail[0], tailSize);
+
+    std::size_t p = tailSize - 22;
+    while (getLE(&tail[p], 4) != 0x06054b50)
+      if (p-- == 0)
+        fail();
+    std::size_t n = getLE(&tail[p + 10], 2);
+    std::size_t cdSize = getLE(&tail[p + 12], 4);
+    std::size_t cdOffset = getLE(&tail[p + 16], 4);
+
+    if (n == 0xffff || cdSize == 0xffffffffUL || cdOffset == 0xffffffffUL)
+    {
+      char loc[20], rec[56];
+      if (p < 20 || getLE(&tail[p - 20], 4) != 0x07064b50)
+        fail();
+      std::copy(&tail[p - 20], &tail[p], loc);
+      readAt(getLE(loc + 8, 8), rec, 56);
+      if (getLE(rec, 4) != 0x06064b50)
+        fail();
+      n = getLE(rec + 32, 8);
+      cdSize = getLE(rec + 40, 8);
+      cdOffset = getLE(rec + 48, 8);
+    }
+
+    std::vector<char> cd(cdSize + 1);
+    readAt(cdOffset, &cd[0], cdSize);
+    for (std::size_t i = 0, q = 0; i < n; ++i)
+    {
+      if (q + 46 > cdSize || getLE(&cd[q], 4) != 0x02014b50)
+        fail();
+      std::size_t const nameLen = getLE(&cd[q + 28], 2), extraLen = getLE(&cd[q + 30], 2);
+      std::size_t const commentLen = getLE(&cd[q + 32], 2);
+      if (q + 46 + nameLen + extraLen > cdSize)
+        fail();
+      Entry e;
+      e.method = (int)getLE(&cd[q + 10], 2);
+      e.name.assign(&cd[q + 46], nameLen);
+      e.offset = getLE(&cd[q + 42], 4);
+
+      // zip64 extra field: the 8-byte values of the saturated fields, in
+      // the order uncompressed size, compressed size, offset
+      bool const z64[] = { getLE(&cd[q + 24], 4) == 0xffffffffUL, getLE(&cd[q + 20], 4) == 0xffffffffUL,
+                           e.offset == 0xffffffffUL };
+      for (std::size_t x = q + 46 + nameLen; x + 4 <= q + 46 + nameLen + extraLen; )
+      {
+        std::size_t const id = getLE(&cd[x], 2), len = getLE(&cd[x + 2], 2);
+        if (id == 1)
+        {
+          std::size_t v = x + 4;
+          for (int f = 0; f < 3; ++f)
+            if (z64[f])
+            {
+              if (f == 2)
+                e.offset = getLE(&cd[v], 8);
+              v += 8;
+            }
+        }
+        x += 4 + len;
+      }
+      m_entries.push_back(e);
+      q += 46 + nameLen + extraLen + commentLen;
+    }
+  }
+
+  std::ifstream      m_is;
+  std::string        m_path;
+  std::vector<Entry> m_entries;
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,444 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_PARALLEL_HPP
+#define MA_PARALLEL_HPP
+
+#include "array.hpp"
+
+// Parallel loops over arrays. The workers are OpenMP threads when compiled
+// with OpenMP (-fopenmp), std::threads in c++11 (unless MA_NO_THREADS is
+// defined), and the loops run serially otherwise.
+#if defined(_OPENMP)
+#include <omp.h>
+#elif __cplusplus >= 201103L && !defined(MA_NO_THREADS)
+#define MA_HAVE_STD_THREAD
+#include <thread>
+#include <exception>
+#endif
+
+// chunk boundaries are aligned to this many bytes, so that two workers
+// never write to the same cache line
+#ifndef MA_CACHE_LINE
+#define MA_CACHE_LINE 64
+#endif
+
+// minimum number of elements given to each worker
+#ifndef MA_PARALLEL_GRAIN
+#define MA_PARALLEL_GRAIN 32768
+#endif
+
+namespace marray {
+
+namespace internal
+{
+  inline int& numThreadsSetting()
+  {
+    static int n = 0;
+    return n;
+  }
+
+  inline int hardwareThreads()
+  {
+#if defined(_OPENMP)
+    return omp_get_max_threads();
+#elif defined(MA_HAVE_STD_THREAD)
+    int const n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+#else
+    return 1;
+#endif
+  }
+}
+
+// number of workers of the parallel algorithms; 0 restores the default,
+// one per hardware thread
+inline void set_num_threads(int n)
+{ internal::numThreadsSetting() = n > 0 ? n : 0; }
+
+inline int num_threads()
+{
+  int const n = internal::numThreadsSetting();
+  return n > 0 ? n : internal::hardwareThreads();
+}
+
+
+namespace internal
+{
+  inline std::size_t gcd(std::size_t a, std::size_t b)
+  {
+    while (b)
+    {
+      std::size_t const t = a % b;
+      a = b;
+      b = t;
+    }
+    return a;
+  }
+
+  // Splits the slabs [0, n) of the outer rank into at most `parts` chunks,
+  // chunk `p` being [bounds[p], bounds[p+1]); returns the number of chunks.
+  // The slabs are taken in aligned groups of `unit` (a tile side, say);
+  // `base` is the address of group 0 (0 if unknown) and `slabBytes` the
+  // distance between two groups. The inner boundaries are multiples of a
+  // granule of groups spanning whole cache lines and, when `base` is known,
+  // start on a cache line.
+  inline int partitionSlabs(std::size_t n, std::size_t slabBytes, std::size_t base, int parts,
+                            std::size_t bounds[], std::size_t unit = 1)
+  {
+    std::size_t const line = MA_CACHE_LINE;
+    std::size_t const g = (slabBytes ? line / gcd(slabBytes, line) : 1) * unit;
+
+    std::size_t i0 = 0;
+    if (base && slabBytes)
+      while (i0 < g && (base + i0/unit*slabBytes) % line != 0)
+        i0 += unit;
+    if (i0 >= g)
+      i0 = 0;
+
+    std::size_t const granules = n > i0 ? (n - i0) / g : 0;
+    if ((std::size_t)parts > granules)
+      parts = granules > 0 ? (int)granules : 1;
+
+    bounds[0] = 0;
+    for (int p = 1; p < parts; ++p)
+      bounds[p] = i0 + (granules * p / parts) * g;
+    bounds[parts] = n;
+    return parts;
+  }
+
+  // The groups of outer slabs of layout O that partitionSlabs() must keep
+  // whole, and the bytes between two groups (0 if they interleave):
+  // strided layouts take single slabs; tiled layouts rows of tiles; Morton
+  // layouts the aligned blocks of 2^k slabs whose contiguous runs span a
+  // cache line (the runs of a block of 2^k are as long as the k-th bit of
+  // the mask of the rank).
+  template<Options O>
+  void outerGroups(std::ptrdiff_t const strides[], int r, std::size_t elemSize, std::size_t& unit,
+                   std::ptrdiff_t& slabBytes)
+  {
+    unit = 1;
+    slabBytes = strides[r] * (std::ptrdiff_t)elemSize;
+    if (TileBitsOf<O>::value)
+      unit <<= TileBitsOf<O>::value;
+    else if (IsMortonOf<O>::value)
+    {
+      slabBytes = 0;
+      for (std::ptrdiff_t m = strides[r]; m && (std::size_t)(m & -m)*elemSize < MA_CACHE_LINE; m &= m - 1)
+        unit <<= 1;
+    }
+  }
+
+  // number of workers for `size` elements and `n` slabs
+  inline int parallelParts(std::size_t size, std::size_t n)
+  {
+    std::size_t parts = size / MA_PARALLEL_GRAIN;
+    if (parts > (std::size_t)num_threads())
+      parts = num_threads();
+    if (parts > n)
+      parts = n;
+    return parts > 0 ? (int)parts : 1;
+  }
+
+  // calls body(p) for p = 0 .. parts-1, one worker each; the first
+  // exception thrown by a worker is rethrown
+  template<class Body>
+  void runParallel(int parts, Body& body)
+  {
+    if (parts < 2)
+    {
+      for (int p = 0; p < parts; ++p)
+        body(p);
+      return;
+    }
+
+#if defined(_OPENMP)
+    bool failed = false;
+#if __cplusplus >= 201103L
+    std::exception_ptr error;
+#endif
+    #pragma omp parallel for num_threads(parts) schedule(static, 1)
+    for (int p = 0; p < parts; ++p)
+    {
+      try {
+        body(p);
+      }
+      catch (...) {
+        #pragma omp critical(marray_parallel)
+        {
+#if __cplusplus >= 201103L
+          if (!failed)
+            error = std::current_exception();
+#endif
+          failed = true;
+        }
+      }
+    }
+#if __cplusplus >= 201103L
+    if (error)
+      std::rethrow_exception(error);
+#endif
+    if (failed)
+      throw std::runtime_error("**ERROR**: parallel loop: exception in a worker");
+
+#elif defined(MA_HAVE_STD_THREAD)
+    std::vector<std::exception_ptr> errors(parts);
+    std::vector<std::thread> pool;
+    pool.reserve(parts-1);
+    try {
+      for (int p = 1; p < parts; ++p)
+        pool.push_back(std::thread([&body, &errors, p]() {
+          try {
+            body(p);
+          }
+          catch (...) {
+            errors[p] = std::current_exception();
+          }
+        }));
+    }
+    catch (...) {
+      // a thread could not be started: joinable threads must not be destroyed
+      for (std::size_t i = 0; i < pool.size(); ++i)
+        pool[i].join();
+      throw;
+    }
+    try {
+      body(0);
+    }
+    catch (...) {
+      errors[0] = std::current_exception();
+    }
+    for (std::size_t i = 0; i < pool.size(); ++i)
+      pool[i].join();
+    for (int p = 0; p < parts; ++p)
+      if (errors[p])
+        std::rethrow_exception(errors[p]);
+
+#else
+    for (int p = 0; p < parts; ++p)
+      body(p);
+#endif
+  }
+
+  // slowest rank of an array: the one split among the workers
+  template<class Derived>
+  int outerRank()
+  { return Derived::isRowMajor ? 0 : Derived::Rank-1; }
+
+  // f(x) for the elements of `a` whose index in the outer rank `r` is in
+  // [first, last)
+  template<class Derived, class F>
+  void forEachInSlabs(Derived& a, std::size_t const dims[], std::ptrdiff_t const strides[], int r,
+                      std::size_t first, std::size_t last, F& f)
+  {
+    static const int Rank = Derived::Rank;
+    typedef typename Derived::IdxComputer IC;
+
+    std::size_t    beg[Rank], end[Rank], idx[Rank];
+    std::size_t    n = 1;
+    for (int k = 0; k < Rank; ++k)
+    {
+      beg[k] = idx[k] = k == r ? first : 0;
+      end[k] = k == r ? last : dims[k];
+      n *= end[k] - beg[k];
+    }
+    std::ptrdiff_t off = IC::term(strides, r, first);
+
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      f(a.access(off));
+      for (int k = 0; k < Rank; ++k)
+      {
+        int const q = Derived::isRowMajor ? Rank-1-k : k;
+        off += IC::step(strides, q, idx[q]);
+        if (++idx[q] < end[q])
+          break;
+        off -= IC::term(strides, q, end[q]) - IC::term(strides, q, beg[q]);
+        idx[q] = beg[q];
+      }
+    }
+  }
+
+  // dst(i) = f(src(i)) for the elements whose index in the outer rank `r`
+  // of `dst` is in [first, last)
+  template<class D1, class D2, class F>
+  void transformSlabs(D1 const& src, std::ptrdiff_t const ss[], D2& dst, std::size_t const dims[],
+                      std::ptrdiff_t const ds[], int r, std::size_t first, std::size_t last, F& f)
+  {
+    static const int Rank = D2::Rank;
+    typedef typename D1::IdxComputer SC;
+    typedef typename D2::IdxComputer DC;
+
+    std::size_t    beg[Rank], end[Rank], idx[Rank];
+    std::size_t    n = 1;
+    for (int k = 0; k < Rank; ++k)
+    {
+      beg[k] = idx[k] = k == r ? first : 0;
+      end[k] = k == r ? last : dims[k];
+      n *= end[k] - beg[k];
+    }
+    std::ptrdiff_t so = SC::term(ss, r, first);
+    std::ptrdiff_t doff = DC::term(ds, r, first);
+
+    for (std::size_t c = 0; c < n; ++c)
+    {
+      dst.access(doff) = f(src.access(so));
+      for (int k = 0; k < Rank; ++k)
+      {
+        int const q = D2::isRowMajor ? Rank-1-k : k;
+        so += SC::step(ss, q, idx[q]);
+        doff += DC::step(ds, q, idx[q]);
+        if (++idx[q] < end[q])
+          break;
+        so -= SC::term(ss, q, end[q]) - SC::term(ss, q, beg[q]);
+        doff -= DC::term(ds, q, end[q]) - DC::term(ds, q, beg[q]);
+        idx[q] = beg[q];
+      }
+    }
+  }
+
+  // the outer rank `r` of a contiguous array spans the whole block
+  template<class Derived>
+  bool isDenseOuter(Derived const& a, std::size_t const dims[], std::ptrdiff_t const strides[], int r)
+  { return (std::size_t)strides[r] * dims[r] == a.size(); }
+
+  template<class Derived, class F>
+  struct ParallelForBody
+  {
+    Derived&               a;
+    typename Traits<Derived>::pointer p;
+    std::size_t const*     dims;
+    std::ptrdiff_t const*  strides;
+    int                    r;
+    std::size_t const*     bounds;
+    F const&               f;
+
+    ParallelForBody(Derived& a_, typename Traits<Derived>::pointer p_, std::size_t const* dims_,
+                    std::ptrdiff_t const* strides_, int r_, std::size_t const* bounds_, F const& f_)
+      : a(a_), p(p_), dims(dims_), strides(strides_), r(r_), bounds(bounds_), f(f_)
+    { }
+
+    void operator()(int part)
+    {
+      F g(f);
+      if (p)
+      {
+        std::ptrdiff_t const s = strides[r];
+        for (std::ptrdiff_t i = (std::ptrdiff_t)bounds[part]*s, e = (std::ptrdiff_t)bounds[part+1]*s; i < e; ++i)
+          g(p[i]);
+      }
+      else
+        forEachInSlabs(a, dims, strides, r, bounds[part], bounds[part+1], g);
+    }
+  };
+
+  template<class D1, class D2, class F>
+  struct ParallelTransformBody
+  {
+    D1 const&              src;
+    D2&                    dst;
+    typename Traits<D1>::const_pointer ps;
+    typename Traits<D2>::pointer       pd;
+    std::ptrdiff_t const*  ss;
+    std::size_t const*     dims;
+    std::ptrdiff_t const*  ds;
+    int                    r;
+    std::size_t const*     bounds;
+    F const&               f;
+
+    ParallelTransformBody(D1 const& src_, D2& dst_, typename Traits<D1>::const_pointer ps_,
+                          typename Traits<D2>::pointer pd_, std::ptrdiff_t const* ss_,
+                          std::size_t const* dims_, std::ptrdiff_t const* ds_, int r_,
+                          std::size_t const* bounds_, F const& f_)
+      : src(src_), dst(dst_), ps(ps_), pd(pd_), ss(ss_), dims(dims_), ds(ds_), r(r_), bounds(bounds_), f(f_)
+    { }
+
+    void operator()(int part)
+    {
+      F g(f);
+      if (ps && pd)
+      {
+        std::ptrdiff_t const s = ds[r];
+        for (std::ptrdiff_t i = (std::ptrdiff_t)bounds[part]*s, e = (std::ptrdiff_t)bounds[part+1]*s; i < e; ++i)
+          pd[i] = g(ps[i]);
+      }
+      else
+        transformSlabs(src, ss, dst, dims, ds, r, bounds[part], bounds[part+1], g);
+    }
+  };
+}
+
+
+// f(x) for every element `x` of `A`. The slowest rank of `A` is split
+// among the workers (see `set_num_threads`), each one with its own copy of
+// `f`; the order of the calls is unspecified.
+template<class Derived, int Rank, Options Opts, class F>
+void parallel_for(ArrayBase<Derived,Rank,Opts>& A, F f)
+{
+  Derived& a = static_cast<Derived&>(A);
+  if (a.size() == 0)
+    return;
+
+  std::size_t const*    dims = A.rdims();
+  std::ptrdiff_t const* strides = A.rstrides();
+  int const             r = internal::outerRank<Derived>();
+
+  typename internal::Traits<Derived>::pointer p = internal::ContiguousData<Derived>::get(a);
+  if (p && !internal::isDenseOuter(a, dims, strides, r))
+    p = NULL;
+
+  typename internal::Traits<Derived>::pointer base = internal::StridedData<Derived>::get(a);
+  std::size_t    unit;
+  std::ptrdiff_t slab;
+  internal::outerGroups<Opts>(strides, r, sizeof(*base), unit, slab);
+
+  int parts = internal::parallelParts(a.size(), dims[r]);
+  std::vector<std::size_t> bounds(parts+1);
+  parts = internal::partitionSlabs(dims[r], slab < 0 ? -slab : slab,
+                                   slab > 0 ? reinterpret_cast<std::size_t>(base) : 0, parts, &bounds[0], unit);
+
+  internal::ParallelForBody<Derived, F> body(a, p, dims, strides, r, &bounds[0], f);
+  internal::runParallel(parts, body);
+}
+
+// B(i) = f(A(i)) for every multi-index `i`; shapes must agree. The slowest
+// rank of `B` is split among the workers as in `parallel_for`.
+template<class D1, int Rank, Options O1, class D2, Options O2, class F>
+void parallel_transform(ArrayBase<D1,Rank,O1> const& A, ArrayBase<D2,Rank,O2>& B, F f)
+{
+  D1 const& a = static_cast<D1 const&>(A);
+  D2&       b = static_cast<D2&>(B);
+  internal::assertSameShape(a, b, "**ERROR**: parallel_transform(): incompatible shapes");
+  if (b.size() == 0)
+    return;
+
+  std::size_t const*    dims = B.rdims();
+  std::ptrdiff_t const* ds = B.rstrides();
+  int const             r = internal::outerRank<D2>();
+
+  typename internal::Traits<D1>::const_pointer ps = internal::ContiguousData<D1>::get(a);
+  typename internal::Traits<D2>::pointer       pd = internal::ContiguousData<D2>::get(b);
+  if (!ps || !pd || !internal::sameLinearLayout(a, b) || !internal::isDenseOuter(b, dims, ds, r))
+    ps = NULL, pd = NULL;
+
+  typename internal::Traits<D2>::pointer base = internal::StridedData<D2>::get(b);
+  std::size_t    unit;
+  std::ptrdiff_t slab;
+  internal::outerGroups<O2>(ds, r, sizeof(*base), unit, slab);
+
+  int parts = internal::parallelParts(b.size(), dims[r]);
+  std::vector<std::size_t> bounds(parts+1);
+  parts = internal::partitionSlabs(dims[r], slab < 0 ? -slab : slab,
+                                   slab > 0 ? reinterpret_cast<std::size_t>(base) : 0, parts, &bounds[0], unit);
+
+  internal::ParallelTransformBody<D1, D2, F> body(a, b, ps, pd, A.rstrides(), dims, ds, r, &bounds[0], f);
+  internal::runParallel(parts, body);
+}
+
+} // end namespace
+
+#endif
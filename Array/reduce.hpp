@@ -0,0 +1,533 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_REDUCE_HPP
+#define MA_REDUCE_HPP
+
+#include "parallel.hpp"
+#include <cmath>
+
+// Reductions over whole arrays (parallel_sum, parallel_minValue,
+// parallel_maxValue, norm1, norm2, normInf, argmin, argmax) and along an
+// axis (sum, minValue, maxValue with an `axis` argument). The slowest rank
+// is split among the workers as in `parallel_for`; each worker reduces its
+// chunk with the SIMD kernels when the storage is contiguous, and the
+// partial results are combined pairwise, as a tree.
+
+namespace marray {
+
+namespace internal
+{
+  // multi-index of the element at position `pos` of a dense block walked
+  // in major order
+  template<int Rank>
+  void linearToIndex(std::size_t pos, std::size_t const dims[], bool isRowMajor, std::size_t idx[])
+  {
+    for (int k = 0; k < Rank; ++k)
+    {
+      int const q = isRowMajor ? Rank-1-k : k;
+      idx[q] = pos % dims[q];
+      pos /= dims[q];
+    }
+  }
+
+  // Reduction operations. `result_type` is the partial result, and
+  //
+  //   flat(p, n, pos)      reduces the n > 0 contiguous elements starting
+  //                        at position `pos` in major order
+  //   first(x, idx)        starts a partial result with the element `x`
+  //   next(r, x, idx)      adds the element `x` to `r`
+  //   combine(r, s)        adds to `r` the partial result `s` of later
+  //                        elements
+
+  template<class T>
+  struct SumOp
+  {
+    typedef T result_type;
+    typedef simd::Kernels<T> Kernels;
+
+    T flat(T const* p, std::size_t n, std::size_t) const    { return Kernels::sum(p, n); }
+    T first(T const& x, std::size_t const*) const           { return x; }
+    void next(T& r, T const& x, std::size_t const*) const   { r += x; }
+    void combine(T& r, T const& s) const                    { r += s; }
+  };
+
+  template<class T>
+  struct MinOp
+  {
+    typedef T result_type;
+    typedef simd::Kernels<T> Kernels;
+
+    T flat(T const* p, std::size_t n, std::size_t) const    { return Kernels::min(p, n); }
+    T first(T const& x, std::size_t const*) const           { return x; }
+    void next(T& r, T const& x, std::size_t const*) const   { if (x < r) r = x; }
+    void combine(T& r, T const& s) const                    { if (s < r) r = s; }
+  };
+
+  template<class T>
+  struct MaxOp
+  {
+    typedef T result_type;
+    typedef simd::Kernels<T> Kernels;
+
+    T flat(T const* p, std::size_t n, std::size_t) const    { return Kernels::max(p, n); }
+    T first(T const& x, std::size_t const*) const           { return x; }
+    void next(T& r, T const& x, std::size_t const*) const   { if (r < x) r = x; }
+    void combine(T& r, T const& s) const                    { if (r < s) r = s; }
+  };
+
+  template<class T>
+  inline T absValue(T const& x)
+  { return x < T() ? -x : x; }
+
+  // sum of |x|
+  template<class T>
+  struct AbsSumOp
+  {
+    typedef T result_type;
+    typedef simd::Kernels<T> Kernels;
+
+    T flat(T const* p, std::size_t n, std::size_t) const    { return Kernels::asum(p, n); }
+    T first(T const& x, std::size_t const*) const           { return absValue(x); }
+    void next(T& r, T const& x, std::size_t const*) const   { r += absValue(x); }
+    void combine(T& r, T const& s) const                    { r += s; }
+  };
+
+  // sum of x^2
+  template<class T>
+  struct SqSumOp
+  {
+    typedef T result_type;
+    typedef simd::Kernels<T> Kernels;
+
+    T flat(T const* p, std::size_t n, std::size_t) const    { return Kernels::dot(p, p, n); }
+    T first(T const& x, std::size_t const*) const           { return x*x; }
+    void next(T& r, T const& x, std::size_t const*) const   { r += x*x; }
+    void combine(T& r, T const& s) const                    { r += s; }
+  };
+
+  // max of |x|
+  template<class T>
+  struct AbsMaxOp
+  {
+    typedef T result_type;
+    typedef simd::Kernels<T> Kernels;
+
+    T flat(T const* p, std::size_t n, std::size_t) const
+    { return std::max(absValue(Kernels::min(p, n)), absValue(Kernels::max(p, n))); }
+    T first(T const& x, std::size_t const*) const           { return absValue(x); }
+    void next(T& r, T const& x, std::size_t const*) const   { if (r < absValue(x)) r = absValue(x); }
+    void combine(T& r, T const& s) const                    { if (r < s) r = s; }
+  };
+
+  template<class T, int Rank>
+  struct ArgResult
+  {
+    T           value;
+    std::size_t idx[Rank];
+  };
+
+  // first element, in major order, of the minimum (`isMax` false) or of
+  // the maximum
+  template<class T, int Rank, bool isMax>
+  struct ArgOp
+  {
+    typedef ArgResult<T, Rank> result_type;
+    typedef simd::Kernels<T>   Kernels;
+
+    std::size_t const* dims;
+    bool               isRowMajor;
+
+    ArgOp(std::size_t const* dims_, bool isRowMajor_) : dims(dims_), isRowMajor(isRowMajor_)
+    { }
+
+    static bool better(T const& x, T const& y)
+    { return isMax ? y < x : x < y; }
+
+    result_type flat(T const* p, std::size_t n, std::size_t pos) const
+    {
+      result_type r;
+      r.value = isMax ? Kernels::max(p, n) : Kernels::min(p, n);
+      std::size_t const k = std::find(p, p+n, r.value) - p;
+      linearToIndex<Rank>(pos + (k < n ? k : 0), dims, isRowMajor, r.idx);
+      if (k == n)
+        r.value = p[0];
+      return r;
+    }
+
+    result_type first(T const& x, std::size_t const* idx) const
+    {
+      result_type r;
+      r.value = x;
+      std::copy(idx, idx+Rank, r.idx);
+      return r;
+    }
+
+    void next(result_type& r, T const& x, std::size_t const* idx) const
+    {
+      if (better(x, r.value))
+        r = first(x, idx);
+    }
+
+    void combine(result_type& r, result_type const& s) const
+    {
+      if (better(s.value, r.value))
+        r = s;
+    }
+  };
+
+  // reduces the elements of `a` whose index in the outer rank `r` is in
+  // [first, last), in major order
+  template<class Derived, class Op>
+  typename Op::result_type reduceSlabs(Derived const& a, std::size_t const dims[], std::ptrdiff_t const strides[],
+                                       int r, std::size_t first, std::size_t last, Op const& op)
+  {
+    static const int Rank = Derived::Rank;
+    typedef typename Derived::IdxComputer IC;
+
+    std::size_t    beg[Rank], end[Rank], idx[Rank];
+    std::ptrdiff_t off = IC::term(strides, r, first);
+    std::size_t    n = 1;
+    for (int k = 0; k < Rank; ++k)
+    {
+      beg[k] = idx[k] = k == r ? first : 0;
+      end[k] = k == r ? last : dims[k];
+      n *= end[k] - beg[k];
+    }
+
+    typename Op::result_type res = op.first(a.access(off), idx);
+    for (std::size_t c = 1; c < n; ++c)
+    {
+      for (int k = 0; k < Rank; ++k)
+      {
+        int const q = Derived::isRowMajor ? Rank-1-k : k;
+        off += IC::step(strides, q, idx[q]);
+        if (++idx[q] < end[q])
+          break;
+        off -= IC::term(strides, q, end[q]) - IC::term(strides, q, beg[q]);
+        idx[q] = beg[q];
+      }
+      op.next(res, a.access(off), idx);
+    }
+    return res;
+  }
+
+  template<class Derived, class Op>
+  struct ReduceBody
+  {
+    Derived const&         a;
+    typename Traits<Derived>::const_pointer p;
+    std::size_t const*     dims;
+    std::ptrdiff_t const*  strides;
+    int                    r;
+    std::size_t const*     bounds;
+    Op const&              op;
+    typename Op::result_type* partial;
+
+    ReduceBody(Derived const& a_, typename Traits<Derived>::const_pointer p_, std::size_t const* dims_,
+               std::ptrdiff_t const* strides_, int r_, std::size_t const* bounds_, Op const& op_,
+               typename Op::result_type* partial_)
+      : a(a_), p(p_), dims(dims_), strides(strides_), r(r_), bounds(bounds_), op(op_), partial(partial_)
+    { }
+
+    void operator()(int part)
+    {
+      if (p)
+      {
+        std::size_t const s = strides[r];
+        partial[part] = op.flat(p + bounds[part]*s, (bounds[part+1] - bounds[part])*s, bounds[part]*s);
+      }
+      else
+        partial[part] = reduceSlabs(a, dims, strides, r, bounds[part], bounds[part+1], op);
+    }
+  };
+
+  // reduction of a non-empty array with `op`
+  template<class Derived, int Rank, Options Opts, class Op>
+  typename Op::result_type parallelReduce(ArrayBase<Derived,Rank,Opts> const& x, Op const& op)
+  {
+    Derived const& a = static_cast<Derived const&>(x);
+    std::size_t const*    dims = x.rdims();
+    std::ptrdiff_t const* strides = x.rstrides();
+    int const             r = outerRank<Derived>();
+
+    typename Traits<Derived>::const_pointer p = ContiguousData<Derived>::get(a);
+    if (p && !isDenseOuter(a, dims, strides, r))
+      p = NULL;
+
+    int parts = parallelParts(a.size(), dims[r]);
+    std::vector<std::size_t> bounds(parts+1);
+    parts = partitionSlabs(dims[r], 0, 0, parts, &bounds[0]);
+
+    std::vector<typename Op::result_type> partial(parts);
+    ReduceBody<Derived, Op> body(a, p, dims, strides, r, &bounds[0], op, &partial[0]);
+    runParallel(parts, body);
+
+    // partial[i] takes partial[i+step], in log2(parts) rounds
+    for (int step = 1; step < parts; step *= 2)
+      for (int i = 0; i + step < parts; i += 2*step)
+        op.combine(partial[i], partial[i+step]);
+    return partial[0];
+  }
+
+
+  // elementwise accumulations for the reductions along an axis
+  template<class T>
+  struct AxisSum
+  {
+    typedef simd::Kernels<T> Kernels;
+    static void acc(T* y, T const* x, std::size_t n)  { Kernels::addInPlace(y, x, n); }
+    static T flat(T const* x, std::size_t n)          { return Kernels::sum(x, n); }
+    static void one(T& y, T const& x)                 { y += x; }
+  };
+
+  template<class T>
+  struct AxisMin
+  {
+    typedef simd::Kernels<T> Kernels;
+    static void acc(T* y, T const* x, std::size_t n)  { Kernels::minInPlace(y, x, n); }
+    static T flat(T const* x, std::size_t n)          { return Kernels::min(x, n); }
+    static void one(T& y, T const& x)                 { if (x < y) y = x; }
+  };
+
+  template<class T>
+  struct AxisMax
+  {
+    typedef simd::Kernels<T> Kernels;
+    static void acc(T* y, T const* x, std::size_t n)  { Kernels::maxInPlace(y, x, n); }
+    static T flat(T const* x, std::size_t n)          { return Kernels::max(x, n); }
+    static void one(T& y, T const& x)                 { if (y < x) y = x; }
+  };
+
+  // A dense block seen as [outer][n][inner] in memory order, `n` being the
+  // extent of the axis: y[o][i] = reduction over k of x[o][k][i]. The
+  // workers split `outer` or, when it is too short, `inner`.
+  template<class T, class Acc>
+  struct AxisBody
+  {
+    T const*           x;
+    T*                 y;
+    std::size_t        n, inner;
+    bool               splitOuter;
+    std::size_t const* bounds;
+
+    AxisBody(T const* x_, T* y_, std::size_t n_, std::size_t inner_, bool splitOuter_,
+             std::size_t const* bounds_)
+      : x(x_), y(y_), n(n_), inner(inner_), splitOuter(splitOuter_), bounds(bounds_)
+    { }
+
+    void operator()(int part)
+    {
+      std::size_t const o0 = splitOuter ? bounds[part] : 0;
+      std::size_t const o1 = splitOuter ? bounds[part+1] : bounds[0];
+      std::size_t const i0 = splitOuter ? 0 : bounds[part+1];
+      std::size_t const i1 = splitOuter ? inner : bounds[part+2];
+
+      for (std::size_t o = o0; o < o1; ++o)
+      {
+        T* yo = y + o*inner;
+        T const* xo = x + o*n*inner;
+        if (inner == 1)
+        {
+          *yo = Acc::flat(xo, n);
+          continue;
+        }
+        std::copy(xo + i0, xo + i1, yo + i0);
+        for (std::size_t k = 1; k < n; ++k)
+          Acc::acc(yo + i0, xo + k*inner + i0, i1 - i0);
+      }
+    }
+  };
+
+  struct ERROR_REDUCTION_ALONG_AN_AXIS_REQUIRES_RANK_2_OR_MORE;
+
+  // the result of a reduction along an axis; a rank-1 array has none
+  // (its reduction is a scalar: sum(x), minValue(x), maxValue(x))
+  template<class T, int Rank, Options O>
+  struct AxisResult
+  { typedef Array<T, Rank-1, O> type; };
+
+  template<class T, Options O>
+  struct AxisResult<T, 1, O>
+  { typedef ERROR_REDUCTION_ALONG_AN_AXIS_REQUIRES_RANK_2_OR_MORE type; };
+
+  template<class Acc, class Derived, int Rank, Options Opts>
+  typename AxisResult<typename BulkTraits<Derived>::value_type, Rank, Opts>::type
+  reduceAxis(ArrayBase<Derived,Rank,Opts> const& x, int axis, const char* msg)
+  {
+    MA_STATIC_CHECK(Rank > 1, REDUCTION_ALONG_AN_AXIS_REQUIRES_RANK_2_OR_MORE);
+    typedef typename BulkTraits<Derived>::value_type T;
+
+    Derived const& a = static_cast<Derived const&>(x);
+    assertTrue(axis >= 0 && axis < Rank, msg);
+    assertTrue(a.size() > 0, msg);
+
+    std::size_t bdims[Rank-1];
+    for (int k = 0, j = 0; k < Rank; ++k)
+      if (k != axis)
+        bdims[j++] = a.dim(k);
+    Array<T, Rank-1, Opts> b(bdims);
+
+    if (typename Traits<Derived>::const_pointer p = ContiguousData<Derived>::get(a))
+    {
+      std::size_t const n = a.dim(axis);
+      std::size_t inner = 1;
+      for (int k = 0; k < Rank; ++k)
+        if (Derived::isRowMajor ? k > axis : k < axis)
+          inner *= a.dim(k);
+      std::size_t const outer = a.size() / (n*inner);
+
+      // bounds[0] = outer when `inner` is split, the chunks follow
+      int parts = parallelParts(a.size(), std::max(outer, inner));
+      bool const splitOuter = outer >= (std::size_t)parts || inner == 1;
+      std::vector<std::size_t> bounds(parts+2);
+      if (splitOuter)
+        parts = partitionSlabs(outer, inner*sizeof(T), reinterpret_cast<std::size_t>(b.data()), parts, &bounds[0]);
+      else
+      {
+        bounds[0] = outer;
+        parts = partitionSlabs(inner, sizeof(T), reinterpret_cast<std::size_t>(b.data()), parts, &bounds[1]);
+      }
+
+      AxisBody<T, Acc> body(p, b.data(), n, inner, splitOuter, &bounds[0]);
+      runParallel(parts, body);
+      return b;
+    }
+
+    // other storages: one pass in the major order of `a`
+    std::size_t dims[Rank], idx[Rank] = {}, bidx[Rank];
+    for (int k = 0; k < Rank; ++k)
+      dims[k] = a.dim(k);
+    for (std::size_t c = 0; c < a.size(); ++c)
+    {
+      for (int k = 0, j = 0; k < Rank; ++k)
+        if (k != axis)
+          bidx[j++] = idx[k];
+      if (idx[axis] == 0)
+        b(bidx) = a(idx);
+      else
+        Acc::one(b(bidx), a(idx));
+      nextIndex<Rank>(idx, dims, Derived::isRowMajor);
+    }
+    return b;
+  }
+}
+
+
+// sum of the elements; the parallel version of `sum(x)`
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type parallel_sum(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  if (static_cast<Derived const&>(x).size() == 0)
+    return T();
+  return internal::parallelReduce(x, internal::SumOp<T>());
+}
+
+// x must not be empty
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type parallel_minValue(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  internal::assertTrue(static_cast<Derived const&>(x).size() > 0, "**ERROR**: parallel_minValue(): empty array");
+  return internal::parallelReduce(x, internal::MinOp<T>());
+}
+
+// x must not be empty
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type parallel_maxValue(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  internal::assertTrue(static_cast<Derived const&>(x).size() > 0, "**ERROR**: parallel_maxValue(): empty array");
+  return internal::parallelReduce(x, internal::MaxOp<T>());
+}
+
+// sum of |x(i)|
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type norm1(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  if (static_cast<Derived const&>(x).size() == 0)
+    return T();
+  return internal::parallelReduce(x, internal::AbsSumOp<T>());
+}
+
+// square root of the sum of x(i)^2
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type norm2(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  if (static_cast<Derived const&>(x).size() == 0)
+    return T();
+  return std::sqrt(internal::parallelReduce(x, internal::SqSumOp<T>()));
+}
+
+// max of |x(i)|
+template<class Derived, int Rank, Options Opts>
+typename internal::BulkTraits<Derived>::value_type normInf(ArrayBase<Derived,Rank,Opts> const& x)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  if (static_cast<Derived const&>(x).size() == 0)
+    return T();
+  return internal::parallelReduce(x, internal::AbsMaxOp<T>());
+}
+
+// minimum of x; its multi-index (the first one in major order, if repeated)
+// is written to `idx`. x must not be empty
+template<class Derived, int Rank, Options Opts, class Idx>
+typename internal::BulkTraits<Derived>::value_type argmin(ArrayBase<Derived,Rank,Opts> const& x, Idx idx[])
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  internal::assertTrue(static_cast<Derived const&>(x).size() > 0, "**ERROR**: argmin(): empty array");
+  internal::ArgResult<T, Rank> const r =
+      internal::parallelReduce(x, internal::ArgOp<T, Rank, false>(x.rdims(), Derived::isRowMajor));
+  std::copy(r.idx, r.idx+Rank, idx);
+  return r.value;
+}
+
+// maximum of x; see `argmin`
+template<class Derived, int Rank, Options Opts, class Idx>
+typename internal::BulkTraits<Derived>::value_type argmax(ArrayBase<Derived,Rank,Opts> const& x, Idx idx[])
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  internal::assertTrue(static_cast<Derived const&>(x).size() > 0, "**ERROR**: argmax(): empty array");
+  internal::ArgResult<T, Rank> const r =
+      internal::parallelReduce(x, internal::ArgOp<T, Rank, true>(x.rdims(), Derived::isRowMajor));
+  std::copy(r.idx, r.idx+Rank, idx);
+  return r.value;
+}
+
+// reductions along rank `axis`: the result has the dims of `x` without
+// `axis`, e.g. `sum(A, 2)` of an Array<double,4> is an Array<double,3>.
+// `x` must have rank 2 or more; use sum(x) etc. for a rank-1 array.
+template<class Derived, int Rank, Options Opts>
+typename internal::AxisResult<typename internal::BulkTraits<Derived>::value_type, Rank, Opts>::type
+sum(ArrayBase<Derived,Rank,Opts> const& x, int axis)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  return internal::reduceAxis<internal::AxisSum<T> >(x, axis, "**ERROR**: sum(): invalid axis or empty array");
+}
+
+template<class Derived, int Rank, Options Opts>
+typename internal::AxisResult<typename internal::BulkTraits<Derived>::value_type, Rank, Opts>::type
+minValue(ArrayBase<Derived,Rank,Opts> const& x, int axis)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  return internal::reduceAxis<internal::AxisMin<T> >(x, axis, "**ERROR**: minValue(): invalid axis or empty array");
+}
+
+template<class Derived, int Rank, Options Opts>
+typename internal::AxisResult<typename internal::BulkTraits<Derived>::value_type, Rank, Opts>::type
+maxValue(ArrayBase<Derived,Rank,Opts> const& x, int axis)
+{
+  typedef typename internal::BulkTraits<Derived>::value_type T;
+  return internal::reduceAxis<internal::AxisMax<T> >(x, axis, "**ERROR**: maxValue(): invalid axis or empty array");
+}
+
+} // end namespace
+
+#endif
@@ -0,0 +1,331 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_SCHEDULER_HPP
+#define MA_SCHEDULER_HPP
+
+#include "parallel.hpp"
+
+#include <ctime>
+#if defined(MA_HAVE_STD_THREAD)
+#include <mutex>
+#include <chrono>
+#endif
+
+namespace marray {
+
+namespace internal
+{
+  // lock guarding a worker's queue
+#if defined(_OPENMP)
+  class Mutex
+  {
+  public:
+    Mutex()       { omp_init_lock(&m_lock); }
+    ~Mutex()      { omp_destroy_lock(&m_lock); }
+    void lock()   { omp_set_lock(&m_lock); }
+    void unlock() { omp_unset_lock(&m_lock); }
+  private:
+    Mutex(Mutex const&);
+    Mutex& operator=(Mutex const&);
+    omp_lock_t m_lock;
+  };
+#elif defined(MA_HAVE_STD_THREAD)
+  class Mutex
+  {
+  public:
+    void lock()   { m_mutex.lock(); }
+    void unlock() { m_mutex.unlock(); }
+  private:
+    std::mutex m_mutex;
+  };
+#else
+  class Mutex
+  {
+  public:
+    void lock()   { }
+    void unlock() { }
+  };
+#endif
+
+  // wall clock in seconds (processor time in serial c++98 builds)
+  inline double wallTime()
+  {
+#if defined(_OPENMP)
+    return omp_get_wtime();
+#elif defined(MA_HAVE_STD_THREAD)
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+  }
+
+  // the tiles [lo, hi) not yet taken from a worker; the owner takes them
+  // from the front, thieves the back half
+  struct TileQueue
+  {
+    Mutex       mutex;
+    std::size_t lo, hi;
+    char        pad[MA_CACHE_LINE];
+
+    TileQueue() : lo(0), hi(0)
+    { }
+
+    bool pop(std::size_t& t)
+    {
+      mutex.lock();
+      bool const ok = lo < hi;
+      if (ok)
+        t = lo++;
+      mutex.unlock();
+      return ok;
+    }
+
+    bool stealHalf(std::size_t& first, std::size_t& last)
+    {
+      mutex.lock();
+      bool const ok = lo < hi;
+      if (ok)
+      {
+        first = lo + (hi - lo)/2;
+        last = hi;
+        hi = first;
+      }
+      mutex.unlock();
+      return ok;
+    }
+
+    void assign(std::size_t first, std::size_t last)
+    {
+      mutex.lock();
+      lo = first;
+      hi = last;
+      mutex.unlock();
+    }
+  };
+}
+
+
+// statistics of the last `TileScheduler::run()`
+struct SchedulerStats
+{
+  double                   elapsed;  // wall time of the run, in seconds
+  std::vector<double>      busy;     // time spent in the kernel, per worker
+  std::vector<std::size_t> tiles;    // tiles run, per worker
+  std::vector<std::size_t> steals;   // successful steals, per worker
+
+  SchedulerStats() : elapsed(0)
+  { }
+
+  int workers() const
+  { return (int)busy.size(); }
+
+  // fraction of the run that worker `w` spent in the kernel
+  double utilization(int w) const
+  { return elapsed > 0 ? busy[w] / elapsed : 0.; }
+
+  // mean over the workers
+  double utilization() const
+  {
+    double u = 0;
+    for (int w = 0; w < workers(); ++w)
+      u += utilization(w);
+    return workers() > 0 ? u / workers() : 0.;
+  }
+};
+
+
+// Runs a kernel over the tiles of an N-D index space on a work-stealing
+// pool, for kernels whose cost varies from region to region (e.g. stencils
+// near boundaries). The kernel is called as
+//
+//    kernel(std::size_t const first[], std::size_t const last[])
+//
+// once per tile, with the half-open box [first, last) of the tile; each
+// worker has its own copy of it. Each worker starts with a contiguous run of
+// tiles, in the major order of the array, and when it runs out it takes the
+// second half of the remaining tiles of another worker.
+template<int Rank>
+class TileScheduler
+{
+public:
+  // by default the slowest rank is cut into about 8 tiles per worker, and
+  // the tiles span the whole extent of the other ranks
+  TileScheduler() : m_tile(), m_isDefault(true)
+  { }
+
+  // tile extent per rank, 0 meaning the whole extent
+  template<class T>
+  explicit TileScheduler(T const tile[])
+  { setTile(tile); }
+
+  template<class T>
+  void setTile(T const tile[])
+  {
+    for (int r = 0; r < Rank; ++r)
+      m_tile[r] = tile[r];
+    m_isDefault = false;
+  }
+
+  std::size_t tile(int r) const
+  {
+    internal::assertTrue(r < Rank, "**ERROR**: TileScheduler<>: invalid rank in function `tile()`");
+    return m_tile[r];
+  }
+
+  SchedulerStats const& stats() const
+  { return m_stats; }
+
+  // tiles the index space of `A`, in its major order
+  template<class Derived, Options Opts, class K>
+  void run(ArrayBase<Derived,Rank,Opts> const& A, K kernel)
+  { run(A.rdims(), (bool)Derived::isRowMajor, kernel); }
+
+  template<class K>
+  void run(std::size_t const dims[], bool isRowMajor, K kernel)
+  {
+    int workers = num_threads();
+
+    Space s;
+    s.n = 1;
+    for (int r = 0; r < Rank; ++r)
+    {
+      int const q = isRowMajor ? r : Rank-1-r;
+      std::size_t t = m_tile[q];
+      if (m_isDefault && r == 0)
+        t = (dims[q] + 8*workers - 1) / (8*workers);
+      s.order[r] = q;
+      s.dims[q] = dims[q];
+      s.tile[q] = t > 0 && t < dims[q] ? t : dims[q];
+      s.ntiles[q] = s.tile[q] > 0 ? (dims[q] + s.tile[q] - 1) / s.tile[q] : 0;
+      s.n *= s.ntiles[q];
+    }
+
+    if ((std::size_t)workers > s.n)
+      workers = s.n > 0 ? (int)s.n : 1;
+
+    m_stats.busy.assign(workers, 0.);
+    m_stats.tiles.assign(workers, 0);
+    m_stats.steals.assign(workers, 0);
+
+    Queues queues(workers);
+    for (int w = 0; w < workers; ++w)
+      queues[w].assign(s.n * w / workers, s.n * (w+1) / workers);
+
+    Worker<K> body(s, queues.q, workers, kernel, m_stats);
+    double const t0 = internal::wallTime();
+    internal::runParallel(workers, body);
+    m_stats.elapsed = internal::wallTime() - t0;
+  }
+
+private:
+  // the tiled index space
+  struct Space
+  {
+    std::size_t dims[Rank], tile[Rank], ntiles[Rank];
+    int         order[Rank];   // ranks from the slowest to the fastest
+    std::size_t n;             // number of tiles
+
+    // box of tile `t`
+    void box(std::size_t t, std::size_t first[], std::size_t last[]) const
+    {
+      for (int r = Rank-1; r >= 0; --r)
+      {
+        int const q = order[r];
+        std::size_t const i = t % ntiles[q];
+        t /= ntiles[q];
+        first[q] = i * tile[q];
+        last[q] = std::min(first[q] + tile[q], dims[q]);
+      }
+    }
+  };
+
+  struct Queues
+  {
+    internal::TileQueue* q;
+
+    explicit Queues(int n) : q(new internal::TileQueue[n])
+    { }
+
+    ~Queues()
+    { delete [] q; }
+
+    internal::TileQueue& operator[](int w)
+    { return q[w]; }
+
+  private:
+    Queues(Queues const&);
+    Queues& operator=(Queues const&);
+  };
+
+  template<class K>
+  struct Worker
+  {
+    Space const&         s;
+    internal::TileQueue* queues;
+    int                  workers;
+    K const&             kernel;
+    SchedulerStats&      stats;
+
+    Worker(Space const& s_, internal::TileQueue* queues_, int workers_, K const& kernel_,
+           SchedulerStats& stats_)
+      : s(s_), queues(queues_), workers(workers_), kernel(kernel_), stats(stats_)
+    { }
+
+    void operator()(int w)
+    {
+      K k(kernel);
+      std::size_t first[Rank], last[Rank];
+      double      busy = 0;
+      std::size_t tiles = 0, steals = 0;
+
+      for (;;)
+      {
+        std::size_t t;
+        if (!queues[w].pop(t))
+        {
+          if (!steal(w))
+            break;
+          ++steals;
+          continue;
+        }
+        s.box(t, first, last);
+        double const t0 = internal::wallTime();
+        k(static_cast<std::size_t const*>(first), static_cast<std::size_t const*>(last));
+        busy += internal::wallTime() - t0;
+        ++tiles;
+      }
+
+      stats.busy[w] = busy;
+      stats.tiles[w] = tiles;
+      stats.steals[w] = steals;
+    }
+
+    // moves half of the tiles left to another worker into the queue of `w`
+    bool steal(int w)
+    {
+      for (int i = 1; i < workers; ++i)
+      {
+        std::size_t first, last;
+        if (queues[(w+i) % workers].stealHalf(first, last))
+        {
+          queues[w].assign(first, last);
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  std::size_t    m_tile[Rank];
+  bool           m_isDefault;
+  SchedulerStats m_stats;
+};
+
+} // end namespace
+
+#endif
@@ -0,0 +1,496 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_SIMD_HPP
+#define MA_SIMD_HPP
+
+#include <cstddef>
+#include <algorithm>
+
+// Bulk kernels over contiguous memory: fill, copy, axpy, scale, sum, min,
+// max, dot, asum (sum of absolute values) and the elementwise accumulations
+// used by the reductions along an axis. `float` and `double` go through explicit SSE2/AVX/AVX-512
+// code, chosen at compile time from the target flags (e.g. `-mavx2`,
+// `-march=native`); any other type, or a target without these
+// instruction sets, uses the scalar version. Define MA_NO_SIMD to force
+// the scalar version.
+
+#if !defined(MA_NO_SIMD) && (defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__))
+// gcc 12 reports false positives inside the AVX-512 headers
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#define MA_HAVE_SIMD
+#endif
+
+namespace marray {
+
+namespace internal
+{
+namespace simd
+{
+
+  // One SIMD register of `T`. Specialized below for the widest instruction
+  // set available; `enabled` is false when there is none.
+  template<class T>
+  struct Pack { static const bool enabled = false; static const std::size_t alignment = 1; };
+
+#ifdef MA_HAVE_SIMD
+
+#if defined(__AVX512F__)
+
+  template<>
+  struct Pack<double>
+  {
+    static const bool enabled = true;
+    static const int  size = 8;
+    typedef __m512d type;
+    static const std::size_t alignment = sizeof(__m512d);
+
+    static type load(double const* p)           { return _mm512_loadu_pd(p); }
+    static void store(double* p, type x)        { _mm512_storeu_pd(p, x); }
+    static type loada(double const* p)          { return _mm512_load_pd(p); }
+    static void storea(double* p, type x)       { _mm512_store_pd(p, x); }
+    static type set1(double x)                  { return _mm512_set1_pd(x); }
+    static type add(type a, type b)             { return _mm512_add_pd(a, b); }
+    static type mul(type a, type b)             { return _mm512_mul_pd(a, b); }
+    static type fmadd(type a, type b, type c)   { return _mm512_fmadd_pd(a, b, c); }
+    static type min(type a, type b)             { return _mm512_min_pd(a, b); }
+    static type max(type a, type b)             { return _mm512_max_pd(a, b); }
+    // the horizontal operations run once per call; going through memory
+    // avoids the _mm512_reduce_* helpers, which are not available everywhere
+    static double hsum(type a)                  { double t[size]; store(t, a); double s = t[0]; for (int i = 1; i < size; ++i) s += t[i]; return s; }
+    static double hmin(type a)                  { double t[size]; store(t, a); return *std::min_element(t, t+size); }
+    static double hmax(type a)                  { double t[size]; store(t, a); return *std::max_element(t, t+size); }
+  };
+
+  template<>
+  struct Pack<float>
+  {
+    static const bool enabled = true;
+    static const int  size = 16;
+    typedef __m512 type;
+    static const std::size_t alignment = sizeof(__m512);
+
+    static type load(float const* p)            { return _mm512_loadu_ps(p); }
+    static void store(float* p, type x)         { _mm512_storeu_ps(p, x); }
+    static type loada(float const* p)           { return _mm512_load_ps(p); }
+    static void storea(float* p, type x)        { _mm512_store_ps(p, x); }
+    static type set1(float x)                   { return _mm512_set1_ps(x); }
+    static type add(type a, type b)             { return _mm512_add_ps(a, b); }
+    static type mul(type a, type b)             { return _mm512_mul_ps(a, b); }
+    static type fmadd(type a, type b, type c)   { return _mm512_fmadd_ps(a, b, c); }
+    static type min(type a, type b)             { return _mm512_min_ps(a, b); }
+    static type max(type a, type b)             { return _mm512_max_ps(a, b); }
+    static float hsum(type a)                   { float t[size]; store(t, a); float s = t[0]; for (int i = 1; i < size; ++i) s += t[i]; return s; }
+    static float hmin(type a)                   { float t[size]; store(t, a); return *std::min_element(t, t+size); }
+    static float hmax(type a)                   { float t[size]; store(t, a); return *std::max_element(t, t+size); }
+  };
+
+#elif defined(__AVX__)
+
+  template<>
+  struct Pack<double>
+  {
+    static const bool enabled = true;
+    static const int  size = 4;
+    typedef __m256d type;
+    static const std::size_t alignment = sizeof(__m256d);
+
+    static type load(double const* p)           { return _mm256_loadu_pd(p); }
+    static void store(double* p, type x)        { _mm256_storeu_pd(p, x); }
+    static type loada(double const* p)          { return _mm256_load_pd(p); }
+    static void storea(double* p, type x)       { _mm256_store_pd(p, x); }
+    static type set1(double x)                  { return _mm256_set1_pd(x); }
+    static type add(type a, type b)             { return _mm256_add_pd(a, b); }
+    static type mul(type a, type b)             { return _mm256_mul_pd(a, b); }
+#ifdef __FMA__
+    static type fmadd(type a, type b, type c)   { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static type fmadd(type a, type b, type c)   { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+    static type min(type a, type b)             { return _mm256_min_pd(a, b); }
+    static type max(type a, type b)             { return _mm256_max_pd(a, b); }
+
+    static __m128d fold(type a)                 { return _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1)); }
+    static double hsum(type a)                  { __m128d x = fold(a); return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x))); }
+    static double hmin(type a)
+    {
+      __m128d x = _mm_min_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+      return _mm_cvtsd_f64(_mm_min_sd(x, _mm_unpackhi_pd(x, x)));
+    }
+    static double hmax(type a)
+    {
+      __m128d x = _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+      return _mm_cvtsd_f64(_mm_max_sd(x, _mm_unpackhi_pd(x, x)));
+    }
+  };
+
+  template<>
+  struct Pack<float>
+  {
+    static const bool enabled = true;
+    static const int  size = 8;
+    typedef __m256 type;
+    static const std::size_t alignment = sizeof(__m256);
+
+    static type load(float const* p)            { return _mm256_loadu_ps(p); }
+    static void store(float* p, type x)         { _mm256_storeu_ps(p, x); }
+    static type loada(float const* p)           { return _mm256_load_ps(p); }
+    static void storea(float* p, type x)        { _mm256_store_ps(p, x); }
+    static type set1(float x)                   { return _mm256_set1_ps(x); }
+    static type add(type a, type b)             { return _mm256_add_ps(a, b); }
+    static type mul(type a, type b)             { return _mm256_mul_ps(a, b); }
+#ifdef __FMA__
+    static type fmadd(type a, type b, type c)   { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static type fmadd(type a, type b, type c)   { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    static type min(type a, type b)             { return _mm256_min_ps(a, b); }
+    static type max(type a, type b)             { return _mm256_max_ps(a, b); }
+
+    template<class Op>
+    static float reduce(type a, Op op)
+    {
+      __m128 x = op(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+      x = op(x, _mm_movehl_ps(x, x));
+      x = op(x, _mm_shuffle_ps(x, x, 1));
+      return _mm_cvtss_f32(x);
+    }
+    static __m128 add4(__m128 a, __m128 b)      { return _mm_add_ps(a, b); }
+    static __m128 min4(__m128 a, __m128 b)      { return _mm_min_ps(a, b); }
+    static __m128 max4(__m128 a, __m128 b)      { return _mm_max_ps(a, b); }
+    static float hsum(type a)                   { return reduce(a, add4); }
+    static float hmin(type a)                   { return reduce(a, min4); }
+    static float hmax(type a)                   { return reduce(a, max4); }
+  };
+
+#else // SSE2
+
+  template<>
+  struct Pack<double>
+  {
+    static const bool enabled = true;
+    static const int  size = 2;
+    typedef __m128d type;
+    static const std::size_t alignment = sizeof(__m128d);
+
+    static type load(double const* p)           { return _mm_loadu_pd(p); }
+    static void store(double* p, type x)        { _mm_storeu_pd(p, x); }
+    static type loada(double const* p)          { return _mm_load_pd(p); }
+    static void storea(double* p, type x)       { _mm_store_pd(p, x); }
+    static type set1(double x)                  { return _mm_set1_pd(x); }
+    static type add(type a, type b)             { return _mm_add_pd(a, b); }
+    static type mul(type a, type b)             { return _mm_mul_pd(a, b); }
+    static type fmadd(type a, type b, type c)   { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static type min(type a, type b)             { return _mm_min_pd(a, b); }
+    static type max(type a, type b)             { return _mm_max_pd(a, b); }
+    static double hsum(type a)                  { return _mm_cvtsd_f64(_mm_add_sd(a, _mm_unpackhi_pd(a, a))); }
+    static double hmin(type a)                  { return _mm_cvtsd_f64(_mm_min_sd(a, _mm_unpackhi_pd(a, a))); }
+    static double hmax(type a)                  { return _mm_cvtsd_f64(_mm_max_sd(a, _mm_unpackhi_pd(a, a))); }
+  };
+
+  template<>
+  struct Pack<float>
+  {
+    static const bool enabled = true;
+    static const int  size = 4;
+    typedef __m128 type;
+    static const std::size_t alignment = sizeof(__m128);
+
+    static type load(float const* p)            { return _mm_loadu_ps(p); }
+    static void store(float* p, type x)         { _mm_storeu_ps(p, x); }
+    static type loada(float const* p)           { return _mm_load_ps(p); }
+    static void storea(float* p, type x)        { _mm_store_ps(p, x); }
+    static type set1(float x)                   { return _mm_set1_ps(x); }
+    static type add(type a, type b)             { return _mm_add_ps(a, b); }
+    static type mul(type a, type b)             { return _mm_mul_ps(a, b); }
+    static type fmadd(type a, type b, type c)   { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static type min(type a, type b)             { return _mm_min_ps(a, b); }
+    static type max(type a, type b)             { return _mm_max_ps(a, b); }
+
+    template<class Op>
+    static float reduce(type x, Op op)
+    {
+      x = op(x, _mm_movehl_ps(x, x));
+      x = op(x, _mm_shuffle_ps(x, x, 1));
+      return _mm_cvtss_f32(x);
+    }
+    static type add4(type a, type b)            { return _mm_add_ps(a, b); }
+    static type min4(type a, type b)            { return _mm_min_ps(a, b); }
+    static type max4(type a, type b)            { return _mm_max_ps(a, b); }
+    static float hsum(type a)                   { return reduce(a, add4); }
+    static float hmin(type a)                   { return reduce(a, min4); }
+    static float hmax(type a)                   { return reduce(a, max4); }
+  };
+
+#endif
+
+#endif // MA_HAVE_SIMD
+
+
+  // unaligned or aligned (`isAligned`) memory access through `P`
+  template<class P, bool isAligned>
+  struct Memory
+  {
+    template<class T>
+    static typename P::type load(T const* p)     { return P::load(p); }
+    template<class T>
+    static void store(T* p, typename P::type x)  { P::store(p, x); }
+  };
+
+  template<class P>
+  struct Memory<P, true>
+  {
+    template<class T>
+    static typename P::type load(T const* p)     { return P::loada(p); }
+    template<class T>
+    static void store(T* p, typename P::type x)  { P::storea(p, x); }
+  };
+
+
+  //
+  // Scalar versions
+  //
+
+  // `isAligned`: every pointer passed is aligned to `Pack<T>::alignment`
+  template<class T, bool isVectorized = Pack<T>::enabled, bool isAligned = false>
+  struct Kernels
+  {
+    static void fill(T* x, std::size_t n, T const& v)
+    { std::fill(x, x+n, v); }
+
+    static void copy(T* dst, T const* src, std::size_t n)
+    { std::copy(src, src+n, dst); }
+
+    // y += a*x
+    static void axpy(T* y, T const& a, T const* x, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        y[i] += a*x[i];
+    }
+
+    static void scale(T* x, T const& a, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        x[i] *= a;
+    }
+
+    static T sum(T const* x, std::size_t n)
+    {
+      T s = T();
+      for (std::size_t i = 0; i < n; ++i)
+        s += x[i];
+      return s;
+    }
+
+    // n > 0
+    static T min(T const* x, std::size_t n)
+    { return *std::min_element(x, x+n); }
+
+    // n > 0
+    static T max(T const* x, std::size_t n)
+    { return *std::max_element(x, x+n); }
+
+    static T dot(T const* x, T const* y, std::size_t n)
+    {
+      T s = T();
+      for (std::size_t i = 0; i < n; ++i)
+        s += x[i]*y[i];
+      return s;
+    }
+
+    static T asum(T const* x, std::size_t n)
+    {
+      T s = T();
+      for (std::size_t i = 0; i < n; ++i)
+        s += x[i] < T() ? -x[i] : x[i];
+      return s;
+    }
+
+    // y += x
+    static void addInPlace(T* y, T const* x, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        y[i] += x[i];
+    }
+
+    // y = min(y, x)
+    static void minInPlace(T* y, T const* x, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        if (x[i] < y[i])
+          y[i] = x[i];
+    }
+
+    // y = max(y, x)
+    static void maxInPlace(T* y, T const* x, std::size_t n)
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        if (y[i] < x[i])
+          y[i] = x[i];
+    }
+  };
+
+
+  //
+  // Vectorized versions: the main loop works on whole registers (two at a
+  // time for the reductions, to hide the latency of the adds), the tail
+  // falls back to the scalar code.
+  //
+
+  template<class T, bool isAligned>
+  struct Kernels<T, true, isAligned>
+  {
+    typedef Pack<T>               P;
+    typedef typename P::type      V;
+    typedef Memory<P, isAligned>  M;
+    typedef Kernels<T, false>     Scalar;
+
+    static const std::size_t W = P::size;
+
+    static void fill(T* x, std::size_t n, T const& v)
+    {
+      V const vv = P::set1(v);
+      std::size_t i = 0;
+      for (; i + W <= n; i += W)
+        M::store(x+i, vv);
+      Scalar::fill(x+i, n-i, v);
+    }
+
+    static void copy(T* dst, T const* src, std::size_t n)
+    {
+      std::size_t i = 0;
+      for (; i + 2*W <= n; i += 2*W)
+      {
+        V const a = M::load(src+i);
+        V const b = M::load(src+i+W);
+        M::store(dst+i, a);
+        M::store(dst+i+W, b);
+      }
+      Scalar::copy(dst+i, src+i, n-i);
+    }
+
+    static void axpy(T* y, T const& a, T const* x, std::size_t n)
+    {
+      V const va = P::set1(a);
+      std::size_t i = 0;
+      for (; i + W <= n; i += W)
+        M::store(y+i, P::fmadd(va, M::load(x+i), M::load(y+i)));
+      Scalar::axpy(y+i, a, x+i, n-i);
+    }
+
+    static void scale(T* x, T const& a, std::size_t n)
+    {
+      V const va = P::set1(a);
+      std::size_t i = 0;
+      for (; i + W <= n; i += W)
+        M::store(x+i, P::mul(va, M::load(x+i)));
+      Scalar::scale(x+i, a, n-i);
+    }
+
+    static T sum(T const* x, std::size_t n)
+    {
+      V s0 = P::set1(T()), s1 = s0;
+      std::size_t i = 0;
+      for (; i + 2*W <= n; i += 2*W)
+      {
+        s0 = P::add(s0, M::load(x+i));
+        s1 = P::add(s1, M::load(x+i+W));
+      }
+      return P::hsum(P::add(s0, s1)) + Scalar::sum(x+i, n-i);
+    }
+
+    static T min(T const* x, std::size_t n)
+    {
+      if (n < W)
+        return Scalar::min(x, n);
+      V m = M::load(x);
+      std::size_t i = W;
+      for (; i + W <= n; i += W)
+        m = P::min(m, M::load(x+i));
+      T const r = P::hmin(m);
+      return i < n ? std::min(r, Scalar::min(x+i, n-i)) : r;
+    }
+
+    static T max(T const* x, std::size_t n)
+    {
+      if (n < W)
+        return Scalar::max(x, n);
+      V m = M::load(x);
+      std::size_t i = W;
+      for (; i + W <= n; i += W)
+        m = P::max(m, M::load(x+i));
+      T const r = P::hmax(m);
+      return i < n ? std::max(r, Scalar::max(x+i, n-i)) : r;
+    }
+
+    static T dot(T const* x, T const* y, std::size_t n)
+    {
+      V s0 = P::set1(T()), s1 = s0;
+      std::size_t i = 0;
+      for (; i + 2*W <= n; i += 2*W)
+      {
+        s0 = P::fmadd(M::load(x+i), M::load(y+i), s0);
+        s1 = P::fmadd(M::load(x+i+W), M::load(y+i+W), s1);
+      }
+      return P::hsum(P::add(s0, s1)) + Scalar::dot(x+i, y+i, n-i);
+    }
+
+    // |x| = max(x, -x)
+    static T asum(T const* x, std::size_t n)
+    {
+      V const m1 = P::set1(T(-1));
+      V s0 = P::set1(T()), s1 = s0;
+      std::size_t i = 0;
+      for (; i + 2*W <= n; i += 2*W)
+      {
+        V const a = M::load(x+i);
+        V const b = M::load(x+i+W);
+        s0 = P::add(s0, P::max(a, P::mul(a, m1)));
+        s1 = P::add(s1, P::max(b, P::mul(b, m1)));
+      }
+      return P::hsum(P::add(s0, s1)) + Scalar::asum(x+i, n-i);
+    }
+
+    static void addInPlace(T* y, T const* x, std::size_t n)
+    {
+      std::size_t i = 0;
+      for (; i + W <= n; i += W)
+        M::store(y+i, P::add(M::load(y+i), M::load(x+i)));
+      Scalar::addInPlace(y+i, x+i, n-i);
+    }
+
+    static void minInPlace(T* y, T const* x, std::size_t n)
+    {
+      std::size_t i = 0;
+      for (; i + W <= n; i += W)
+        M::store(y+i, P::min(M::load(y+i), M::load(x+i)));
+      Scalar::minInPlace(y+i, x+i, n-i);
+    }
+
+    static void maxInPlace(T* y, T const* x, std::size_t n)
+    {
+      std::size_t i = 0;
+      for (; i + W <= n; i += W)
+        M::store(y+i, P::max(M::load(y+i), M::load(x+i)));
+      Scalar::maxInPlace(y+i, x+i, n-i);
+    }
+  };
+
+} // end simd
+} // end internal
+
+} // end namespace
+
+#endif
@@ -0,0 +1,466 @@
+// This file is part of generic_array, A lightweight generic
+// N-dimensional array library
+//
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef MA_SPARSE_HPP
+#define MA_SPARSE_HPP
+
+#include "array.hpp"
+
+// Sparse arrays: only the nonzero elements are stored, in an open
+// addressing hash table (linear probing) keyed by the position of the
+// element in major order, so the memory is proportional to the number of
+// nonzeros, about (sizeof(size_t) + sizeof(T)) / 0.5 bytes each.
+
+namespace marray {
+
+template<typename P_type, int P_rank, Options P_opts>
+class SparseArray;
+
+namespace internal
+{
+  // reference to an element of a sparse array: reading it looks the
+  // element up, assigning it stores it (or erases it when zero)
+  template<class S>
+  class SparseRef
+  {
+    typedef typename S::UserT     UserT;
+    typedef typename S::size_type size_type;
+
+    S*        m_s;
+    size_type m_i;
+
+  public:
+    SparseRef(S& s, size_type i) : m_s(&s), m_i(i)
+    { }
+
+    operator UserT() const
+    { return m_s->get(m_i); }
+
+    SparseRef& operator=(UserT const& v)
+    {
+      m_s->put(m_i, v);
+      return *this;
+    }
+
+    SparseRef& operator=(SparseRef const& r)
+    { return *this = UserT(r); }
+
+    SparseRef& operator+=(UserT const& v) { return *this = UserT(*this) + v; }
+    SparseRef& operator-=(UserT const& v) { return *this = UserT(*this) - v; }
+    SparseRef& operator*=(UserT const& v) { return *this = UserT(*this) * v; }
+    SparseRef& operator/=(UserT const& v) { return *this = UserT(*this) / v; }
+  };
+
+  inline std::size_t hashPosition(std::size_t k)
+  {
+    k ^= k >> 16;
+    k *= 0x45d9f3bUL;
+    k ^= k >> 16;
+    return k;
+  }
+}
+
+
+// An N-D array that stores only its nonzero elements (the elements
+// different from `T()`), e.g.
+//
+//    SparseArray<float, 4> S(n,n,n,n);
+//    S(1,2,3,4) = 1.f;           // stored
+//    S(1,2,3,4) = 0.f;           // erased
+//    Array<float, 4> A = S;      // dense copy; the zeros are filled in
+//    SparseArray<float, 4> T = A;
+//
+// It has the interface of ArrayBase, with `operator()` returning a proxy
+// (`internal::SparseRef`) for writable access and a value for const
+// access. It also takes part in expressions (`A = S + B`), but has no
+// `data()`, and thus no views nor slices.
+template<typename P_type, int P_rank, Options P_opts = MA_DEFAULT_MAJOR>
+class SparseArray : public ArrayBase<SparseArray<P_type, P_rank, P_opts>, P_rank, P_opts>
+{
+  typedef ArrayBase<SparseArray, P_rank, P_opts> Base;
+
+  friend class ArrayBase<SparseArray, P_rank, P_opts>;
+  friend class internal::SparseRef<SparseArray>;
+
+  enum { DummyLayout = sizeof(internal::ERROR_LAYOUT_IS_NOT_SUPPORTED_BY_THIS_CLASS<P_opts>) };
+
+public:
+
+  typedef typename Base::reference        reference;
+  typedef typename Base::const_reference  const_reference;
+  typedef typename Base::iterator         iterator;
+  typedef typename Base::const_iterator   const_iterator;
+  typedef typename Base::size_type        size_type;
+  typedef typename Base::difference_type  difference_type;
+  typedef typename Base::pointer          pointer;
+  typedef typename Base::const_pointer    const_pointer;
+
+  typedef P_type UserT;
+  static const int Rank = P_rank;
+  static const bool isRowMajor = P_opts & RowMajor;
+  static const Options Opts = P_opts;
+
+  SparseArray() : m_rdims(), m_strides(), m_size(0), m_count(0)
+  { }
+
+  template<class T>
+  SparseArray(T const new_dims[]) : m_rdims(), m_strides(), m_size(0), m_count(0)
+  { reshape(new_dims); }
+
+  // the nonzeros of an array or expression, e.g. `SparseArray<double,3> S = A;`
+  template<class E>
+  SparseArray(internal::ExprBase<E> const& e) : m_rdims(), m_strides(), m_size(0), m_count(0)
+  { *this = e; }
+
+  template<class E>
+  SparseArray& operator=(internal::ExprBase<E> const& e)
+  {
+    typedef typename internal::ExprLeaf<E>::type Expr;
+    MA_STATIC_CHECK(Expr::Rank == Rank, INVALID_RANK_IN_EXPRESSION_ASSIGNMENT);
+    Expr const x(e.derived());
+    size_type new_dims[Rank];
+    for (int i = 0; i < Rank; ++i)
+      new_dims[i] = x.dim(i);
+
+    SparseArray s(new_dims);            // `e` may refer to *this
+    UserT const zero = UserT();
+    if (x.isLinear(isRowMajor))
+    {
+      for (size_type i = 0; i < s.m_size; ++i)
+      {
+        UserT const v = x.linear(i);
+        if (v != zero)
+          s.insert(i, v);
+      }
+    }
+    else
+    {
+      size_type idx[Rank] = {};
+      for (size_type i = 0; i < s.m_size; ++i)
+      {
+        UserT const v = x(idx);
+        if (v != zero)
+          s.insert(i, v);
+        internal::nextIndex<Rank>(idx, s.m_rdims, isRowMajor);
+      }
+    }
+    swap(s);
+    return *this;
+  }
+
+#if __cplusplus >= 201103L
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  SparseArray(D... dims) : m_rdims(), m_strides(), m_size(0), m_count(0)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape(new_dims);
+  }
+
+  template<class... D, class = typename internal::IfIndices<D...>::type>
+  void reshape(D... dims)
+  {
+    MA_STATIC_CHECK(sizeof...(D) == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);
+    size_type const new_dims[] = { size_type(dims)... };
+    reshape(new_dims);
+  }
+#else
+#define MA_IMPLEMENT_FUN(n_args)                                                                       \
+  SparseArray(MA_EXPAND_ARGS(n_args, size_type))                                                       \
+    : m_rdims(), m_strides(), m_size(0), m_count(0)                                                    \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_CONSTRUCTOR);                                 \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    reshape(new_dims);                                                                                 \
+  }                                                                                                    \
+                                                                                                       \
+  void reshape(MA_EXPAND_ARGS(n_args, size_type))                                                      \
+  {                                                                                                    \
+    MA_STATIC_CHECK(n_args == Rank, TOO_FEW_ARGUMENTS_IN_RESHAPE);                                     \
+    size_type const new_dims[] = { MA_EXPAND_SEQ(n_args) };                                            \
+    reshape(new_dims);                                                                                 \
+  }
+
+  MA_IMPLEMENT_FUN( 1)
+  MA_IMPLEMENT_FUN( 2)
+  MA_IMPLEMENT_FUN( 3)
+  MA_IMPLEMENT_FUN( 4)
+  MA_IMPLEMENT_FUN( 5)
+  MA_IMPLEMENT_FUN( 6)
+  MA_IMPLEMENT_FUN( 7)
+  MA_IMPLEMENT_FUN( 8)
+  MA_IMPLEMENT_FUN( 9)
+  MA_IMPLEMENT_FUN(10)
+#undef MA_IMPLEMENT_FUN
+#endif
+
+  // sets the dimensions; all the elements become zero
+  template<class T>
+  void reshape(T const new_dims[])
+  {
+    m_size = 1;
+    for (int i = 0; i < Rank; ++i)
+    {
+      internal::assertTrue(new_dims[i] > 0, "**ERROR**: SparseArray<>: dimension must be greater than 0");
+      m_rdims[i] = new_dims[i];
+      m_size *= new_dims[i];
+    }
+    typedef typename internal::IdxComputationTraits<Rank, isRowMajor>::StrideComputer StrideComputer;
+    StrideComputer::compute(m_rdims, m_strides);
+    clear();
+  }
+
+  int rank() const
+  { return Rank; }
+
+  size_type dim(size_type r) const
+  {
+    internal::assertTrue(r < (size_type)Rank, "**ERROR**: SparseArray<>: invalid index in function `dim()`");
+    return m_rdims[r];
+  }
+
+  // number of elements, zeros included
+  size_type size() const
+  { return m_size; }
+
+  // number of stored (nonzero) elements
+  size_type nnz() const
+  { return m_count; }
+
+  // all the elements become zero
+  void clear()
+  {
+    m_keys.clear();
+    m_vals.clear();
+    m_count = 0;
+  }
+
+  // makes room for `n` nonzeros
+  void reserve(size_type n)
+  {
+    size_type cap = 16;
+    while (4*n > 3*cap)
+      cap *= 2;
+    if (cap > m_keys.size())
+      rehash(cap);
+  }
+
+  inline
+  reference access(size_type i)
+  {
+    internal::assertLess(i, m_size, "**ERROR**: SparseArray<>: invalid index in function `access()`");
+    return reference(*this, i);
+  }
+
+  inline
+  const_reference access(size_type i) const
+  {
+    internal::assertLess(i, m_size, "**ERROR**: SparseArray<>: invalid index in function `access()`");
+    return get(i);
+  }
+
+  // f(idx, x) for every nonzero x, at the multi-index `idx` (a
+  // `size_type const*`), in no particular order; returns `f`
+  template<class F>
+  F for_each_nonzero(F f) const
+  {
+    size_type idx[Rank];
+    for (size_type s = 0; s < m_keys.size(); ++s)
+      if (m_keys[s] != empty())
+      {
+        toIndex(m_keys[s], idx);
+        f(static_cast<size_type const*>(idx), static_cast<UserT const&>(m_vals[s]));
+      }
+    return f;
+  }
+
+  void swap(SparseArray& x)
+  {
+    for (int i = 0; i < Rank; ++i)
+    {
+      std::swap(m_rdims[i], x.m_rdims[i]);
+      std::swap(m_strides[i], x.m_strides[i]);
+    }
+    std::swap(m_size, x.m_size);
+    std::swap(m_count, x.m_count);
+    m_keys.swap(x.m_keys);
+    m_vals.swap(x.m_vals);
+  }
+
+  // dst = *this, scattering the nonzeros over zeros (see internal::ArrayCopy)
+  template<class D, int R, Options O>
+  void scatterTo(ArrayBase<D,R,O>& dst) const
+  {
+    D& a = static_cast<D&>(dst);
+    for (int i = 0; i < Rank; ++i)
+      internal::assertTrue(a.dim(i) == m_rdims[i], "**ERROR**: SparseArray<>: incompatible shapes in assignment");
+    fill(dst, UserT());
+
+    bool const linear = internal::HasLinearAccess<D>::value && D::isRowMajor == isRowMajor;
+    size_type idx[Rank];
+    for (size_type s = 0; s < m_keys.size(); ++s)
+      if (m_keys[s] != empty())
+      {
+        if (linear)
+          a.access(m_keys[s]) = m_vals[s];
+        else
+        {
+          toIndex(m_keys[s], idx);
+          a(idx) = m_vals[s];
+        }
+      }
+  }
+
+protected:
+  size_type const* rdims() const
+  { return m_rdims; }
+
+  difference_type const* rstrides() const
+  { return m_strides; }
+
+private:
+  static size_type empty()
+  { return size_type(-1); }
+
+  // slot of the position `k`, or of the empty slot where it would go
+  size_type slot(size_type k) const
+  {
+    size_type const mask = m_keys.size() - 1;
+    size_type s = internal::hashPosition(k) & mask;
+    while (m_keys[s] != k && m_keys[s] != empty())
+      s = (s + 1) & mask;
+    return s;
+  }
+
+  UserT get(size_type k) const
+  {
+    if (m_count == 0)
+      return UserT();
+    size_type const s = slot(k);
+    return m_keys[s] == k ? UserT(m_vals[s]) : UserT();
+  }
+
+  void put(size_type k, UserT const& v)
+  {
+    if (v == UserT())
+      erase(k);
+    else
+      insert(k, v);
+  }
+
+  void insert(size_type k, UserT const& v)
+  {
+    if (4*(m_count + 1) > 3*m_keys.size())
+      rehash(m_keys.empty() ? 16 : 2*m_keys.size());
+    size_type const s = slot(k);
+    if (m_keys[s] == empty())
+    {
+      m_keys[s] = k;
+      ++m_count;
+    }
+    m_vals[s] = v;
+  }
+
+  // removes `k`, shifting back the entries of its probe sequence
+  void erase(size_type k)
+  {
+    if (m_count == 0)
+      return;
+    size_type i = slot(k);
+    if (m_keys[i] == empty())
+      return;
+    size_type const mask = m_keys.size() - 1;
+    for (size_type j = (i + 1) & mask; m_keys[j] != empty(); j = (j + 1) & mask)
+    {
+      size_type const h = internal::hashPosition(m_keys[j]) & mask;
+      // move j to i unless its home slot h lies cyclically in (i, j]
+      if (i <= j ? (h <= i || h > j) : (h <= i && h > j))
+      {
+        m_keys[i] = m_keys[j];
+        m_vals[i] = m_vals[j];
+        i = j;
+      }
+    }
+    m_keys[i] = empty();
+    m_vals[i] = UserT();
+    --m_count;
+  }
+
+  void rehash(size_type cap)
+  {
+    std::vector<size_type> keys(cap, empty());
+    std::vector<UserT>     vals(cap);
+    keys.swap(m_keys);
+    vals.swap(m_vals);
+    for (size_type s = 0; s < keys.size(); ++s)
+      if (keys[s] != empty())
+      {
+        size_type const t = slot(keys[s]);
+        m_keys[t] = keys[s];
+        m_vals[t] = vals[s];
+      }
+  }
+
+  // multi-index of the position `k` in major order
+  void toIndex(size_type k, size_type idx[]) const
+  {
+    for (int j = 0; j < Rank; ++j)
+    {
+      int const r = isRowMajor ? Rank-1-j : j;
+      idx[r] = k % m_rdims[r];
+      k /= m_rdims[r];
+    }
+  }
+
+  size_type       m_rdims[Rank];
+  difference_type m_strides[Rank];
+  size_type       m_size;
+  size_type       m_count;
+
+  std::vector<size_type> m_keys;    // positions, or empty()
+  std::vector<UserT>     m_vals;
+};
+
+
+// f(idx, x) for every nonzero x of `S`, in no particular order; returns `f`
+template<class T, int Rank, Options Opts, class F>
+F for_each_nonzero(SparseArray<T,Rank,Opts> const& S, F f)
+{ return S.for_each_nonzero(f); }
+
+
+namespace internal
+{
+  template<class T, int R, Options O>
+  struct Traits<SparseArray<T,R,O> > {
+    typedef T UserT;
+
+    typedef  SparseRef<SparseArray<T,R,O> >       reference;
+    typedef  UserT                                const_reference;
+    typedef  NdIterator<SparseArray<T,R,O> >       iterator;
+    typedef  NdIterator<SparseArray<T,R,O> const>  const_iterator;
+    typedef  std::size_t     size_type;
+    typedef  std::ptrdiff_t  difference_type;
+    typedef  UserT*          pointer;
+    typedef  UserT const*    const_pointer;
+  };
+
+  // dense = sparse: fill with zeros and scatter the nonzeros
+  template<class T, int R, Options O>
+  struct ArrayCopy<ArrayBase<SparseArray<T,R,O>,R,O> >
+  {
+    template<class D1, int R1, Options O1>
+    static bool run(ArrayBase<D1,R1,O1>& dst, ArrayBase<SparseArray<T,R,O>,R,O> const& src)
+    {
+      static_cast<SparseArray<T,R,O> const&>(src).scatterTo(dst);
+      return true;
+    }
+  };
+}
+
+} // end namespace
+
+#endif
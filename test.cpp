@@ -3,9 +3,22 @@
 #include <cassert>
 
 #include <deque>
+#include <numeric>
+#include <sstream>
 
 #include <Array/array.hpp>
 
+// small grain, so that the test arrays are split among the workers
+#define MA_PARALLEL_GRAIN 64
+#include <Array/parallel.hpp>
+#include <Array/scheduler.hpp>
+#include <Array/reduce.hpp>
+#include <Array/io.hpp>
+#include <Array/mapped.hpp>
+#include <Array/npy.hpp>
+#include <Array/chunked.hpp>
+#include <Array/sparse.hpp>
+
 using namespace std;
 using namespace marray;
 
@@ -836,6 +849,1706 @@ void test_iterators()
   //Array<Index, 3, RowMajor, Index[3]> A;
 }
 
+template<Options Mj, class S>
+void test_HighRank()
+{
+  Array<Index, 6, Mj, S> A(2,3,4,3,2,3);
+
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  Index const n[] = {A.dim(0), A.dim(1), A.dim(2), A.dim(3), A.dim(4), A.dim(5)};
+  for (Index i0 = 0; i0 < n[0]; ++i0)
+    for (Index i1 = 0; i1 < n[1]; ++i1)
+      for (Index i2 = 0; i2 < n[2]; ++i2)
+        for (Index i3 = 0; i3 < n[3]; ++i3)
+          for (Index i4 = 0; i4 < n[4]; ++i4)
+            for (Index i5 = 0; i5 < n[5]; ++i5)
+            {
+              Index const idx = Mj == RowMajor
+                              ? i5 + n[5]*(i4 + n[4]*(i3 + n[3]*(i2 + n[2]*(i1 + n[1]*i0))))
+                              : i0 + n[0]*(i1 + n[1]*(i2 + n[2]*(i3 + n[3]*(i4 + n[4]*i5))));
+              assert( A(i0,i1,i2,i3,i4,i5) == idx );
+              assert( A[i0][i1][i2][i3][i4][i5] == idx );
+            }
+
+  // strides must follow a reshape
+  A.reshape(3,2,3,2,4,3);
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+  Index const m[] = {3,2,3,2,4,3};
+  Index const idx = Mj == RowMajor
+                  ? 2 + m[5]*(3 + m[4]*(1 + m[3]*(2 + m[2]*(1 + m[1]*2))))
+                  : 2 + m[0]*(1 + m[1]*(2 + m[2]*(1 + m[3]*(3 + m[4]*2))));
+  assert( A(2,1,2,1,3,2) == idx );
+}
+
+void test_ArrayView()
+{
+  printf("test_ArrayView() ... ");
+
+  Array<double, 3> B(2,3,4);
+
+  B << 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23;
+
+  // whole array
+  ArrayView<double, 3> V = B.view();
+  assert(V.size() == 24);
+  assert(V.isContiguous());
+  for (Index i = 0; i < B.dim(0); ++i)
+    for (Index j = 0; j < B.dim(1); ++j)
+      for (Index k = 0; k < B.dim(2); ++k)
+      {
+        assert( V(i,j,k) == B(i,j,k) );
+        assert( V[i][j][k] == B(i,j,k) );
+      }
+
+  // sub-block B(1, 1:3, 1:3)
+  {
+    Index const dims[] = {2, 2};
+    std::ptrdiff_t const strides[] = {4, 1};
+    ArrayView<double, 2> S(&B(1,1,1), dims, strides);
+    assert(S.size() == 4);
+    assert(!S.isContiguous());
+    for (Index j = 0; j < 2; ++j)
+      for (Index k = 0; k < 2; ++k)
+        assert( S(j,k) == B(1,j+1,k+1) );
+    S(1,1) = -1;
+    assert( B(1,2,2) == -1 );
+    B(1,2,2) = 22;
+  }
+
+  // transposes and reversed axes
+  {
+    ArrayView<double, 3> T = V.transposed(0,2);
+    assert(T.dim(0) == 4 && T.dim(1) == 3 && T.dim(2) == 2);
+    Index const perm[] = {1, 2, 0};
+    ArrayView<double, 3> P = V.permuted(perm);
+    assert(P.dim(0) == 3 && P.dim(1) == 4 && P.dim(2) == 2);
+    ArrayView<double, 3> R = V.reversed(1);
+    ArrayView<double const, 3> C = R;
+    for (Index i = 0; i < B.dim(0); ++i)
+      for (Index j = 0; j < B.dim(1); ++j)
+        for (Index k = 0; k < B.dim(2); ++k)
+        {
+          assert( T(k,j,i) == B(i,j,k) );
+          assert( P(j,k,i) == B(i,j,k) );
+          assert( R(i,2-j,k) == B(i,j,k) );
+          assert( C(i,2-j,k) == B(i,j,k) );
+        }
+  }
+
+  // interleaved buffer: real and imaginary parts
+  {
+    double buf[] = {0,10, 1,11, 2,12, 3,13, 4,14, 5,15};
+    Index const dims[] = {3, 2};
+    std::ptrdiff_t const strides[] = {4, 2};
+    ArrayView<double, 2> Re(buf, dims, strides);
+    ArrayView<double, 2> Im(buf+1, dims, strides);
+    for (Index i = 0; i < 3; ++i)
+      for (Index j = 0; j < 2; ++j)
+      {
+        assert( Re(i,j) == 2*i+j );
+        assert( Im(i,j) == 2*i+j+10 );
+      }
+  }
+
+  // ColMajor dense view from a constant array
+  {
+    Array<double, 2, ColMajor, double[6]> const A = Array<double, 2, ColMajor, double[6]>(2,3);
+    ArrayView<double const, 2, ColMajor> W = A.view();
+    assert(W.isContiguous());
+    assert(W.stride(0) == 1 && W.stride(1) == 2);
+  }
+}
+
+template<Options Mj, class S>
+void test_Slice()
+{
+  Array<double, 4, Mj, S> A(3,4,5,6);
+
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  // a 2-D plane of a 4-D array
+  ArrayView<double, 2, Mj> P = A.slice(1, range(), 2, range());
+  assert(P.dim(0) == 4 && P.dim(1) == 6);
+  for (Index j = 0; j < P.dim(0); ++j)
+    for (Index l = 0; l < P.dim(1); ++l)
+      assert( P(j,l) == A(1,j,2,l) );
+
+  // ranges with steps
+  ArrayView<double, 3, Mj> Q = A.slice(range(1,3), 3, range(0,5,2), range(1,6,3));
+  assert(Q.dim(0) == 2 && Q.dim(1) == 3 && Q.dim(2) == 2);
+  for (Index i = 0; i < Q.dim(0); ++i)
+    for (Index k = 0; k < Q.dim(1); ++k)
+      for (Index l = 0; l < Q.dim(2); ++l)
+        assert( Q(i,k,l) == A(1+i,3,2*k,1+3*l) );
+
+  // aliases the parent storage
+  Q(1,2,1) = -1;
+  assert( A(2,3,4,4) == -1 );
+
+  // slicing a view and a constant array
+  ArrayView<double, 1, Mj> R = Q.slice(1, range(), 1);
+  assert(R.dim(0) == 3 && R(2) == -1);
+
+  Array<double, 4, Mj, S> const& C = A;
+  ArrayView<double const, 1, Mj> L = C.slice(0, 0, 0, range(0,6,5));
+  assert(L.dim(0) == 2 && L(1) == A(0,0,0,5));
+
+  Amaps<double, 2, Mj> M(A.data(), 12, 30);
+  ArrayView<double, 1, Mj> Col = M.slice(range(), 7);
+  for (Index i = 0; i < 12; ++i)
+    assert( Col(i) == M(i,7) );
+
+#ifdef DEBUG
+  try {
+    A.slice(range(0,4), 0, 0, 0);
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+#endif
+}
+
+template<class S>
+void test_Expressions()
+{
+  Array<double, 3, RowMajor, S> A(2,3,4), B(2,3,4);
+
+  for (Index i = 0; i < A.size(); ++i)
+  {
+    A.access(i) = i;
+    B.access(i) = 100 + i;
+  }
+
+  double const a = 2;
+
+  // fused, single pass
+  Array<double, 3, RowMajor, S> C = a*A + B;
+  assert(C.dim(0) == 2 && C.dim(1) == 3 && C.dim(2) == 4);
+  for (Index i = 0; i < C.size(); ++i)
+    assert( C.access(i) == 2*i + 100 + i );
+
+  C = (A - B)/a - 1.0*(-A) + 3.0;
+  for (Index i = 0; i < C.size(); ++i)
+    assert( C.access(i) == (double(i) - (100. + i))/2 + i + 3 );
+
+  C -= A;
+  C *= 2.0;
+  C += A*B;
+  for (Index i = 0; i < C.size(); ++i)
+    assert( C.access(i) == 2*((double(i) - (100. + i))/2 + 3) + double(i)*(100. + i) );
+
+  // different major orders: evaluated through the multi-index
+  Array<double, 3, ColMajor> D(2,3,4);
+  for (Index i = 0; i < D.size(); ++i)
+    D.access(i) = i;
+  Array<double, 3, ColMajor> E = A + D;
+  for (Index i = 0; i < 2; ++i)
+    for (Index j = 0; j < 3; ++j)
+      for (Index k = 0; k < 4; ++k)
+        assert( E(i,j,k) == A(i,j,k) + D(i,j,k) );
+
+  // views and maps on both sides
+  Array<double, 2, RowMajor, S> P(3,4);
+  P = A.slice(1, range(), range()) - 10.0*B.slice(0, range(), range());
+  for (Index j = 0; j < 3; ++j)
+    for (Index k = 0; k < 4; ++k)
+      assert( P(j,k) == A(1,j,k) - 10*B(0,j,k) );
+
+  Amaps<double, 2> M(C.data(), 6, 4);
+  double const c = C(1,2,3);
+  M = 1.0 - M;
+  assert( C(1,2,3) == 1 - c );
+  Array<double, 2> F(6,4);
+  F = Amaps<double, 2>(B.data(), 6, 4).view().reversed(0) * 0.5;
+  assert( F(0,0) == B(1,2,0)/2 );
+
+  A.slice(range(), range(0,3,2), 1) = C.slice(range(), 0, range(1,4,2)) / a;
+  assert( A(1,2,1) == C(1,0,3)/2 );
+
+#ifdef DEBUG
+  try {
+    A += Array<double, 3, RowMajor, S>(2,4,3);
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+#endif
+}
+
+template<class S>
+void test_Layout()
+{
+  // larger than one tile in both fast ranks, not a multiple of it
+  Array<double, 3, RowMajor, S> A(3,37,45);
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  Array<double, 3, ColMajor> C(A);
+  assert(C.dim(0) == 3 && C.dim(1) == 37 && C.dim(2) == 45);
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 37; ++j)
+      for (Index k = 0; k < 45; ++k)
+        assert( C(i,j,k) == A(i,j,k) );
+
+  Array<double, 3, RowMajor, S> B(3,37,45);
+  B = C;
+  for (Index i = 0; i < B.size(); ++i)
+    assert( B.access(i) == i );
+
+  // Fortran-ordered buffer
+  std::vector<double> buf(A.size());
+  Amaps<double, 3, ColMajor> F(&buf[0], 3,37,45);
+  F = A;
+  assert( buf[1] == A(1,0,0) && buf[3] == A(0,1,0) );
+
+  // permutation of the ranks: P(k,i,j) = A(i,j,k)
+  Array<double, 3, ColMajor> P(45,3,37);
+  int const perm[] = {2,0,1};
+  permute(A, perm, P);
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 37; ++j)
+      for (Index k = 0; k < 45; ++k)
+        assert( P(k,i,j) == A(i,j,k) );
+
+  // non-contiguous views and non-strided storage
+  Array<double, 2> T2(45,37);
+  T2 = A.slice(2, range(), range()).transposed(0,1);
+  for (Index j = 0; j < 37; ++j)
+    for (Index k = 0; k < 45; ++k)
+      assert( T2(k,j) == A(2,j,k) );
+
+  Array<double, 3, ColMajor, std::deque<double> > Q(45,3,37);
+  permute(A, perm, Q);
+  for (Index i = 0; i < Q.size(); ++i)
+    assert( Q.access(i) == P.access(i) );
+
+#ifdef DEBUG
+  try {
+    permute(A, perm, B);
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+
+  // repeated and negative ranks
+  int const bad[][3] = {{0,0,2}, {-1,0,1}};
+  Array<double, 3, ColMajor> Z(3,3,45);
+  for (int c = 0; c < 2; ++c)
+    try {
+      permute(A, bad[c], Z);
+      printf("error ...\n");
+      throw;
+    }
+    catch (std::out_of_range&)
+    { }
+#endif
+}
+
+void test_AlignedBlock()
+{
+  typedef Array<double, 3, RowMajor, AlignedBlock<double> > ArrayA;
+
+  ArrayA A(3,5,7);
+  assert( (reinterpret_cast<std::size_t>(A.data()) % 64) == 0 );
+  for (Index i = 0; i < A.size(); ++i)
+    assert( A.access(i) == 0 );
+
+  A.reshape(4,5,7);
+  assert( (reinterpret_cast<std::size_t>(A.data()) % 64) == 0 );
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  ArrayA B(A);
+  assert( B.data() != A.data() && (reinterpret_cast<std::size_t>(B.data()) % 64) == 0 );
+  for (Index i = 0; i < B.size(); ++i)
+    assert( B.access(i) == i );
+
+  B.clear();
+  assert( B.size() == 0 );
+  B = A;
+  assert( B.size() == A.size() && B(3,4,6) == A(3,4,6) );
+
+  // mixing aligned and unaligned storage
+  Array<double, 3> C(4,5,7);
+  copy(A, C);
+  axpy(2.0, C, A);
+  for (Index i = 0; i < A.size(); ++i)
+    assert( A.access(i) == 3*C.access(i) );
+  assert( dot(A, C) == 3*dot(C, C) );
+
+  // other alignments, large blocks
+  Array<float, 2, RowMajor, AlignedBlock<float, 128> > F(1024, 1100);
+  assert( (reinterpret_cast<std::size_t>(F.data()) % 128) == 0 );
+  fill(F, 1.f);
+  assert( sum(F) == 1024*1100 );
+
+  AlignedBlock<int> v(3, 7);
+  try {
+    v.at(3) = 1;
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+}
+
+template<class S>
+void test_Uninitialized()
+{
+  Array<double, 3, RowMajor, S> A(uninitialized, 2,3,4);
+  assert( A.dim(0) == 2 && A.dim(1) == 3 && A.dim(2) == 4 && A.size() == 24 );
+  assert( &A(1,0,0) - &A(0,0,0) == 12 && &A(0,0,1) - &A(0,0,0) == 1 );
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  // shrinking keeps the leading elements
+  A.reshape_uninitialized(2,3,2);
+  assert( A.size() == 12 && A.access(11) == 11 );
+
+  Index const dims[] = {4,6};
+  Array<double, 2, ColMajor, S> B(uninitialized, dims);
+  assert( B.dim(0) == 4 && B.dim(1) == 6 && &B(0,1) - &B(0,0) == 4 );
+  B.reshape_uninitialized(dims);
+  fill(B, 1.);
+  assert( sum(B) == 24 );
+
+  // assigning an expression does not initialize the elements first
+  Array<double, 3, RowMajor, S> C = A + A;
+  assert( C.size() == 12 && C.access(11) == 22 );
+}
+
+void test_DefaultInitAllocator()
+{
+  typedef std::vector<double, default_init_allocator<double> > Block;
+
+  // the plain constructors and reshapes still value-initialize
+  Array<double, 2, RowMajor, Block> A(3,4);
+  assert( sum(A) == 0 );
+  fill(A, 7.);
+  A.reshape(2,4);
+  A.reshape(3,4);
+  assert( A(2,3) == 0 );
+
+  fill(A, 7.);
+  A.reshape_uninitialized(2,4);
+  A.reshape_uninitialized(3,4);
+#if __cplusplus >= 201103L
+  assert( A(2,3) == 7 );  // regrown in place, not written
+#endif
+  assert( A.size() == 12 && A(1,3) == 7 );
+}
+
+template<Options Mj, class S>
+void test_ResizePreserve()
+{
+  Array<int, 3, Mj, S> A(2,3,4);
+  for (Index i = 0; i < 2; ++i)
+    for (Index j = 0; j < 3; ++j)
+      for (Index k = 0; k < 4; ++k)
+        A(i,j,k) = 100*i + 10*j + k + 1;
+
+  // grow every rank
+  A.resize_preserve(3,5,6);
+  assert( A.dim(0) == 3 && A.dim(1) == 5 && A.dim(2) == 6 );
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 5; ++j)
+      for (Index k = 0; k < 6; ++k)
+        assert( A(i,j,k) == (i < 2 && j < 3 && k < 4 ? int(100*i + 10*j + k + 1) : 0) );
+
+  // shrink one rank, grow another
+  A.resize_preserve(3,2,7);
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 2; ++j)
+      for (Index k = 0; k < 7; ++k)
+        assert( A(i,j,k) == (i < 2 && k < 4 ? int(100*i + 10*j + k + 1) : 0) );
+
+  // only the slowest rank: no element moves
+  Index const slow = Mj == RowMajor ? 0 : 2;
+  Index dims[] = {3,2,7};
+  dims[slow] += 2;
+  A.resize_preserve(dims);
+  assert( A.dim(slow) == dims[slow] );
+  for (Index i = 0; i < 2; ++i)
+    for (Index j = 0; j < 2; ++j)
+      for (Index k = 0; k < 4; ++k)
+        assert( A(i,j,k) == int(100*i + 10*j + k + 1) );
+
+  // shrink everything
+  A.resize_preserve(1,1,2);
+  assert( A.size() == 2 && A(0,0,0) == 1 && A(0,0,1) == 2 );
+}
+
+template<class S>
+Array<double, 2, RowMajor, S> makeArray(Index m, Index n)
+{
+  Array<double, 2, RowMajor, S> A(m,n);
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+  return A;
+}
+
+template<class S>
+void test_Swap()
+{
+  Array<double, 2, RowMajor, S> A = makeArray<S>(3,4), B = makeArray<S>(2,2);
+  B(1,1) = -1;
+
+  double const* pa = &A.access(0);
+  swap(A, B);
+  assert( A.dim(0) == 2 && A.dim(1) == 2 && A.size() == 4 && A(1,1) == -1 );
+  assert( B.dim(0) == 3 && B.dim(1) == 4 && B.size() == 12 && B(2,3) == 11 );
+  assert( internal::IsStaticArray<S>::value || &B.access(0) == pa );
+
+  A.swap(B);
+  assert( A.size() == 12 && A(2,3) == 11 && B(1,1) == -1 );
+  (void)pa;
+
+  Array<double, 2, RowMajor, S> C(B);
+  assert( C.size() == 4 && C(1,1) == -1 );
+  C = A;
+  assert( C.size() == 12 && C(2,3) == 11 );
+
+#if __cplusplus >= 201103L
+  double const* pc = &C.access(0);
+  Array<double, 2, RowMajor, S> D(std::move(C));
+  assert( D.size() == 12 && D(2,3) == 11 );
+  assert( C.size() == 0 && C.dim(0) == 0 );
+  assert( internal::IsStaticArray<S>::value || &D.access(0) == pc );
+  (void)pc;
+
+  C = std::move(D);
+  assert( C.size() == 12 && C(1,2) == 6 && D.size() == 0 );
+
+  std::vector<Array<double, 2, RowMajor, S> > v;
+  v.push_back(makeArray<S>(2,3));
+  v.push_back(makeArray<S>(3,2));
+  assert( v[0](1,2) == 5 && v[1](2,1) == 5 );
+#endif
+}
+
+struct CheckIndexed
+{
+  Index count;
+  CheckIndexed() : count(0) {}
+
+  template<class T>
+  void operator()(Index const idx[], T& x)
+  {
+    assert( x == T(100*idx[0] + 10*idx[1] + idx[2]) );
+    ++count;
+  }
+};
+
+template<Options Mj, class S>
+void test_NdIterator()
+{
+  Array<int, 3, Mj, S> A(2,3,4);
+  for (Index i = 0; i < 2; ++i)
+    for (Index j = 0; j < 3; ++j)
+      for (Index k = 0; k < 4; ++k)
+        A(i,j,k) = 100*i + 10*j + k;
+
+  // major order, with the index kept alongside
+  Index n = 0;
+  typedef typename Array<int, 3, Mj, S>::nd_iterator It;
+  for (It it = A.ndbegin(); it != A.ndend(); ++it, ++n)
+  {
+    assert( *it == A.access(n) );
+    assert( *it == A(it.index()) );
+  }
+  assert( n == 24 );
+
+  for (It it = A.ndbegin(); it != A.ndend(); ++it)
+    *it += 1000;
+  assert( A(1,2,3) == 1123 );
+  for (It it = A.ndbegin(); it != A.ndend(); ++it)
+    *it -= 1000;
+
+  Array<int, 3, Mj, S> const& C = A;
+  assert( for_each_indexed(C, CheckIndexed()).count == 24 );
+}
+
+void test_NdIteratorView()
+{
+  Array<double, 3> A(2,3,4);
+  for (Index i = 0; i < 2; ++i)
+    for (Index j = 0; j < 3; ++j)
+      for (Index k = 0; k < 4; ++k)
+        A(i,j,k) = 100*i + 10*j + k;
+
+  // strided views: reversed and transposed
+  ArrayView<double, 3> V = A.view().reversed(2).transposed(0,1);
+  assert( V.dim(0) == 3 && V.dim(1) == 2 && V.dim(2) == 4 );
+  Index n = 0;
+  for (ArrayView<double, 3>::iterator it = V.begin(); it != V.end(); ++it, ++n)
+  {
+    Index const* idx = it.index();
+    assert( *it == A(idx[1], idx[0], 3-idx[2]) );
+    assert( &*it == &V(idx) );
+  }
+  assert( n == 24 );
+  assert( std::accumulate(V.begin(), V.end(), 0.) == sum(A) );
+
+  ArrayView<double, 2> S = A.slice(range(), 1, range(0,4,2));
+  for (ArrayView<double, 2>::iterator it = S.begin(); it != S.end(); ++it)
+    *it = -1;
+  assert( A(0,1,0) == -1 && A(1,1,2) == -1 && A(1,1,1) == 111 );
+
+  // maps
+  std::vector<double> buf(A.begin(), A.end());
+  Amaps<double, 3> M(&buf[0], 2,3,4);
+  Amaps<double, 3>::const_nd_iterator it = static_cast<Amaps<double, 3> const&>(M).ndbegin();
+  for (Index i = 0; i < 5; ++i)
+    ++it;
+  assert( it.index(0) == 0 && it.index(1) == 1 && it.index(2) == 1 && *it == 11 );
+}
+
+template<Options Mj>
+void test_Proxy()
+{
+  Array<double, 4, Mj> A(2,3,4,5);
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  for (Index i = 0; i < 2; ++i)
+    for (Index j = 0; j < 3; ++j)
+      for (Index k = 0; k < 4; ++k)
+        for (Index l = 0; l < 5; ++l)
+          assert( &A[i][j][k][l] == &A(i,j,k,l) );
+
+  A[1][2][3][4] = -1;
+  assert( A(1,2,3,4) == -1 );
+
+  // strided views, with negative strides
+  ArrayView<double, 4, Mj> V = A.view().reversed(1);
+  assert( &V[0][0][1][2] == &A(0,2,1,2) );
+
+  Array<double, 4, Mj> const& C = A;
+  assert( C[1][1][1][1] == A(1,1,1,1) );
+
+#ifdef DEBUG
+  try {
+    A[1][3][0][0] = 1;
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+#endif
+}
+
+template<Options Mj>
+void test_FixedArray()
+{
+  typedef FixedArray<double, Extents<3,3,3,3>, Mj> Tensor;
+
+  assert( sizeof(Tensor) == 81*sizeof(double) );
+  assert( Tensor::Rank == 4 && Tensor::Size == 81 );
+
+  Tensor C(0.);
+  assert( C.rank() == 4 && C.dim(0) == 3 && C.dim(3) == 3 && C.size() == 81 );
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 3; ++j)
+      for (Index k = 0; k < 3; ++k)
+        for (Index l = 0; l < 3; ++l)
+          C(i,j,k,l) = (i == k && j == l) + 10*i;
+
+  // same layout as the dynamic array
+  Array<double, 4, Mj> A(3,3,3,3);
+  A = C;
+  for (Index i = 0; i < 81; ++i)
+    assert( A.access(i) == C.access(i) );
+  assert( &C[1][2][0][1] == &C(1,2,0,1) );
+
+  Tensor D = 2.*C - A;
+  assert( D(2,1,2,1) == C(2,1,2,1) && sum(D) == sum(C) );
+
+  FixedArray<int, Extents<2,3>, Mj> M;
+  M << 1, 2, 3,
+       4, 5, 6;
+  assert( M.dim(0) == 2 && M.dim(1) == 3 );
+  assert( Mj == RowMajor ? M(1,0) == 4 : M(1,0) == 2 );
+
+  ArrayView<int, 2, Mj> V = M.view().transposed(0,1);
+  assert( V(2,1) == M(1,2) );
+
+#ifdef DEBUG
+  try {
+    C(0,0,3,0) = 1;
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+#endif
+}
+
+#if __cplusplus >= 201103L
+// ranks above the 10 of the C++98 overloads
+template<Options Mj>
+void test_HighRank()
+{
+  typedef Array<int, 12, Mj> A12;
+
+  A12 A(2,1,2,1,2,1,2,1,2,1,2,3);
+  assert( A.rank() == 12 && A.size() == 192 );
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  Index const idx[] = {1,0,1,0,1,0,1,0,1,0,1,2};
+  int const l = Mj == RowMajor ? 191 : 1 + 2 + 4 + 8 + 16 + 32 + 64*2;
+  assert( A(1,0,1,0,1,0,1,0,1,0,1,2) == l && A(idx) == l );
+  assert( &A[1][0][1][0][1][0][1][0][1][0][1][2] == &A(idx) );
+  assert( A(0,0,0,0,0,0,0,0,0,0,1,1u) == (Mj == RowMajor ? 4 : 96) );
+
+  // the last two ranks of A, at the first index of the others
+  ArrayView<int, 2, Mj> V = A.slice(0,0,0,0,0,0,0,0,0,0,range(),range());
+  assert( V.dim(0) == 2 && V.dim(1) == 3 && &V(1,2) == &A(0,0,0,0,0,0,0,0,0,0,1,2) );
+
+  Index n = 0;
+  for (typename A12::nd_iterator it = A.ndbegin(); it != A.ndend(); ++it, ++n)
+    assert( *it == A(it.index()) );
+  assert( n == 192 );
+
+  A.resize_preserve(2,1,2,1,2,1,2,1,2,1,2,4);
+  assert( A.size() == 256 && A(idx) == l && A(1,0,1,0,1,0,1,0,1,0,1,3) == 0 );
+
+  std::vector<int> buf(2048);
+  std::iota(buf.begin(), buf.end(), 0);
+  Amaps<int, 11, Mj> M(&buf[0], 2,2,2,2,2,2,2,2,2,2,2);
+  assert( M.size() == 2048 && M(1,1,1,1,1,1,1,1,1,1,1) == 2047 );
+  assert( M(1,0,0,0,0,0,0,0,0,0,0) == (Mj == RowMajor ? 1024 : 1) );
+
+  Array<int, 11, Mj, int[2048]> S(2,2,2,2,2,2,2,2,2,2,2);
+  S = M + 1;
+  assert( S(1,1,1,1,1,1,1,1,1,1,1) == 2048 && sum(S) == 2048*2049/2 );
+
+#ifdef DEBUG
+  try {
+    A(0,0,0,0,0,0,0,0,0,0,2,0) = 1;
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::out_of_range&)
+  { }
+#endif
+}
+#endif
+
+struct AddOne
+{
+  template<class T>
+  void operator()(T& x) const { x += 1; }
+};
+
+struct Twice
+{
+  double operator()(double x) const { return 2*x; }
+};
+
+struct ThrowAt
+{
+  double v;
+  ThrowAt(double v_) : v(v_) {}
+  void operator()(double x) const
+  {
+    if (x == v)
+      throw std::runtime_error("ThrowAt");
+  }
+};
+
+inline void negateInPlace(double& x)
+{ x = -x; }
+
+template<Options Mj, class S>
+void test_Parallel()
+{
+  set_num_threads(4);
+  assert( num_threads() == 4 );
+
+  // 37*5*3 elements: at most 8 chunks of MA_PARALLEL_GRAIN
+  Array<double, 3, Mj, S> A(37,5,3);
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = i;
+
+  parallel_for(A, AddOne());
+  for (Index i = 0; i < A.size(); ++i)
+    assert( A.access(i) == i+1 );
+  parallel_for(A, negateInPlace);
+  assert( A.access(7) == -8 );
+  parallel_for(A, negateInPlace);
+
+  // other layout, and strided views
+  Array<double, 3, Mj == RowMajor ? ColMajor : RowMajor> B(37,5,3);
+  parallel_transform(A, B, Twice());
+  for (Index i = 0; i < 37; ++i)
+    for (Index j = 0; j < 5; ++j)
+      for (Index k = 0; k < 3; ++k)
+        assert( B(i,j,k) == 2*A(i,j,k) );
+
+  Array<double, 3, Mj> D(A);
+  ArrayView<double, 3, Mj> V = D.view().reversed(0).transposed(1,2);
+  Array<double, 3, Mj, S> C(37,3,5);
+  parallel_transform(V, C, Twice());
+  assert( C(0,2,1) == 2*A(36,1,2) && C(36,0,4) == 2*A(0,4,0) );
+  parallel_for(V, AddOne());
+  assert( D(36,1,2) == A(36,1,2) + 1 && D(0,4,0) == A(0,4,0) + 1 );
+
+  try {
+    parallel_for(A, ThrowAt(A(30,0,0)));
+    printf("error ...\n");
+    throw;
+  }
+  catch (std::runtime_error&)
+  { }
+
+  // chunk boundaries on cache lines: slabs of 24 bytes, base 8 bytes past a line
+  Index b[5];
+  int const n = internal::partitionSlabs(1000, 24, 64*7+8, 4, b);
+  assert( n == 4 && b[0] == 0 && b[4] == 1000 );
+  for (int p = 1; p < n; ++p)
+    assert( b[p-1] < b[p] && (64*7+8 + b[p]*24) % 64 == 0 );
+
+  // tiled: whole rows of 4x4 tiles (10 tiles of 64 bytes); Morton: blocks
+  // of 4 rows, whose runs of 4x8 floats span 128 bytes
+  Array<float, 2, Tiled4> T(37,40);
+  Array<float, 2, Morton> M(37,40);
+  std::ptrdiff_t const ts[] = {160, 16}, ms[] = {0xaaa, 0x555};   // their strides
+  assert( &T(4,0) - &T(0,0) == 160 && &M(1,0) - &M(0,0) == 2 && &M(32,0) - &M(0,0) == 0x800 );
+  Index          unit;
+  std::ptrdiff_t slab;
+  internal::outerGroups<Tiled4>(ts, 0, sizeof(float), unit, slab);
+  assert( unit == 4 && slab == 640 );
+  int const nt = internal::partitionSlabs(37, slab, 0, 4, b, unit);
+  assert( nt == 4 && b[4] == 37 );
+  for (int p = 1; p < nt; ++p)
+    assert( b[p-1] < b[p] && b[p] % 4 == 0 );
+  internal::outerGroups<Morton>(ms, 0, sizeof(float), unit, slab);
+  assert( unit == 4 && slab == 0 );
+  int const nm = internal::partitionSlabs(37, slab, 0, 4, b, unit);
+  assert( nm == 4 && b[4] == 37 );
+  for (int p = 1; p < nm; ++p)
+    assert( b[p-1] < b[p] && b[p] % 4 == 0 );
+
+  for (Index i = 0; i < 37; ++i)
+    for (Index j = 0; j < 40; ++j)
+      M(i,j) = float(40*i + j);
+  parallel_transform(M, T, Twice());
+  parallel_for(M, AddOne());
+  assert( T(36,39) == 2*(40*36 + 39) && M(36,39) == 40*36 + 40 && M(3,0) == 121 );
+
+  set_num_threads(0);
+}
+
+// 5-point stencil, more expensive near i = 0; counts the visits of each element
+template<Options Mj>
+struct Stencil
+{
+  Array<double, 2, Mj> const* a;
+  Array<double, 2, Mj>*       b;
+  Array<int, 2, Mj>*          visits;
+
+  void operator()(Index const first[], Index const last[]) const
+  {
+    Array<double, 2, Mj> const& A = *a;
+    for (Index i = first[0]; i < last[0]; ++i)
+      for (Index j = first[1]; j < last[1]; ++j)
+      {
+        ++(*visits)(i,j);
+        if (i == 0 || j == 0 || i+1 == A.dim(0) || j+1 == A.dim(1))
+          continue;
+        double x = 4*A(i,j) - A(i-1,j) - A(i+1,j) - A(i,j-1) - A(i,j+1);
+        for (Index k = 0; k < (i < 5 ? 200u : 0u); ++k)
+          x = x*0.5 + x*0.5;
+        (*b)(i,j) = x;
+      }
+  }
+};
+
+struct CountVisits
+{
+  Array<int, 3, ColMajor>* visits;
+
+  void operator()(Index const first[], Index const last[]) const
+  {
+    for (Index i = first[0]; i < last[0]; ++i)
+      for (Index j = first[1]; j < last[1]; ++j)
+        for (Index k = first[2]; k < last[2]; ++k)
+          ++(*visits)(i,j,k);
+  }
+};
+
+template<Options Mj>
+void test_TileScheduler()
+{
+  set_num_threads(4);
+
+  Array<double, 2, Mj> A(37,23), B(37,23);
+  Array<int, 2, Mj>    visits(37,23);
+  for (Index i = 0; i < A.size(); ++i)
+    A.access(i) = double(i % 13) * (i % 7);
+
+  Index const tile[] = {7, 5};
+  TileScheduler<2> sched(tile);
+  assert( sched.tile(0) == 7 && sched.tile(1) == 5 );
+  Stencil<Mj> k = {&A, &B, &visits};
+  sched.run(A, k);
+
+  for (Index i = 0; i < 37; ++i)
+    for (Index j = 0; j < 23; ++j)
+    {
+      assert( visits(i,j) == 1 );
+      if (i > 0 && j > 0 && i < 36 && j < 22)
+        assert( B(i,j) == 4*A(i,j) - A(i-1,j) - A(i+1,j) - A(i,j-1) - A(i,j+1) );
+    }
+
+  SchedulerStats const& st = sched.stats();
+  assert( st.workers() == 4 );
+  Index tiles = 0;
+  for (int w = 0; w < st.workers(); ++w)
+  {
+    tiles += st.tiles[w];
+    assert( st.utilization(w) >= 0 && st.utilization(w) <= 1 );
+  }
+  assert( tiles == 6*5 );
+  assert( st.utilization() <= 1 );
+
+  // default tiles: slabs of the slowest rank
+  Array<int, 3, ColMajor> V(4,5,19);
+  CountVisits c = {&V};
+  TileScheduler<3> sched3;
+  sched3.run(V, c);
+  for (Index i = 0; i < V.size(); ++i)
+    assert( V.access(i) == 1 );
+  assert( sched3.stats().workers() == 4 );
+
+  set_num_threads(0);
+}
+
+template<Options Mj, class S>
+void test_Reductions()
+{
+  set_num_threads(4);
+
+  // 13*11*9*7 elements, values in [-50, 50]
+  Array<double, 4, Mj, S> A(13,11,9,7);
+  for (Index i = 0; i < 13; ++i)
+    for (Index j = 0; j < 11; ++j)
+      for (Index k = 0; k < 9; ++k)
+        for (Index l = 0; l < 7; ++l)
+          A(i,j,k,l) = double((i*7 + j*5 + k*3 + l*11) % 101) - 50;
+  A(3,4,5,6) = 80;
+  A(12,0,8,0) = -90;
+  A(1,1,1,1) = 80;
+
+  double s = 0, s1 = 0, s2 = 0;
+  for (Index i = 0; i < A.size(); ++i)
+  {
+    double const x = A.access(i);
+    s += x;
+    s1 += x < 0 ? -x : x;
+    s2 += x*x;
+  }
+  assert( parallel_sum(A) == s && sum(A) == s );
+  assert( parallel_minValue(A) == -90 && parallel_maxValue(A) == 80 );
+  assert( norm1(A) == s1 && std::fabs(norm2(A) - std::sqrt(s2)) < 1e-9 && normInf(A) == 90 );
+
+  Index idx[4];
+  assert( argmin(A, idx) == -90 );
+  assert( idx[0] == 12 && idx[1] == 0 && idx[2] == 8 && idx[3] == 0 );
+  // the first maximum in major order
+  assert( argmax(A, idx) == 80 );
+  assert( idx[0] == 1 && idx[1] == 1 && idx[2] == 1 && idx[3] == 1 );
+
+  // along each axis
+  Array<double, 3, Mj> S2 = sum(A, 2);
+  assert( S2.dim(0) == 13 && S2.dim(1) == 11 && S2.dim(2) == 7 );
+  for (int axis = 0; axis < 4; ++axis)
+  {
+    Array<double, 3, Mj> Sum = sum(A, axis), Lo = minValue(A, axis), Hi = maxValue(A, axis);
+    Index n[4];
+    for (n[0] = 0; n[0] < 13; ++n[0])
+      for (n[1] = 0; n[1] < 11; ++n[1])
+        for (n[2] = 0; n[2] < 9; ++n[2])
+          for (n[3] = 0; n[3] < 7; ++n[3])
+          {
+            Index b[3];
+            for (int k = 0, j = 0; k < 4; ++k)
+              if (k != axis)
+                b[j++] = n[k];
+            assert( Lo(b) <= A(n) && A(n) <= Hi(b) );
+          }
+    assert( sum(Sum) == s && sum(Lo) <= s && sum(Hi) >= s );
+    assert( minValue(Lo) == -90 && maxValue(Hi) == 80 );
+  }
+  Array<double, 3, Mj> L = sum(A, 3);
+  assert( L(3,4,5) == A(3,4,5,0) + A(3,4,5,1) + A(3,4,5,2) + A(3,4,5,3) + A(3,4,5,4) + A(3,4,5,5) + A(3,4,5,6) );
+
+  // strided views
+  ArrayView<double const, 4, Mj> V = A.view().reversed(0).transposed(1,3);
+  assert( parallel_sum(V) == s && normInf(V) == 90 );
+  assert( argmin(V, idx) == -90 && idx[0] == 0 && idx[1] == 0 && idx[2] == 8 && idx[3] == 0 );
+  Array<double, 3, Mj> SV = sum(V, 0);
+  assert( SV.dim(0) == 7 && SV(2,3,4) == sum(A.slice(range(), 4, 3, 2)) );
+
+  set_num_threads(0);
+}
+
+template<Options Mj>
+void test_Mapped()
+{
+  char const* path = "test_mapped.tmp";
+  Index const dims[] = {3, 4, 5};
+
+  // new file, zero filled; written back when destroyed
+  {
+    MappedArray<double, 3, Mj> A(path, dims);
+    assert( A.dim(0) == 3 && A.dim(1) == 4 && A.dim(2) == 5 && A.size() == 60 );
+    assert( A.file().writable() && A.file().size() == MA_FILE_DATA_OFFSET + 60*sizeof(double) );
+    assert( sum(A) == 0 );
+    for (Index i = 0; i < 3; ++i)
+      for (Index j = 0; j < 4; ++j)
+        for (Index k = 0; k < 5; ++k)
+          A(i,j,k) = 100*i + 10*j + k;
+    A.flush();
+  }
+
+  // the shape comes from the file
+  {
+    MappedArray<double, 3, Mj> A(path, ReadWrite);
+    assert( A.dim(0) == 3 && A.dim(1) == 4 && A.dim(2) == 5 );
+    assert( A(2,3,4) == 234 && A(1,0,2) == 102 );
+    A.advise(MapSequential);
+    A = 2.*A;
+  }
+
+  // read only: writes stay in memory
+  {
+    MappedArray<double, 3, Mj> A(path);
+    assert( !A.file().writable() && A(2,3,4) == 468 );
+    Amaps<double, 3, Mj>& M = A;
+    M(0,0,1) = -1;
+    assert( A(0,0,1) == -1 );
+  }
+  {
+    MappedArray<double, 3, Mj> const A(path);
+    assert( A(0,0,1) == 2 && parallel_sum(A) == 2*(6000 + 900 + 120) );
+  }
+
+  // the stored type, rank and major order must match
+  bool thrown = false;
+  try { MappedArray<float, 3, Mj> B(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  try { MappedArray<double, 2, Mj> B(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  try { MappedArray<double, 3, Mj == RowMajor ? ColMajor : RowMajor> B(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  try { MappedArray<double, 3, Mj> B("test_mapped.none"); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+
+  // file without header: the elements written above, viewed as 12x5
+  {
+    Index const raw[] = {12, 5};
+    MappedArray<double, 2, Mj> R(path, raw, ReadOnly, MA_FILE_DATA_OFFSET);
+    assert( R.data()[59] == 468 && R.size() == 60 );
+    thrown = false;
+    Index const big[] = {12, 6};
+    try { MappedArray<double, 2, Mj> B(path, big, ReadOnly, MA_FILE_DATA_OFFSET); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+    thrown = false;
+    Index const small[] = {2, 5};
+    try { MappedArray<double, 2, Mj> B(path, small, ReadOnly, MA_FILE_DATA_OFFSET + 3); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+  }
+
+  std::remove(path);
+}
+
+template<Options Mj, class S>
+void test_Io()
+{
+  Array<double, 3, Mj, S> A(3,4,5);
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 4; ++j)
+      for (Index k = 0; k < 5; ++k)
+        A(i,j,k) = 100*i + 10*j + k;
+
+  // round trip; the reader takes the shape from the header
+  std::stringstream ss;
+  save(ss, A);
+  assert( ss.str().size() == MA_FILE_DATA_OFFSET + 60*sizeof(double) );
+  Array<double, 3, Mj, S> B;
+  load(ss, B);
+  assert( B.dim(0) == 3 && B.dim(1) == 4 && B.dim(2) == 5 );
+  for (Index i = 0; i < B.size(); ++i)
+    assert( B.access(i) == A.access(i) );
+
+  // strided views are written in major order
+  Array<double, 3, Mj> Av(A);
+  std::stringstream sv;
+  save(sv, Av.view().slice(range(), range(1,4,2), range()).reversed(0));
+  ArrayReader r(sv);
+  assert( r.rank() == 3 && r.dim(0) == 3 && r.dim(1) == 2 && r.dim(2) == 5 && r.size() == 30 );
+  assert( r.isRowMajor() == (Mj == RowMajor) && r.elementType() == Float64Type && r.elementSize() == 8 );
+
+  // read in chunks
+  double chunk[7];
+  Array<double, 3, Mj> C(3,2,5);
+  for (Index i = 0; r.remaining() > 0; )
+  {
+    Index const n = r.read(chunk, 7);
+    assert( n == 7 || r.remaining() == 0 );
+    for (Index k = 0; k < n; ++k, ++i)
+      C.access(i) = chunk[k];
+  }
+  assert( r.read(chunk, 7) == 0 );
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 2; ++j)
+      for (Index k = 0; k < 5; ++k)
+        assert( C(i,j,k) == A(2-i, 1+2*j, k) );
+
+  // mismatches
+  bool thrown = false;
+  std::stringstream s1(ss.str());
+  Array<float, 3, Mj> F;
+  try { load(s1, F); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  std::stringstream s2(ss.str());
+  Array<double, 2, Mj> G;
+  try { load(s2, G); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  std::stringstream s3(ss.str().substr(0, MA_FILE_DATA_OFFSET + 100));
+  try { load(s3, B); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  std::stringstream s4("not an array");
+  try { load(s4, B); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+
+  // corrupt dims: a zero dim, and dims whose product overflows
+  std::string h0 = ss.str(), h1 = ss.str();
+  h0[48] = 0;                                   // dims[1] = 0
+  h1[47] = char(0x20);                          // dims[0] = 3 + 2^61
+  thrown = false;
+  std::stringstream s5(h0);
+  try { load(s5, B); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  std::stringstream s6(h1);
+  try { load(s6, B); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+
+  // the files can be mapped
+  char const* path = "test_io.tmp";
+  save(path, A);
+  {
+    MappedArray<double, 3, Mj> M(path);
+    assert( M.dim(0) == 3 && M.dim(1) == 4 && M.dim(2) == 5 && M(2,3,4) == 234 );
+  }
+  {
+    Index const dims[] = {2, 2, 2};
+    MappedArray<double, 3, Mj> M(path, dims);
+    M(1,1,0) = 7;
+  }
+  Array<double, 3, Mj, S> D;
+  load(path, D);
+  assert( D.size() == 8 && D(1,1,0) == 7 && sum(D) == 7 );
+  {
+    std::ofstream os(path, std::ios::binary);
+    os.write(h1.data(), h1.size());
+  }
+  thrown = false;
+  try { MappedArray<double, 3, Mj> M(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  std::remove(path);
+}
+
+template<Options Mj, class S>
+void test_Npy()
+{
+  bool const rm = Mj == RowMajor;
+  Array<double, 3, Mj, S> A(3,4,5);
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 4; ++j)
+      for (Index k = 0; k < 5; ++k)
+        A(i,j,k) = 100*i + 10*j + k;
+
+  // header as numpy writes it, elements 64-byte aligned
+  std::stringstream ss;
+  save_npy(ss, A);
+  std::string const f = ss.str();
+  assert( f.compare(0, 8, std::string("\x93NUMPY\x01\x00", 8)) == 0 );
+  Index const len = (unsigned char)f[8] + 256*(unsigned char)f[9];
+  assert( (10 + len) % 64 == 0 && f[9 + len] == '\n' && f.size() == 10 + len + 60*sizeof(double) );
+  std::string const dict = rm ? "{'descr': '<f8', 'fortran_order': False, 'shape': (3, 4, 5), }"
+                              : "{'descr': '<f8', 'fortran_order': True, 'shape': (3, 4, 5), }";
+  assert( f.compare(10, dict.size(), dict) == 0 );
+
+  Array<double, 3, Mj, S> B;
+  load_npy(ss, B);
+  assert( B.dim(0) == 3 && B.dim(1) == 4 && B.dim(2) == 5 );
+  for (Index i = 0; i < B.size(); ++i)
+    assert( B.access(i) == A.access(i) );
+
+  // a file from numpy, with another spacing and a rank 1 shape
+  std::string g = "{\"descr\": \"<i4\", \"fortran_order\":";
+  g += rm ? "False" : "True";
+  g += ", \"shape\":(4,)}       \n";
+  std::string const pre = std::string("\x93NUMPY\x01\x00", 8) + char(g.size()) + char(0);
+  int const v[] = {1, -2, 3, -4};
+  std::stringstream sg(pre + g + std::string((char const*)v, sizeof(v)));
+  Array<int, 1, Mj> I;
+  load_npy(sg, I);
+  assert( I.size() == 4 && I(1) == -2 && I(3) == -4 );
+
+  // dtype, rank and order must match
+  bool thrown = false;
+  std::stringstream s1(f);
+  Array<float, 3, Mj> F;
+  try { load_npy(s1, F); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  std::stringstream s2(f);
+  Array<double, 3, Mj == RowMajor ? ColMajor : RowMajor> O;
+  try { load_npy(s2, O); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  std::stringstream s3(f);
+  Array<double, 2, Mj> R;
+  try { load_npy(s3, R); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+
+  // mapped in place
+  char const* path = "test_npy.tmp";
+  save_npy(path, A);
+  {
+    MappedArray<double, 3, Mj> M(path, ReadOnly, npy);
+    assert( M.dim(0) == 3 && M.dim(2) == 5 && M(2,3,4) == 234 && M(1,2,3) == 123 );
+  }
+
+  // corrupt shapes: a zero dim, a dim that overflows, a size that
+  // overflows, and more elements than the file holds
+  char const* const shapes[] = {"(0,)", "(99999999999999999999999,)", "(4611686018427387904,)", "(400,)"};
+  for (int c = 0; c < 4; ++c)
+  {
+    std::string h = "{\"descr\": \"<i4\", \"fortran_order\": ";
+    h += rm ? "False" : "True";
+    h += std::string(", \"shape\": ") + shapes[c] + "}\n";
+    std::string const bad = std::string("\x93NUMPY\x01\x00", 8) + char(h.size()) + char(0) + h
+                          + std::string((char const*)v, sizeof(v));
+    thrown = false;
+    std::stringstream sb(bad);
+    try { load_npy(sb, I); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+    {
+      std::ofstream os(path, std::ios::binary);
+      os.write(bad.data(), bad.size());
+    }
+    thrown = false;
+    try { MappedArray<int, 1, Mj> M(path, ReadOnly, npy); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+  }
+
+  // npz archives
+  Array<bool, 2, Mj> P(2,3);
+  P(1,2) = true;
+  {
+    NpzWriter z(path);
+    z.add("a", A);
+    z.add("p", P);
+    Array<double, 3, Mj> Av(A);
+    z.add("v", Av.view().slice(1, range(), range(0,5,2)));
+  }
+  NpzReader z(path);
+  assert( z.names().size() == 3 && z.names()[0] == "a" && z.names()[2] == "v" );
+  assert( z.contains("p") && z.contains("p.npy") && !z.contains("q") );
+  Array<double, 2, Mj> V;
+  z.load("v", V);
+  assert( V.dim(0) == 4 && V.dim(1) == 3 && V(3,2) == 134 && V(0,1) == 102 );
+  Array<bool, 2, Mj> Q;
+  z.load("p", Q);
+  assert( Q.size() == 6 && Q(1,2) && !Q(0,2) );
+  z.load("a", B);
+  assert( B(2,3,4) == 234 && B(0,1,0) == 10 );
+  thrown = false;
+  try { z.load("q", B); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  std::remove(path);
+}
+
+template<Options Mj>
+void test_Chunked()
+{
+  char const* path = "test_chunked.tmp";
+  Index const dims[] = {10, 7, 5}, tile[] = {4, 3, 0};
+  Array<double, 3, Mj> A(10,7,5);
+  for (Index i = 0; i < 10; ++i)
+    for (Index j = 0; j < 7; ++j)
+      for (Index k = 0; k < 5; ++k)
+        A(i,j,k) = 100*i + 10*j + k;
+
+  // a cache of two tiles over 3*3 = 9 tiles
+  {
+    ChunkedArray<double, 3, Mj> C(path, dims, tile, 2*4*3*5*sizeof(double));
+    assert( C.size() == 350 && C.tile(0) == 4 && C.tile(2) == 5 && C.numTiles() == 9 && C.cacheTiles() == 2 );
+    assert( C(9,6,4) == 0 );                // never written: zeros
+    Index const first[] = {0, 0, 0};
+    C.write(first, A);
+    Index const idx[] = {9, 6, 4};
+    C.set(idx, -1.);
+    assert( C(9,6,4) == -1. && C(3,2,1) == 321 && C(4,3,0) == 430 );
+    assert( C.misses() > 9 && C.hits() > 0 );
+  }
+
+  // reopened: a box crossing tile edges
+  {
+    ChunkedArray<double, 3, Mj> C(path, ReadOnly, 0);
+    assert( C.dim(0) == 10 && C.dim(1) == 7 && C.tile(1) == 3 && C.cacheTiles() == 1 );
+    Array<double, 3, Mj> B(5,4,2);
+    Index const first[] = {3, 2, 3};
+    C.read(first, B);
+    for (Index i = 0; i < 5; ++i)
+      for (Index j = 0; j < 4; ++j)
+        for (Index k = 0; k < 2; ++k)
+          assert( B(i,j,k) == 100*(i+3) + 10*(j+2) + k+3 );
+    assert( C(9,6,4) == -1. );
+
+    // an empty box touches nothing
+    Array<double, 3, Mj> E;
+    C.read(first, E);
+    assert( E.size() == 0 );
+
+    bool thrown = false;
+    Index const idx[] = {0, 0, 0};
+    try { C.set(idx, 1.); } catch (std::runtime_error&) { thrown = true; }
+    assert( thrown );
+  }
+
+  // rewritten in place
+  {
+    ChunkedArray<double, 3, Mj> C(path, ReadWrite);
+    Array<double, 3, Mj> Z(2,2,2);
+    Index const first[] = {8, 5, 3};
+    C.write(first, Z);
+  }
+  {
+    ChunkedArray<double, 3, Mj> C(path);
+    assert( C(9,6,4) == 0 && C(8,5,3) == 0 && C(7,5,3) == 753 && C(8,4,3) == 843 );
+  }
+
+  // type, rank and major order must match
+  bool thrown = false;
+  try { ChunkedArray<float, 3, Mj> F(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  thrown = false;
+  try { ChunkedArray<double, 3, Mj == RowMajor ? ColMajor : RowMajor> F(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  std::remove(path);
+}
+
+template<Options Mj, class S>
+void test_Compress()
+{
+  Array<double, 4, Mj, S> A(6,7,8,9);
+  for (Index i = 0; i < 6; ++i)
+    for (Index j = 0; j < 7; ++j)
+      for (Index k = 0; k < 8; ++k)
+        for (Index l = 0; l < 9; ++l)
+          A(i,j,k,l) = std::sin(0.1*i) * std::cos(0.2*j) + 0.01*k*l;
+
+  // several blocks, and several batches of blocks
+  std::stringstream ss;
+  save(ss, A, ShuffleLz, 1000);
+  Index const raw = MA_FILE_DATA_OFFSET + A.size()*sizeof(double);
+  assert( ss.str().size() < raw );
+  std::string const f = ss.str();
+  Array<double, 4, Mj, S> B;
+  load(ss, B);
+  assert( B.dim(0) == 6 && B.dim(3) == 9 );
+  for (Index i = 0; i < B.size(); ++i)
+    assert( B.access(i) == A.access(i) );
+
+  // the ratios stated in the README: a field quantized to multiples of 2^-10
+  // shrinks at least 3x; at full precision it only shrinks a little
+  Array<double, 3, Mj, S> Q(32,32,32), R(32,32,32);
+  for (Index i = 0; i < 32; ++i)
+    for (Index j = 0; j < 32; ++j)
+      for (Index k = 0; k < 32; ++k)
+      {
+        R(i,j,k) = std::sin(0.31*i + 0.17*k)*std::cos(0.23*j) + 0.5*std::sin(0.11*(i + 2*j + 3*k));
+        Q(i,j,k) = std::floor(R(i,j,k)*1024 + 0.5)/1024;
+      }
+  std::stringstream sq, sr;
+  save(sq, Q, ShuffleLz);
+  save(sr, R, ShuffleLz);
+  Index const qraw = Q.size()*sizeof(double);
+  assert( 3*(sq.str().size() - MA_FILE_DATA_OFFSET) <= qraw );
+  assert( sr.str().size() - MA_FILE_DATA_OFFSET < qraw );
+  Array<double, 3, Mj, S> L;
+  load(sq, L);
+  for (Index i = 0; i < L.size(); ++i)
+    assert( L.access(i) == Q.access(i) );
+
+  // repetitive data compresses well; read in chunks crossing the blocks
+  Array<int, 2, Mj> I(50, 40);
+  for (Index i = 0; i < I.size(); ++i)
+    I.access(i) = int(i / 16);
+  std::stringstream si;
+  save(si, I, ShuffleLz, 256);
+  assert( si.str().size() < MA_FILE_DATA_OFFSET + I.size()*sizeof(int) / 4 );
+  ArrayReader r(si);
+  assert( r.compression() == ShuffleLz && r.size() == 2000 );
+  int chunk[33];
+  for (Index i = 0; r.remaining() > 0; )
+  {
+    Index const n = r.read(chunk, 33);
+    for (Index k = 0; k < n; ++k, ++i)
+      assert( chunk[k] == int(i / 16) );
+  }
+
+  // incompressible blocks are stored raw
+  Array<unsigned, 1, Mj> U(3000);
+  unsigned x = 12345;
+  for (Index i = 0; i < U.size(); ++i)
+    U(i) = x = x * 1103515245u + 12345u;
+  std::stringstream su;
+  save(su, U, ShuffleLz, 4096);
+  assert( su.str().size() <= MA_FILE_DATA_OFFSET + U.size()*sizeof(unsigned) + 8*3 );
+  Array<unsigned, 1, Mj> V;
+  load(su, V);
+  assert( V.size() == 3000 && V(0) == U(0) && V(2999) == U(2999) );
+
+  // truncated or mapped
+  bool thrown = false;
+  std::stringstream s1(f.substr(0, f.size() - 10));
+  try { load(s1, B); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+  char const* path = "test_compress.tmp";
+  save(path, A, ShuffleLz);
+  thrown = false;
+  try { MappedArray<double, 4, Mj> M(path); } catch (std::runtime_error&) { thrown = true; }
+  assert( thrown );
+
+  // compressed tiles
+  {
+    Index const dims[] = {6, 7, 8, 9}, tile[] = {4, 4, 4, 4};
+    ChunkedArray<double, 4, Mj> C(path, dims, tile, MA_CHUNK_CACHE, ShuffleLz);
+    Index const first[] = {0, 0, 0, 0};
+    C.write(first, A);
+  }
+  {
+    ChunkedArray<double, 4, Mj> C(path);
+    assert( C.compression() == ShuffleLz );
+    Array<double, 4, Mj> D(6,7,8,9);
+    Index const first[] = {0, 0, 0, 0};
+    C.read(first, D);
+    for (Index i = 0; i < D.size(); ++i)
+      assert( D.access(i) == A.access(i) );
+  }
+  std::remove(path);
+}
+
+struct SumNonzeros
+{
+  double sum;
+  Index  count;
+  SumNonzeros() : sum(0), count(0) { }
+  void operator()(Index const idx[], double x)
+  {
+    assert( x == 1000*idx[0] + 100*idx[1] + 10*idx[2] + idx[3] );
+    sum += x;
+    ++count;
+  }
+};
+
+template<Options Mj>
+void test_Sparse()
+{
+  SparseArray<double, 4, Mj> S(10, 20, 30, 40);
+  assert( S.rank() == 4 && S.dim(2) == 30 && S.size() == 240000 && S.nnz() == 0 );
+  assert( S(1,2,3,4) == 0 );
+
+  // writes through the proxy; zeros are not stored
+  S(1,2,3,4) = 1234;
+  S(9,19,29,39) = 9;
+  S(9,19,29,39) += 1;
+  Index const idx[] = {0, 0, 0, 5};
+  S(idx) = 5;
+  assert( S.nnz() == 3 && S(1,2,3,4) == 1234 && S(9,19,29,39) == 10 && S(0,0,0,5) == 5 );
+  S(0,0,0,5) = 0;
+  assert( S.nnz() == 2 && S(0,0,0,5) == 0 );
+  S(9,19,29,39) -= 10;
+  assert( S.nnz() == 1 );
+
+  // many insertions and erasures, through rehashes
+  for (Index i = 0; i < 10; ++i)
+    for (Index j = 0; j < 20; j += 3)
+      for (Index k = 0; k < 30; k += 7)
+        S(i,j,k,j) = 1000*i + 100*j + 10*k + j;
+  Index const n = S.nnz();
+  for (Index i = 0; i < 10; i += 2)
+    for (Index j = 0; j < 20; j += 3)
+      for (Index k = 0; k < 30; k += 7)
+        S(i,j,k,j) = 0;
+  assert( S.nnz() < n && S(1,3,7,3) == 1373 && S(2,3,7,3) == 0 );
+  SumNonzeros f = for_each_nonzero(S, SumNonzeros());
+  assert( f.count == S.nnz() );
+
+  // to and from dense
+  Array<double, 4, Mj> A = S;
+  assert( A.dim(3) == 40 && A(1,3,7,3) == 1373 && A(2,3,7,3) == 0 && sum(A) == f.sum );
+  Array<double, 4, Mj == RowMajor ? ColMajor : RowMajor> B(10, 20, 30, 40);
+  B = S;
+  assert( B(1,3,7,3) == 1373 && B(1,2,3,4) == 1234 );
+  A(0,0,0,0) = -1;
+  SparseArray<double, 4, Mj> T = A;
+  assert( T.nnz() == S.nnz() + 1 && T(0,0,0,0) == -1 && T(1,2,3,4) == 1234 );
+  SparseArray<double, 4, Mj> U = B;
+  assert( U.nnz() == S.nnz() && U(1,3,7,3) == 1373 );
+
+  // expressions
+  Array<double, 4, Mj> C = 2.*S + A;
+  assert( C(1,3,7,3) == 3*1373 && C(0,0,0,0) == -1 );
+  T = T - S;
+  assert( T.nnz() == 1 && T(0,0,0,0) == -1 );
+
+  Array<double, 4, Mj> Av(A);
+  SparseArray<double, 2, Mj> V = Av.view().slice(1, 3, range(), range());
+  assert( V.dim(0) == 30 && V.dim(1) == 40 && V(7,3) == 1373 && V.nnz() == 5 );
+}
+
+// x(i) == y(i) for every multi-index, both walked in row-major order
+template<class X, class Y>
+bool sameElements(X const& x, Y const& y)
+{
+  typename X::const_nd_iterator a = x.ndbegin();
+  typename Y::const_nd_iterator b = y.ndbegin();
+  for (; a != x.ndend(); ++a, ++b)
+    if (*a != *b)
+      return false;
+  return b == y.ndend();
+}
+
+template<Options Mj>
+void test_Tiled()
+{
+  Index const b = Index(1) << internal::TileBitsOf<Mj>::value;
+
+  // dims that are not multiples of the tile side
+  Array<double, 3, Mj>       A(b+3, 2*b-1, 5);
+  Array<double, 3, RowMajor> R(b+3, 2*b-1, 5);
+  assert( A.size() == R.size() && A.dim(0) == b+3 && A.dim(2) == 5 );
+  for (Index i = 0; i < A.dim(0); ++i)
+    for (Index j = 0; j < A.dim(1); ++j)
+      for (Index k = 0; k < A.dim(2); ++k)
+        A(i,j,k) = R(i,j,k) = double((i*64 + j)*8 + k);
+  assert( sameElements(A, R) );
+
+  // the neighbours in every direction are in the same tile
+  assert( &A(0,0,1) - &A(0,0,0) == 1 );
+  assert( &A(0,1,0) - &A(0,0,0) == std::ptrdiff_t(b) );
+  assert( &A(1,0,0) - &A(0,0,0) == std::ptrdiff_t(b*b) );
+  // a row of tiles of the first rank has ceil(dims[1]/b)*ceil(dims[2]/b) tiles
+  assert( &A(b,0,0) - &A(0,0,0) == std::ptrdiff_t(b*b*b * 2*((5 + b-1) / b)) );
+  Index const idx[] = {b, b+1, 4};
+  assert( A(idx) == R(idx) && A[b][b+1][4] == R(b,b+1,4) );
+  A[1][2][3] = R(1,2,3) = -1;
+  assert( A(1,2,3) == -1 );
+
+  // expressions and reductions
+  Array<double, 3, Mj> B = 2.*A + A;
+  Array<double, 3, RowMajor> C = B - 3.*R;
+  assert( B(b,b+1,4) == 3*R(b,b+1,4) && sum(C) == 0 );
+  C = A;
+  assert( sameElements(C, R) );
+  assert( sum(A) == sum(R) && maxValue(A) == maxValue(R) && parallel_sum(A) == sum(R) );
+  Index ia[3], ir[3];
+  assert( argmin(A, ia) == argmin(R, ir) && std::equal(ia, ia+3, ir) );
+  Array<double, 2, Mj> S1 = sum(A, 1);
+  Array<double, 2, RowMajor> T1 = sum(R, 1);
+  assert( sameElements(S1, T1) );
+
+  // parallel loops
+  parallel_for(A, AddOne());
+  assert( A(0,0,0) == 1 && A(b+2,2*b-2,4) == R(b+2,2*b-2,4) + 1 );
+  parallel_transform(A, R, Twice());
+  parallel_transform(R, A, Twice());
+  assert( A(b,b+1,4) == 4*(b*64 + b+1)*8 + 4*4 + 4 );
+
+  // binary files, plain and compressed, from either layout
+  std::stringstream s1, s2, s3;
+  save(s1, A);
+  load(s1, C);
+  assert( sameElements(C, A) );
+  save(s2, R);
+  load(s2, B);
+  assert( sameElements(B, R) );
+  save(s3, A, ShuffleLz, 256);
+  load(s3, B);
+  assert( sameElements(B, A) );
+
+  // copies between memory blocks, and resize_preserve
+  Array<double, 3, Mj, AlignedBlock<double> > D(A);
+  assert( sameElements(D, A) );
+  D.resize_preserve(b+5, b, 6);
+  assert( D.size() == (b+5)*b*6 && D(b+2,b-1,4) == A(b+2,b-1,4) && D(b+4,0,0) == 0 && D(0,0,5) == 0 );
+}
+
+void test_Morton()
+{
+  assert( internal::depositBits(5, 0xf0) == 0x50 && internal::depositBits(6, 0x2a) == 0x28 );
+
+  // dims of 3, 3 and 2 bits: the last rank drops out of the top level
+  Array<float, 3, Morton>   A(5, 8, 3);
+  Array<float, 3, RowMajor> R(5, 8, 3);
+  Index const dims[] = {5, 8, 3};
+  assert( A.size() == 120 && A.end() - A.begin() == 256 && storage_size<Morton>(dims) == 256 );
+  for (Index i = 0; i < 5; ++i)
+    for (Index j = 0; j < 8; ++j)
+      for (Index k = 0; k < 3; ++k)
+        A(i,j,k) = R(i,j,k) = float((i*8 + j)*3 + k);
+  assert( sameElements(A, R) );
+  assert( &A(0,0,1) - &A(0,0,0) == 1 && &A(0,1,0) - &A(0,0,0) == 2 && &A(1,0,0) - &A(0,0,0) == 4 );
+  assert( &A(1,1,1) - &A(0,0,0) == 7 && &A(0,0,2) - &A(0,0,0) == 8 && &A(4,7,0) - &A(0,0,0) == 128+64+18 );
+  assert( A[3][5][2] == R(3,5,2) );
+
+  // a user buffer in Morton order
+  std::vector<float> buf(storage_size<Morton>(dims));
+  Amaps<float, 3, Morton> M(&buf[0], dims);
+  M = R + 0.f;
+  assert( buf[7] == R(1,1,1) && M(4,7,2) == R(4,7,2) && sameElements(M, R) );
+
+  // expressions, reductions and loops
+  Array<float, 3, Morton> B = 2.f*A - M;
+  assert( sameElements(B, R) && sum(B) == sum(R) && parallel_sum(A) == sum(R) );
+  Index ia[3], ir[3];
+  assert( argmax(A, ia) == argmax(R, ir) && std::equal(ia, ia+3, ir) );
+  parallel_for(B, AddOne());
+  assert( B(4,7,2) == R(4,7,2) + 1 );
+
+  // binary files, and resize_preserve
+  std::stringstream s1;
+  save(s1, A);
+  Array<float, 3, RowMajor> L;
+  load(s1, L);
+  assert( sameElements(L, R) );
+  A.resize_preserve(9, 8, 1);
+  assert( A.size() == 72 && A(4,7,0) == R(4,7,0) && A(8,0,0) == 0 );
+
+  // ranks of dim 1 take no bit
+  Array<double, 4, Morton> C(1, 6, 1, 6);
+  assert( C.end() - C.begin() == 64 && &C(0,1,0,0) - &C(0,0,0,0) == 2 );
+}
+
+void test_MixedTypes()
+{
+  assert( (Tr1::is_same<internal::Promote<int, double>::type, double>::value) );
+  assert( (Tr1::is_same<internal::Promote<float, int>::type, float>::value) );
+  assert( (Tr1::is_same<internal::Promote<char, short>::type, int>::value) );
+
+  Array<int, 1>    I(3);
+  Array<double, 1> A(3);
+  I(0) = 1;   I(1) = 2;    I(2) = -3;
+  A(0) = 0.5; A(1) = 1.25; A(2) = 0.75;
+
+  // the element types are promoted as in `i * a`, nothing is truncated
+  Array<double, 1> D = I*A;
+  assert( D(0) == 0.5 && D(1) == 2.5 && D(2) == -2.25 );
+  D = A - I;
+  assert( D(0) == -0.5 && D(1) == -0.75 && D(2) == 3.75 );
+
+  D = I + 0.5;
+  assert( D(0) == 1.5 && D(1) == 2.5 && D(2) == -2.5 );
+  D = 1.5*I - A/I;
+  assert( D(0) == 1 && D(1) == 2.375 && D(2) == -4.25 );
+
+  // the result is converted only when it is stored
+  Array<float, 1> F = A*2 + I;
+  assert( F(0) == 2.f && F(1) == 4.5f && F(2) == -1.5f );
+  I = A*4;
+  assert( I(0) == 2 && I(1) == 5 && I(2) == 3 );
+  I += 0.5*I;
+  assert( I(0) == 3 && I(1) == 7 && I(2) == 4 );
+}
+
+template<class T, class S>
+void test_Bulk()
+{
+  // 3*5*7 elements: not a multiple of any SIMD width
+  Array<T, 3, RowMajor, S> A(3,5,7), B(3,5,7);
+
+  fill(A, T(2));
+  for (Index i = 0; i < A.size(); ++i)
+  {
+    assert( A.access(i) == 2 );
+    B.access(i) = T(i % 17) - 8;
+  }
+
+  assert( sum(A) == 2*105 );
+  assert( minValue(B) == -8 );
+  assert( maxValue(B) == 8 );
+
+  T s = 0, d = 0;
+  for (Index i = 0; i < B.size(); ++i)
+  {
+    s += B.access(i);
+    d += 2*B.access(i);
+  }
+  assert( sum(B) == s );
+  assert( dot(A, B) == d );
+
+  axpy(T(3), B, A);                  // A = 2 + 3*B
+  scale(A, T(2));                    // A = 4 + 6*B
+  for (Index i = 0; i < A.size(); ++i)
+    assert( A.access(i) == 4 + 6*B.access(i) );
+
+  Array<T, 3, RowMajor, S> C(3,5,7);
+  copy(B, C);
+  for (Index i = 0; i < C.size(); ++i)
+    assert( C.access(i) == B.access(i) );
+
+  // strided views and other major orders fall back to the multi-index
+  ArrayView<T, 2> V = A.slice(range(), 2, range());
+  fill(V, T(-1));
+  assert( A(2,2,6) == -1 && A(2,3,6) != -1 );
+  assert( sum(V) == -21 );
+  assert( minValue(A.slice(range(), range(0,5,2), 0)) == minValue(B.slice(range(), range(0,5,2), 0))*6 + 4 );
+
+  Array<T, 3, ColMajor> D(3,5,7);
+  copy(B, D);
+  assert( dot(D, B) == dot(B, B) );
+  for (Index i = 0; i < 3; ++i)
+    for (Index j = 0; j < 5; ++j)
+      for (Index k = 0; k < 7; ++k)
+        assert( D(i,j,k) == B(i,j,k) );
+
+  Amaps<T, 1> M(C.data(), C.size());
+  scale(M, T(-1));
+  assert( sum(C) == -s );
+
+  // other element types go through the expressions
+  Array<float, 3> F(3,5,7);
+  copy(B, F);
+  axpy(T(2), F, C);                  // C = -B + 2*B
+  for (Index i = 0; i < F.size(); ++i)
+    assert( F.access(i) == float(B.access(i)) && C.access(i) == B.access(i) );
+  assert( dot(B, F) == dot(B, B) );
+  copy(F, D);
+  assert( D(2,4,6) == B(2,4,6) );
+}
+
 #define TEST(fun_name) printf( #fun_name "() ... "); \
                        fun_name ();                  \
                        printf("OK\n");
@@ -870,6 +2583,83 @@ int main()
   TEST(test_iterators<std::vector<Index> >                            );
   TEST(test_iterators<std::deque<Index> >                             );
   TEST(test_iterators<Index[18000] >                                  );
+  TEST(test_HighRank<RowMajor com std::vector<Index> >                );
+  TEST(test_HighRank<ColMajor com std::vector<Index> >                );
+  TEST(test_HighRank<RowMajor com Index[432] >                        );
+  TEST(test_HighRank<ColMajor com Index[432] >                        );
+  TEST(test_ArrayView                                                 );
+  TEST(test_Slice<RowMajor com std::vector<double> >                  );
+  TEST(test_Slice<ColMajor com std::vector<double> >                  );
+  TEST(test_Slice<RowMajor com double[360] >                          );
+  TEST(test_Expressions<std::vector<double> >                         );
+  TEST(test_Expressions<double[24] >                                  );
+  TEST(test_Layout<std::vector<double> >                              );
+  TEST(test_Layout<double[4995] >                                     );
+  TEST(test_Bulk<double com std::vector<double> >                     );
+  TEST(test_Bulk<float com std::vector<float> >                       );
+  TEST(test_Bulk<double com double[105] >                             );
+  TEST(test_Bulk<int com std::vector<int> >                           );
+  TEST(test_Bulk<double com AlignedBlock<double> >                    );
+  TEST(test_Bulk<float com AlignedBlock<float> >                      );
+  TEST(test_Expressions<AlignedBlock<double> >                        );
+  TEST(test_Layout<AlignedBlock<double> >                             );
+  TEST(test_AlignedBlock                                              );
+  TEST(test_Uninitialized<std::vector<double> >                       );
+  TEST(test_Uninitialized<AlignedBlock<double> >                      );
+  TEST(test_Uninitialized<double[24] >                                );
+  TEST(test_Uninitialized<std::vector<double com default_init_allocator<double> > >);
+  TEST(test_DefaultInitAllocator                                      );
+  TEST(test_ResizePreserve<RowMajor com std::vector<int> >            );
+  TEST(test_ResizePreserve<ColMajor com std::vector<int> >            );
+  TEST(test_ResizePreserve<RowMajor com std::deque<int> >             );
+  TEST(test_ResizePreserve<ColMajor com AlignedBlock<int> >           );
+  TEST(test_ResizePreserve<RowMajor com int[128] >                    );
+  TEST(test_ResizePreserve<ColMajor com int[128] >                    );
+  TEST(test_Swap<std::vector<double> >                                );
+  TEST(test_Swap<std::deque<double> >                                 );
+  TEST(test_Swap<AlignedBlock<double> >                               );
+  TEST(test_Swap<double[12] >                                         );
+  TEST(test_NdIterator<RowMajor com std::vector<int> >                );
+  TEST(test_NdIterator<ColMajor com std::vector<int> >                );
+  TEST(test_NdIterator<ColMajor com std::deque<int> >                 );
+  TEST(test_NdIterator<RowMajor com int[24] >                         );
+  TEST(test_NdIteratorView                                            );
+  TEST(test_Proxy<RowMajor>                                           );
+  TEST(test_Proxy<ColMajor>                                           );
+  TEST(test_FixedArray<RowMajor>                                      );
+  TEST(test_FixedArray<ColMajor>                                      );
+  TEST(test_Parallel<RowMajor com std::vector<double> >               );
+  TEST(test_Parallel<ColMajor com std::vector<double> >               );
+  TEST(test_Parallel<RowMajor com std::deque<double> >                );
+  TEST(test_Parallel<ColMajor com AlignedBlock<double> >              );
+  TEST(test_TileScheduler<RowMajor>                                   );
+  TEST(test_TileScheduler<ColMajor>                                   );
+  TEST(test_Reductions<RowMajor com std::vector<double> >             );
+  TEST(test_Reductions<ColMajor com std::vector<double> >             );
+  TEST(test_Reductions<ColMajor com AlignedBlock<double> >            );
+  TEST(test_Mapped<RowMajor>                                          );
+  TEST(test_Mapped<ColMajor>                                          );
+  TEST(test_Io<RowMajor com std::vector<double> >                    );
+  TEST(test_Io<ColMajor com std::vector<double> >                    );
+  TEST(test_Io<RowMajor com std::deque<double> >                     );
+  TEST(test_Io<ColMajor com AlignedBlock<double> >                   );
+  TEST(test_Npy<RowMajor com std::vector<double> >                   );
+  TEST(test_Npy<ColMajor com std::vector<double> >                   );
+  TEST(test_Npy<ColMajor com std::deque<double> >                    );
+  TEST(test_Chunked<RowMajor>                                         );
+  TEST(test_Chunked<ColMajor>                                         );
+  TEST(test_Compress<RowMajor com std::vector<double> >               );
+  TEST(test_Compress<ColMajor com std::deque<double> >                );
+  TEST(test_Sparse<RowMajor>                                          );
+  TEST(test_Sparse<ColMajor>                                          );
+  TEST(test_Tiled<Tiled4>                                             );
+  TEST(test_Tiled<Tiled8>                                             );
+  TEST(test_Morton                                                    );
+  TEST(test_MixedTypes                                                );
+#if __cplusplus >= 201103L
+  TEST(test_HighRank<RowMajor>                                        );
+  TEST(test_HighRank<ColMajor>                                        );
+#endif
 
   printf("Everything seems OK \n");
 }